@@ -94,6 +94,8 @@ static int
 ig4iic_acpi_attach(device_t dev)
 {
 	ig4iic_softc_t	*sc;
+	ACPI_HANDLE handle;
+	UINT32 shared_host;
 	int error;
 
 	sc = device_get_softc(dev);
@@ -119,6 +121,16 @@ ig4iic_acpi_attach(device_t dev)
 	}
 	sc->platform_attached = 1;
 
+	/*
+	 * A non-zero _SEM means the bus is shared with the PUNIT (Bay Trail
+	 * and Cherry Trail PMIC bus) and must be arbitrated.
+	 */
+	handle = acpi_get_handle(dev);
+	if (ACPI_SUCCESS(acpi_GetInteger(handle, "_SEM", &shared_host)) &&
+	    shared_host != 0)
+		ig4iic_baytrail_setup(sc,
+		    acpi_MatchHid(handle, "808622C1") != 0);
+
 	error = ig4iic_attach(sc);
 	if (error)
 		ig4iic_acpi_detach(dev);
@@ -153,11 +165,29 @@ ig4iic_acpi_detach(device_t dev)
 	return (0);
 }
 
+static int
+ig4iic_acpi_suspend(device_t dev)
+{
+	ig4iic_softc_t *sc = device_get_softc(dev);
+
+	return (ig4iic_suspend(sc));
+}
+
+static int
+ig4iic_acpi_resume(device_t dev)
+{
+	ig4iic_softc_t *sc = device_get_softc(dev);
+
+	return (ig4iic_resume(sc));
+}
+
 static device_method_t ig4iic_acpi_methods[] = {
 	/* Device interface */
 	DEVMETHOD(device_probe, ig4iic_acpi_probe),
 	DEVMETHOD(device_attach, ig4iic_acpi_attach),
 	DEVMETHOD(device_detach, ig4iic_acpi_detach),
+	DEVMETHOD(device_suspend, ig4iic_acpi_suspend),
+	DEVMETHOD(device_resume, ig4iic_acpi_resume),
 
 	/* iicbus interface */
 	DEVMETHOD(iicbus_transfer, ig4iic_transfer),
@@ -0,0 +1,203 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+/*
+ * Bay Trail / Cherry Trail PMIC I2C bus semaphore.
+ *
+ * On these SoCs one of the I2C controllers is wired to the PMIC, which the
+ * PUNIT firmware also talks to (e.g. for C-state and DVFS transitions).
+ * The BIOS flags such a controller with an ACPI _SEM object returning 1,
+ * and the OS must then own the PUNIT semaphore, accessed through the IOSF
+ * sideband message bus, while it drives the bus.
+ *
+ * See linux_src/i2c-designware-baytrail.c for the reference protocol.
+ */
+
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/kernel.h>
+#include <sys/lock.h>
+#include <sys/mutex.h>
+#include <sys/sx.h>
+#include <sys/bus.h>
+#include <sys/sysctl.h>
+#include <sys/time.h>
+
+#include <machine/bus.h>
+#include <machine/pci_cfgreg.h>
+#include <sys/rman.h>
+
+#include <dev/iicbus/iicbus.h>
+#include <dev/iicbus/iiconf.h>
+
+#include <dev/ichiic/ig4_reg.h>
+#include <dev/ichiic/ig4_var.h>
+
+/*
+ * IOSF sideband message bus, reached through config space of the host
+ * bridge at 0:0.0.
+ */
+#define IOSF_MBI_MCR		0xD0	/* Message Control Register */
+#define IOSF_MBI_MDR		0xD4	/* Message Data Register */
+#define IOSF_MBI_MCRX		0xD8	/* Message Control Register Extension */
+#define IOSF_MBI_ENABLE		0xF0	/* All byte enables */
+#define IOSF_MBI_UNIT_PMC	0x04
+#define IOSF_MBI_REG_READ	0x10
+#define IOSF_MBI_REG_WRITE	0x11
+
+#define PUNIT_SEMAPHORE		0x7
+#define PUNIT_SEMAPHORE_CHT	0x10E
+#define PUNIT_SEMAPHORE_BIT	0x0001
+#define PUNIT_SEMAPHORE_ACQUIRE	0x0002
+
+#define SEMAPHORE_TIMEOUT_MS	500
+#define SEMAPHORE_SPIN_US	200	/* default busy-poll before sleeping */
+#define SEMAPHORE_POLL_US	2	/* busy-poll interval */
+#define SEMAPHORE_SLEEP_US	100	/* sleep interval after spinning */
+
+/* Serializes MCR/MDR/MCRX access sequences. */
+static struct mtx iosf_mbi_lock;
+MTX_SYSINIT(ig4_iosf_mbi, &iosf_mbi_lock, "IG4 IOSF MBI", MTX_SPIN);
+
+static uint32_t
+iosf_mbi_mcr(uint8_t op, uint8_t port, uint32_t offset)
+{
+	return ((uint32_t)op << 24 | (uint32_t)port << 16 |
+	    (offset & 0xFF) << 8 | IOSF_MBI_ENABLE);
+}
+
+static uint32_t
+iosf_mbi_read(uint8_t port, uint8_t op, uint32_t offset)
+{
+	uint32_t v;
+
+	mtx_lock_spin(&iosf_mbi_lock);
+	pci_cfgregwrite(0, 0, 0, IOSF_MBI_MCRX, offset & 0xFFFFFF00, 4);
+	pci_cfgregwrite(0, 0, 0, IOSF_MBI_MCR, iosf_mbi_mcr(op, port, offset),
+	    4);
+	v = pci_cfgregread(0, 0, 0, IOSF_MBI_MDR, 4);
+	mtx_unlock_spin(&iosf_mbi_lock);
+	return (v);
+}
+
+static void
+iosf_mbi_write(uint8_t port, uint8_t op, uint32_t offset, uint32_t v)
+{
+	mtx_lock_spin(&iosf_mbi_lock);
+	pci_cfgregwrite(0, 0, 0, IOSF_MBI_MDR, v, 4);
+	pci_cfgregwrite(0, 0, 0, IOSF_MBI_MCRX, offset & 0xFFFFFF00, 4);
+	pci_cfgregwrite(0, 0, 0, IOSF_MBI_MCR, iosf_mbi_mcr(op, port, offset),
+	    4);
+	mtx_unlock_spin(&iosf_mbi_lock);
+}
+
+static bool
+punit_sem_held(ig4iic_softc_t *sc)
+{
+	return ((iosf_mbi_read(IOSF_MBI_UNIT_PMC, IOSF_MBI_REG_READ,
+	    sc->bus_sem_addr) & PUNIT_SEMAPHORE_BIT) != 0);
+}
+
+static void
+punit_sem_reset(ig4iic_softc_t *sc)
+{
+	uint32_t v;
+
+	mtx_lock_spin(&iosf_mbi_lock);
+	pci_cfgregwrite(0, 0, 0, IOSF_MBI_MCRX, sc->bus_sem_addr & 0xFFFFFF00,
+	    4);
+	pci_cfgregwrite(0, 0, 0, IOSF_MBI_MCR, iosf_mbi_mcr(IOSF_MBI_REG_READ,
+	    IOSF_MBI_UNIT_PMC, sc->bus_sem_addr), 4);
+	v = pci_cfgregread(0, 0, 0, IOSF_MBI_MDR, 4);
+	v &= ~PUNIT_SEMAPHORE_BIT;
+	pci_cfgregwrite(0, 0, 0, IOSF_MBI_MDR, v, 4);
+	pci_cfgregwrite(0, 0, 0, IOSF_MBI_MCR, iosf_mbi_mcr(IOSF_MBI_REG_WRITE,
+	    IOSF_MBI_UNIT_PMC, sc->bus_sem_addr), 4);
+	mtx_unlock_spin(&iosf_mbi_lock);
+}
+
+/*
+ * Request the semaphore and wait for the PUNIT to grant it.  The PUNIT
+ * usually grants within a few microseconds, so poll busily for up to
+ * bus_sem_spin_us before falling back to sleeping, instead of paying a
+ * full scheduler round trip on every acquire.
+ */
+static int
+ig4iic_baytrail_acquire(ig4iic_softc_t *sc)
+{
+	sbintime_t deadline;
+	sbintime_t spin_end;
+	sbintime_t now;
+
+	iosf_mbi_write(IOSF_MBI_UNIT_PMC, IOSF_MBI_REG_WRITE, sc->bus_sem_addr,
+	    PUNIT_SEMAPHORE_ACQUIRE);
+
+	now = sbinuptime();
+	spin_end = now + sc->bus_sem_spin_us * SBT_1US;
+	deadline = now + SEMAPHORE_TIMEOUT_MS * SBT_1MS;
+	for (;;) {
+		if (punit_sem_held(sc))
+			return (0);
+		now = sbinuptime();
+		if (now >= deadline)
+			break;
+		if (now < spin_end || cold)
+			DELAY(SEMAPHORE_POLL_US);
+		else
+			pause_sbt("ig4sem", SEMAPHORE_SLEEP_US * SBT_1US,
+			    SEMAPHORE_SLEEP_US * SBT_1US / 2, 0);
+	}
+
+	device_printf(sc->dev, "PUNIT semaphore timed out, resetting\n");
+	punit_sem_reset(sc);
+	return (ETIMEDOUT);
+}
+
+static void
+ig4iic_baytrail_release(ig4iic_softc_t *sc)
+{
+	punit_sem_reset(sc);
+}
+
+int
+ig4iic_baytrail_setup(ig4iic_softc_t *sc, bool cherrytrail)
+{
+	sc->bus_sem_addr = cherrytrail ? PUNIT_SEMAPHORE_CHT : PUNIT_SEMAPHORE;
+	sc->bus_sem_spin_us = SEMAPHORE_SPIN_US;
+	sc->bus_acquire = ig4iic_baytrail_acquire;
+	sc->bus_release = ig4iic_baytrail_release;
+
+	SYSCTL_ADD_INT(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "bus_sem_spin_us", CTLFLAG_RW, &sc->bus_sem_spin_us, 0,
+	    "Busy-poll time for the PUNIT semaphore before sleeping");
+
+	device_printf(sc->dev, "I2C bus managed by PUNIT\n");
+	return (0);
+}
@@ -0,0 +1,63 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef _ICHIIC_IG4_CAPTURE_H_
+#define _ICHIIC_IG4_CAPTURE_H_
+
+/*
+ * Transfer capture.  Every completed ig4iic_transfer() call is appended
+ * to a buffer as one record: the header, one ig4iic_cap_msg per message
+ * and then the data of each message in order, padded to IG4_CAP_ALIGN.
+ * Reading dev.ig4iic.N.capture_buf returns the whole records that fit
+ * and removes them, so the buffer is a stream that tools/tools/ig4cap
+ * drains into a file.  Fixed-width types only, this header is shared
+ * with userland.
+ */
+struct ig4iic_cap_rec {
+	uint32_t	size;		/* whole record, padding included */
+	uint32_t	seq;		/* transfer number */
+	uint64_t	start;		/* sbinuptime() at entry */
+	uint64_t	end;		/* sbinuptime() at return */
+	int32_t		error;		/* IIC_* result */
+	uint16_t	nmsgs;
+	uint16_t	flags;
+#define IG4_CAP_DROPPED	0x0001		/* records lost before this one */
+};
+
+struct ig4iic_cap_msg {
+	uint16_t	slave;		/* as in struct iic_msg */
+	uint16_t	flags;		/* IIC_M_* */
+	uint16_t	len;		/* message length */
+	uint16_t	caplen;		/* bytes of it captured */
+};
+
+#define IG4_CAP_ALIGN		8
+#define IG4_CAP_DATA_MAX	4096		/* captured bytes per message */
+#define IG4_CAP_SIZE_MAX	(4 * 1024 * 1024) /* largest buffer */
+
+#endif /* _ICHIIC_IG4_CAPTURE_H_ */
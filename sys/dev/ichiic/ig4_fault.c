@@ -0,0 +1,199 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+/*
+ * Fault injection underneath the ig4iic register accessors, built only
+ * with IG4_FAULT defined (make IG4_FAULT=yes in the module directory).
+ *
+ * Each fault fires with a configurable probability in parts per million
+ * of its opportunities:
+ *
+ *  - fault_abort_ppm, per DATA_CMD write: the controller reports a
+ *    transmit abort with fault_abort_source in TX_ABRT_SOURCE, and as
+ *    the hardware does it holds the TX FIFO, i.e. drops further DATA_CMD
+ *    writes, until the abort is cleared.
+ *  - fault_rx_drop_ppm, per received byte seen in I2C_STA: the byte is
+ *    read and thrown away behind the driver's back.
+ *  - fault_enable_stuck_ppm, per IC_ENABLE write: ENABLE_STATUS keeps
+ *    reporting the previous state until the next IC_ENABLE write.
+ *  - fault_intr_delay_ppm, per interrupt: the handler is held off for
+ *    fault_intr_delay_us.
+ *
+ * The hooks run under io_lock, except from the interrupt filter, which
+ * reads INTR_STAT, TX_ABRT_SOURCE, I2C_STA, DATA_CMD and CLR_INTR without
+ * it.  So the injected abort is a flag that either side sets or clears
+ * atomically, as the controller's TX_ABRT bit would be, and the counters
+ * bumped from the filter's registers are atomic.  The error_hist and
+ * recovery_hist sysctls show what the faults cost.
+ */
+
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/kernel.h>
+#include <sys/lock.h>
+#include <sys/mutex.h>
+#include <sys/sx.h>
+#include <sys/bus.h>
+#include <sys/sysctl.h>
+
+#include <machine/atomic.h>
+#include <machine/bus.h>
+#include <sys/rman.h>
+
+#include <dev/iicbus/iicbus.h>
+#include <dev/iicbus/iiconf.h>
+
+#include <dev/ichiic/ig4_reg.h>
+#include <dev/ichiic/ig4_var.h>
+
+static bool
+fault_fire(u_int ppm)
+{
+	return (ppm != 0 && arc4random() % 1000000 < ppm);
+}
+
+uint32_t
+ig4iic_fault_read(ig4iic_softc_t *sc, uint32_t reg, uint32_t value)
+{
+	struct ig4iic_fault *f = &sc->fault;
+
+	switch (reg) {
+	case IG4_REG_I2C_STA:
+		if ((value & IG4_STATUS_RX_NOTEMPTY) != 0 &&
+		    fault_fire(f->rx_drop_ppm)) {
+			bus_space_read_4(sc->regs_t, sc->regs_h,
+			    IG4_REG_DATA_CMD);
+			value = bus_space_read_4(sc->regs_t, sc->regs_h,
+			    IG4_REG_I2C_STA);
+			atomic_add_64(&f->rx_drops, 1);
+		}
+		break;
+	case IG4_REG_INTR_STAT:
+	case IG4_REG_RAW_INTR_STAT:
+		if (atomic_load_int(&f->aborted) != 0)
+			value |= IG4_INTR_TX_ABRT;
+		break;
+	case IG4_REG_TX_ABRT_SOURCE:
+		if (atomic_load_int(&f->aborted) != 0)
+			value |= f->abort_source;
+		break;
+	case IG4_REG_CLR_TX_ABORT:
+	case IG4_REG_CLR_INTR:
+		atomic_store_int(&f->aborted, 0);
+		break;
+	case IG4_REG_ENABLE_STATUS:
+		if (f->enable_stuck)
+			value = (value & ~IG4_I2C_ENABLE) |
+			    (~f->enable & IG4_I2C_ENABLE);
+		break;
+	}
+	return (value);
+}
+
+bool
+ig4iic_fault_write(ig4iic_softc_t *sc, uint32_t reg, uint32_t value)
+{
+	struct ig4iic_fault *f = &sc->fault;
+
+	switch (reg) {
+	case IG4_REG_DATA_CMD:
+		if (atomic_load_int(&f->aborted) != 0)
+			return (true);
+		if (fault_fire(f->abort_ppm)) {
+			atomic_store_int(&f->aborted, 1);
+			f->aborts++;
+			return (true);
+		}
+		break;
+	case IG4_REG_I2C_EN:
+		/* Disabling the controller also clears an abort. */
+		if ((value & IG4_I2C_ENABLE) == 0)
+			atomic_store_int(&f->aborted, 0);
+		f->enable_stuck = (value & IG4_I2C_ENABLE) !=
+		    (f->enable & IG4_I2C_ENABLE) &&
+		    fault_fire(f->enable_stuck_ppm);
+		if (f->enable_stuck)
+			f->enable_stucks++;
+		f->enable = value;
+		break;
+	}
+	return (false);
+}
+
+void
+ig4iic_fault_intr(ig4iic_softc_t *sc)
+{
+	struct ig4iic_fault *f = &sc->fault;
+
+	if (fault_fire(f->intr_delay_ppm)) {
+		DELAY(f->intr_delay_us);
+		atomic_add_64(&f->intr_delays, 1);
+	}
+}
+
+void
+ig4iic_fault_attach(ig4iic_softc_t *sc)
+{
+	struct sysctl_ctx_list *ctx;
+	struct sysctl_oid_list *children;
+	struct ig4iic_fault *f = &sc->fault;
+
+	f->abort_source = IG4_ABRTSRC_TXNOACK_ADDR7;
+	f->intr_delay_us = 1000;
+
+	ctx = device_get_sysctl_ctx(sc->dev);
+	children = SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev));
+	SYSCTL_ADD_UINT(ctx, children, OID_AUTO, "fault_abort_ppm",
+	    CTLFLAG_RW, &f->abort_ppm, 0,
+	    "Injected TX aborts per million DATA_CMD writes");
+	SYSCTL_ADD_UINT(ctx, children, OID_AUTO, "fault_abort_source",
+	    CTLFLAG_RW, &f->abort_source, 0,
+	    "TX_ABRT_SOURCE bits reported for injected aborts");
+	SYSCTL_ADD_UINT(ctx, children, OID_AUTO, "fault_rx_drop_ppm",
+	    CTLFLAG_RW, &f->rx_drop_ppm, 0,
+	    "Dropped RX bytes per million received");
+	SYSCTL_ADD_UINT(ctx, children, OID_AUTO, "fault_enable_stuck_ppm",
+	    CTLFLAG_RW, &f->enable_stuck_ppm, 0,
+	    "Unsettled ENABLE_STATUS per million IC_ENABLE changes");
+	SYSCTL_ADD_UINT(ctx, children, OID_AUTO, "fault_intr_delay_ppm",
+	    CTLFLAG_RW, &f->intr_delay_ppm, 0,
+	    "Delayed interrupts per million");
+	SYSCTL_ADD_UINT(ctx, children, OID_AUTO, "fault_intr_delay_us",
+	    CTLFLAG_RW, &f->intr_delay_us, 0,
+	    "Delay of an injected late interrupt in microseconds");
+	SYSCTL_ADD_U64(ctx, children, OID_AUTO, "fault_aborts",
+	    CTLFLAG_RD, &f->aborts, 0, "Injected TX aborts");
+	SYSCTL_ADD_U64(ctx, children, OID_AUTO, "fault_rx_drops",
+	    CTLFLAG_RD, &f->rx_drops, 0, "Injected RX byte drops");
+	SYSCTL_ADD_U64(ctx, children, OID_AUTO, "fault_enable_stucks",
+	    CTLFLAG_RD, &f->enable_stucks, 0,
+	    "Injected unsettled ENABLE_STATUS");
+	SYSCTL_ADD_U64(ctx, children, OID_AUTO, "fault_intr_delays",
+	    CTLFLAG_RD, &f->intr_delays, 0, "Injected interrupt delays");
+}
@@ -48,13 +48,24 @@ __FBSDID("$FreeBSD$");
 #include <sys/kernel.h>
 #include <sys/module.h>
 #include <sys/errno.h>
+#include <sys/limits.h>
 #include <sys/lock.h>
+#include <sys/malloc.h>
 #include <sys/mutex.h>
 #include <sys/sx.h>
 #include <sys/syslog.h>
 #include <sys/bus.h>
+#include <sys/counter.h>
+#include <sys/sbuf.h>
 #include <sys/sysctl.h>
-
+#include <sys/time.h>
+#include <sys/proc.h>
+#include <sys/sched.h>
+#include <sys/smp.h>
+#include <sys/taskqueue.h>
+
+#include <machine/atomic.h>
+#include <machine/cpu.h>
 #include <machine/bus.h>
 #include <sys/rman.h>
 
@@ -70,7 +81,13 @@ __FBSDID("$FreeBSD$");
 #define TRANS_PCALL	2
 #define TRANS_BLOCK	3
 
+#define IG4_IDLE_DELAY_MS	2000	/* default runtime idle delay */
+#define IG4_LTR_ACTIVE_US	50	/* default LTR during transfers */
+#define IG4_SPIN_MAX_US		200	/* default limit on polled transfers */
+#define IG4_SPIN_POLL_US	2	/* poll interval */
+
 static void ig4iic_start(void *xdev);
+static int ig4iic_filter(void *cookie);
 static void ig4iic_intr(void *cookie);
 static void ig4iic_dump(ig4iic_softc_t *sc);
 
@@ -78,26 +95,167 @@ static int ig4_dump;
 SYSCTL_INT(_debug, OID_AUTO, ig4_dump, CTLFLAG_RW,
 	   &ig4_dump, 0, "Dump controller registers");
 
+/*
+ * Record a register access in the trace ring.  Writers claim a slot with
+ * an atomic increment and publish it by storing the sequence number last,
+ * so a reader can tell overwritten or half-written slots apart.
+ */
+static __noinline void
+reg_trace(ig4iic_softc_t *sc, uint32_t reg, uint32_t value, uint16_t flags)
+{
+	struct ig4iic_trace_ent *ring, *e;
+	u_int seq;
+
+	/* The filter may race with tracing being turned off. */
+	ring = (struct ig4iic_trace_ent *)atomic_load_acq_ptr(
+	    (volatile uintptr_t *)&sc->trace);
+	if (ring == NULL)
+		return;
+	seq = atomic_fetchadd_int(&sc->trace_head, 1);
+	e = &ring[seq & (sc->trace_entries - 1)];
+	e->sbt = sbinuptime();
+	e->reg = reg;
+	e->value = value;
+	e->cpu = curcpu;
+	e->flags = flags;
+	atomic_store_rel_32(&e->seq, seq);
+}
+
 /*
  * Low-level inline support functions
+ *
+ * Register accesses are relaxed.  The controller sits behind uncached
+ * MMIO, so accesses to it are not reordered among themselves; explicit
+ * barriers (reg_barrier) are only issued where the DesignWare databook
+ * requires earlier writes to have reached the controller, namely around
+ * IC_ENABLE and the LPSS reset sequence.
  */
+static __inline bus_space_handle_t
+reg_handle(ig4iic_softc_t *sc, uint32_t *reg)
+{
+	if (*reg >= IG4_REG_PRIV_BASE) {
+		*reg -= IG4_REG_PRIV_BASE;
+		return (sc->priv_h);
+	}
+	return (sc->regs_h);
+}
+
 static __inline void
 reg_write(ig4iic_softc_t *sc, uint32_t reg, uint32_t value)
 {
-	bus_write_4(sc->regs_res, reg, value);
-	bus_barrier(sc->regs_res, reg, 4, BUS_SPACE_BARRIER_WRITE);
+	bus_space_handle_t h;
+	uint32_t off;
+
+#ifdef IG4_FAULT
+	if (ig4iic_fault_write(sc, reg, value))
+		return;
+#endif
+	off = reg;
+	h = reg_handle(sc, &off);
+	bus_space_write_4(sc->regs_t, h, off, value);
+	counter_u64_add(sc->mmio_ops, 1);
+	if (__predict_false(sc->trace != NULL))
+		reg_trace(sc, reg, value, IG4_TRACE_WRITE);
 }
 
 static __inline uint32_t
 reg_read(ig4iic_softc_t *sc, uint32_t reg)
 {
+	bus_space_handle_t h;
+	uint32_t off;
 	uint32_t value;
 
-	bus_barrier(sc->regs_res, reg, 4, BUS_SPACE_BARRIER_READ);
-	value = bus_read_4(sc->regs_res, reg);
+	off = reg;
+	h = reg_handle(sc, &off);
+	value = bus_space_read_4(sc->regs_t, h, off);
+#ifdef IG4_FAULT
+	value = ig4iic_fault_read(sc, reg, value);
+#endif
+	counter_u64_add(sc->mmio_ops, 1);
+	if (__predict_false(sc->trace != NULL))
+		reg_trace(sc, reg, value, 0);
 	return (value);
 }
 
+static __inline void
+reg_barrier(ig4iic_softc_t *sc, uint32_t reg, int flags)
+{
+	bus_space_handle_t h;
+
+	h = reg_handle(sc, &reg);
+	bus_space_barrier(sc->regs_t, h, reg, 4, flags);
+}
+
+/*
+ * Configuration registers that only the driver changes are shadowed in
+ * sc->ctx.  They are never read back from the controller and writes
+ * that would not change them are skipped.  The shadow is write-through;
+ * when the controller lost its context restore_context() writes all of
+ * it back unconditionally.
+ */
+static uint32_t *
+reg_shadow(ig4iic_softc_t *sc, uint32_t reg)
+{
+	switch (reg) {
+	case IG4_REG_CTL:
+		return (&sc->ctx.ctl);
+	case IG4_REG_TAR_ADD:
+		return (&sc->ctx.tar_add);
+	case IG4_REG_SS_SCL_HCNT:
+		return (&sc->ctx.ss_scl_hcnt);
+	case IG4_REG_SS_SCL_LCNT:
+		return (&sc->ctx.ss_scl_lcnt);
+	case IG4_REG_FS_SCL_HCNT:
+		return (&sc->ctx.fs_scl_hcnt);
+	case IG4_REG_FS_SCL_LCNT:
+		return (&sc->ctx.fs_scl_lcnt);
+	case IG4_REG_SDA_HOLD:
+		return (&sc->ctx.sda_hold);
+	case IG4_REG_RX_TL:
+		return (&sc->ctx.rx_tl);
+	case IG4_REG_TX_TL:
+		return (&sc->ctx.tx_tl);
+	case IG4_REG_INTR_MASK:
+		return (&sc->ctx.intr_mask);
+	default:
+		return (NULL);
+	}
+}
+
+static __inline uint32_t
+shadow_read(ig4iic_softc_t *sc, uint32_t reg)
+{
+	return (*reg_shadow(sc, reg));
+}
+
+static __inline void
+shadow_write(ig4iic_softc_t *sc, uint32_t reg, uint32_t value)
+{
+	uint32_t *shadow;
+
+	shadow = reg_shadow(sc, reg);
+	if (*shadow == value)
+		return;
+	*shadow = value;
+	reg_write(sc, reg, value);
+}
+
+/* Fill the shadows from the controller, once at attach. */
+static void
+shadow_load(ig4iic_softc_t *sc)
+{
+	static const uint32_t regs[] = {
+		IG4_REG_CTL, IG4_REG_TAR_ADD, IG4_REG_SS_SCL_HCNT,
+		IG4_REG_SS_SCL_LCNT, IG4_REG_FS_SCL_HCNT, IG4_REG_FS_SCL_LCNT,
+		IG4_REG_SDA_HOLD, IG4_REG_RX_TL, IG4_REG_TX_TL,
+		IG4_REG_INTR_MASK,
+	};
+	u_int i;
+
+	for (i = 0; i < nitems(regs); i++)
+		*reg_shadow(sc, regs[i]) = reg_read(sc, regs[i]);
+}
+
 /*
  * Enable or disable the controller and wait for the controller to acknowledge
  * the state change.
@@ -110,17 +268,27 @@ set_controller(ig4iic_softc_t *sc, uint32_t ctl)
 	uint32_t v;
 
 	/*
-	 * When the controller is enabled, interrupt on STOP detect
-	 * or receive character ready and clear pending interrupts.
+	 * When the controller is enabled, interrupt on STOP detect,
+	 * receive character ready or transmit abort and clear pending
+	 * interrupts.
 	 */
 	if (ctl & IG4_I2C_ENABLE) {
-		reg_write(sc, IG4_REG_INTR_MASK, IG4_INTR_STOP_DET |
-						 IG4_INTR_RX_FULL);
+		shadow_write(sc, IG4_REG_INTR_MASK, IG4_INTR_STOP_DET |
+						    IG4_INTR_RX_FULL |
+						    IG4_INTR_TX_ABRT);
 		reg_read(sc, IG4_REG_CLR_INTR);
 	} else
-		reg_write(sc, IG4_REG_INTR_MASK, 0);
+		shadow_write(sc, IG4_REG_INTR_MASK, 0);
 
+	/*
+	 * The configuration registers must be settled before IC_ENABLE
+	 * changes, and the change must be posted before ENABLE_STATUS is
+	 * polled.
+	 */
+	reg_barrier(sc, IG4_REG_I2C_EN, BUS_SPACE_BARRIER_WRITE);
 	reg_write(sc, IG4_REG_I2C_EN, ctl);
+	reg_barrier(sc, IG4_REG_I2C_EN, BUS_SPACE_BARRIER_READ |
+	    BUS_SPACE_BARRIER_WRITE);
 	error = IIC_ETIMEOUT;
 
 	for (retry = 100; retry > 0; --retry) {
@@ -129,20 +297,122 @@ set_controller(ig4iic_softc_t *sc, uint32_t ctl)
 			error = 0;
 			break;
 		}
+		/*
+		 * ENABLE_STATUS changes raise no interrupt and nothing
+		 * wakes up this channel, it is a timed poll.
+		 */
 		if (cold)
 			DELAY(1000);
-		else
-			mtx_sleep(sc, &sc->io_lock, 0, "i2cslv", 1);
+		else if (mtx_sleep(sc, &sc->io_lock, 0, "i2cslv", 1) == 0) {
+			sc->wakeups++;
+			sc->wakeups_spurious++;
+		}
 	}
 	return (error);
 }
 
 /*
- * Wait up to 25ms for the requested status using a 25uS polling loop.
+ * Receive ring, see ig4_var.h.
+ */
+static __inline bool
+rx_pending(ig4iic_softc_t *sc)
+{
+	return (atomic_load_acq_int(&sc->rnext) != sc->rpos);
+}
+
+/*
+ * What a transfer thread sleeping on rx_wait waits for.
+ */
+static __inline bool
+rx_wait_done(ig4iic_softc_t *sc)
+{
+	return (rx_pending(sc) || atomic_load_acq_int(&sc->rx_aborted) != 0);
+}
+
+static int
+abort_error(uint32_t source)
+{
+	if (source & (IG4_ABRTSRC_TXNOACK_ADDR7 | IG4_ABRTSRC_TXNOACK_ADDR10_1 |
+	    IG4_ABRTSRC_TXNOACK_ADDR10_2 | IG4_ABRTSRC_TXNOACK_DATA))
+		return (IIC_ENOACK);
+	return (IIC_EBUSERR);
+}
+
+/*
+ * Move received bytes from the RX FIFO into the ring, as far as it has
+ * room.  If the other side is already filling it is asked to go around
+ * once more instead of waited for.  Registers of a function in D3 read
+ * as all ones, which ends the loop too.
+ */
+static void
+rx_fill(ig4iic_softc_t *sc)
+{
+	uint32_t status;
+	u_int rnext;
+
+	atomic_store_int(&sc->rx_again, 1);
+	for (;;) {
+		/*
+		 * Either the filler sees our rx_again after dropping
+		 * rx_filling, or we see rx_filling dropped.
+		 */
+		atomic_thread_fence_seq_cst();
+		if (atomic_load_int(&sc->rx_again) == 0 ||
+		    atomic_cmpset_acq_int(&sc->rx_filling, 0, 1) == 0)
+			return;
+		atomic_store_int(&sc->rx_again, 0);
+		rnext = sc->rnext;
+		status = reg_read(sc, IG4_REG_I2C_STA);
+		while ((status & IG4_STATUS_RX_NOTEMPTY) != 0 &&
+		    status != 0xffffffff &&
+		    rnext - atomic_load_acq_int(&sc->rpos) < IG4_RBUFSIZE) {
+			sc->rbuf[rnext & IG4_RBUFMASK] =
+			    (uint8_t)reg_read(sc, IG4_REG_DATA_CMD);
+			atomic_store_rel_int(&sc->rnext, ++rnext);
+			status = reg_read(sc, IG4_REG_I2C_STA);
+		}
+		atomic_store_rel_int(&sc->rx_filling, 0);
+	}
+}
+
+/*
+ * Sleep up to 10ms for the filter to bring data or an abort, and return
+ * the time actually slept in microseconds.  Every such interrupt wakes
+ * us up, so charging the full 10ms would time a read out after a few of
+ * them.  The fence pairs with the one in filter_intr(): either we see
+ * what it published or it sees rx_wait and has the ithread wake us
+ * through io_lock.
+ */
+static u_int
+rx_sleep(ig4iic_softc_t *sc)
+{
+	sbintime_t t;
+
+	t = sbinuptime();
+	atomic_store_int(&sc->rx_wait, 1);
+	atomic_thread_fence_seq_cst();
+	if (!rx_wait_done(sc) &&
+	    mtx_sleep(__DEVOLATILE(void *, &sc->rx_wait), &sc->io_lock, 0,
+	    "i2cwait", (hz + 99) / 100) == 0) {
+		sc->wakeups++;
+		if (!rx_wait_done(sc))
+			sc->wakeups_spurious++;
+	}
+	atomic_store_int(&sc->rx_wait, 0);
+	return ((sbinuptime() - t) / SBT_1US + 1);
+}
+
+/*
+ * Wait up to 25ms for the requested status.  TX conditions are polled
+ * every 25us.  Read data is taken from the ring: a short transfer polls
+ * for it until spin_until (see spin_start()), then, like a longer one,
+ * sleeps until the filter brings data or an abort.  Only the time
+ * actually spent counts against the 25ms.
  */
 static int
 wait_status(ig4iic_softc_t *sc, uint32_t status)
 {
+	sbintime_t now, spun_from;
 	uint32_t v;
 	int error;
 	int txlvl = -1;
@@ -150,23 +420,33 @@ wait_status(ig4iic_softc_t *sc, uint32_t status)
 	u_int limit_us = 25000; /* 25ms */
 
 	error = IIC_ETIMEOUT;
+	spun_from = 0;
 
 	for (;;) {
 		/*
-		 * Check requested status
-		 */
-		v = reg_read(sc, IG4_REG_I2C_STA);
-		if (v & status) {
-			error = 0;
-			break;
-		}
-
-		/*
-		 * When waiting for receive data break-out if the interrupt
-		 * loaded data into the FIFO.
+		 * Received data is only taken from the ring.  Move what the
+		 * interrupt has not picked up yet before checking it.
 		 */
 		if (status & IG4_STATUS_RX_NOTEMPTY) {
-			if (sc->rpos != sc->rnext) {
+			if (!rx_pending(sc))
+				rx_fill(sc);
+			if (rx_pending(sc)) {
+				error = 0;
+				break;
+			}
+			/* The transfer died, the data will never come. */
+			if (atomic_load_acq_int(&sc->rx_aborted) != 0) {
+				error = abort_error(sc->rx_abort_source);
+				break;
+			}
+		} else {
+			/* Nor will room in a FIFO the abort has flushed. */
+			if (atomic_load_acq_int(&sc->rx_aborted) != 0) {
+				error = abort_error(sc->rx_abort_source);
+				break;
+			}
+			v = reg_read(sc, IG4_REG_I2C_STA);
+			if (v & status) {
 				error = 0;
 				break;
 			}
@@ -196,9 +476,31 @@ wait_status(ig4iic_softc_t *sc, uint32_t status)
 		 * work, otherwise poll with the lock held.
 		 */
 		if (status & IG4_STATUS_RX_NOTEMPTY) {
-			mtx_sleep(sc, &sc->io_lock, 0, "i2cwait",
-				  (hz + 99) / 100); /* sleep up to 10ms */
-			count_us += 10000;
+			/*
+			 * A short transfer polls while its estimated bus
+			 * time lasts, see spin_start().  The ring and the
+			 * abort flag need no lock, so io_lock is dropped
+			 * between polls as it is while sleeping; an ithread
+			 * doing the INTR_MASK workaround is not kept waiting.
+			 * Getting the lock back can take longer than the
+			 * DELAY(), so the time spun is measured.
+			 */
+			if (sc->spin_until != 0) {
+				now = sbinuptime();
+				if (spun_from == 0)
+					spun_from = now;
+				if (now < sc->spin_until) {
+					mtx_unlock(&sc->io_lock);
+					DELAY(IG4_SPIN_POLL_US);
+					mtx_lock(&sc->io_lock);
+					count_us = (sbinuptime() - spun_from) /
+					    SBT_1US;
+					continue;
+				}
+				sc->spin_until = 0;
+			}
+
+			count_us += rx_sleep(sc);
 		} else {
 			DELAY(25);
 			count_us += 25;
@@ -209,21 +511,17 @@ wait_status(ig4iic_softc_t *sc, uint32_t status)
 }
 
 /*
- * Read I2C data.  The data might have already been read by
- * the interrupt code, otherwise it is sitting in the data
- * register.
+ * Read I2C data.  wait_status() has seen the byte in the ring.
  */
 static uint8_t
 data_read(ig4iic_softc_t *sc)
 {
+	u_int rpos;
 	uint8_t c;
 
-	if (sc->rpos == sc->rnext) {
-		c = (uint8_t)reg_read(sc, IG4_REG_DATA_CMD);
-	} else {
-		c = sc->rbuf[sc->rpos & IG4_RBUFMASK];
-		++sc->rpos;
-	}
+	rpos = sc->rpos;
+	c = sc->rbuf[rpos & IG4_RBUFMASK];
+	atomic_store_rel_int(&sc->rpos, rpos + 1);
 	return (c);
 }
 
@@ -268,7 +566,7 @@ set_slave_addr(ig4iic_softc_t *sc, uint8_t slave)
 	wait_status(sc, IG4_STATUS_TX_EMPTY);
 
 	set_controller(sc, 0);
-	ctl = reg_read(sc, IG4_REG_CTL);
+	ctl = shadow_read(sc, IG4_REG_CTL);
 	ctl &= ~IG4_CTL_10BIT;
 	ctl |= IG4_CTL_RESTARTEN;
 
@@ -277,13 +575,564 @@ set_slave_addr(ig4iic_softc_t *sc, uint8_t slave)
 		tar |= IG4_TAR_10BIT;
 		ctl |= IG4_CTL_10BIT;
 	}
-	reg_write(sc, IG4_REG_CTL, ctl);
-	reg_write(sc, IG4_REG_TAR_ADD, tar);
+	shadow_write(sc, IG4_REG_CTL, ctl);
+	shadow_write(sc, IG4_REG_TAR_ADD, tar);
 	set_controller(sc, IG4_I2C_ENABLE);
 	sc->slave_valid = 1;
 	sc->last_slave = slave;
 }
 
+/*
+ * Skylake controllers lose their state in D3 and flag that through
+ * DEVIDLE_CTRL.  Bring such a controller out of idle and reset.
+ */
+static bool
+restore_required(ig4iic_softc_t *sc)
+{
+	uint32_t v;
+
+	if (sc->priv_ops != NULL)
+		return (sc->priv_ops->restore_required(sc));
+	if (sc->version != IG4_SKYLAKE)
+		return (false);
+	v = reg_read(sc, IG4_REG_DEVIDLE_CTRL);
+	if ((v & IG4_RESTORE_REQUIRED) == 0)
+		return (false);
+
+	reg_write(sc, IG4_REG_DEVIDLE_CTRL, IG4_DEVICE_IDLE | IG4_RESTORE_REQUIRED);
+	reg_write(sc, IG4_REG_DEVIDLE_CTRL, 0);
+
+	reg_write(sc, IG4_REG_RESETS_SKL, IG4_RESETS_ASSERT_SKL);
+	reg_write(sc, IG4_REG_RESETS_SKL, IG4_RESETS_DEASSERT_SKL);
+	reg_barrier(sc, IG4_REG_RESETS_SKL, BUS_SPACE_BARRIER_WRITE);
+	DELAY(1000);
+	return (true);
+}
+
+static void
+set_devidle(ig4iic_softc_t *sc, bool idle)
+{
+	if (sc->priv_ops != NULL)
+		sc->priv_ops->set_idle(sc, idle);
+	else if (sc->version == IG4_SKYLAKE)
+		reg_write(sc, IG4_REG_DEVIDLE_CTRL, idle ? IG4_DEVICE_IDLE : 0);
+}
+
+/*
+ * Save/restore the registers programmed by the driver.  The controller
+ * must be disabled for the restore, most of them are read-only while
+ * it is enabled.  Only the registers without a shadow (see reg_shadow())
+ * have to be read on save.
+ */
+static void
+save_context(ig4iic_softc_t *sc, struct ig4iic_ctx *ctx)
+{
+	if (sc->version == IG4_HASWELL || sc->version == IG4_ATOM)
+		ctx->general = reg_read(sc, IG4_REG_GENERAL);
+	if (sc->version == IG4_HASWELL)
+		ctx->sw_ltr = reg_read(sc, IG4_REG_SW_LTR_VALUE);
+	if (sc->version == IG4_SKYLAKE && sc->priv_ops == NULL) {
+		ctx->active_ltr = reg_read(sc, IG4_REG_ACTIVE_LTR_VALUE);
+		ctx->idle_ltr = reg_read(sc, IG4_REG_IDLE_LTR_VALUE);
+	}
+}
+
+static void
+restore_context(ig4iic_softc_t *sc, const struct ig4iic_ctx *ctx)
+{
+	if (sc->version == IG4_HASWELL || sc->version == IG4_ATOM)
+		reg_write(sc, IG4_REG_GENERAL, ctx->general);
+	if (sc->version == IG4_HASWELL)
+		reg_write(sc, IG4_REG_SW_LTR_VALUE, ctx->sw_ltr);
+	if (sc->version == IG4_SKYLAKE && sc->priv_ops == NULL) {
+		reg_write(sc, IG4_REG_ACTIVE_LTR_VALUE, ctx->active_ltr);
+		reg_write(sc, IG4_REG_IDLE_LTR_VALUE, ctx->idle_ltr);
+	}
+	reg_write(sc, IG4_REG_CTL, ctx->ctl);
+	reg_write(sc, IG4_REG_TAR_ADD, ctx->tar_add);
+	reg_write(sc, IG4_REG_SS_SCL_HCNT, ctx->ss_scl_hcnt);
+	reg_write(sc, IG4_REG_SS_SCL_LCNT, ctx->ss_scl_lcnt);
+	reg_write(sc, IG4_REG_FS_SCL_HCNT, ctx->fs_scl_hcnt);
+	reg_write(sc, IG4_REG_FS_SCL_LCNT, ctx->fs_scl_lcnt);
+	reg_write(sc, IG4_REG_SDA_HOLD, ctx->sda_hold);
+	reg_write(sc, IG4_REG_RX_TL, ctx->rx_tl);
+	reg_write(sc, IG4_REG_TX_TL, ctx->tx_tl);
+	reg_write(sc, IG4_REG_INTR_MASK, ctx->intr_mask);
+}
+
+/*
+ * Runtime idle.  After idle_delay_ms without transfers the controller is
+ * disabled and, on Skylake, put into device idle; with idle_d3 a direct
+ * PCI function also goes to D3.  The next transfer wakes it up, writing
+ * back the cached context only if the controller actually lost it.
+ */
+static void
+idle_schedule(ig4iic_softc_t *sc, sbintime_t delay)
+{
+	if (sc->idle_delay_ms <= 0 || sc->idle_pending)
+		return;
+	sc->idle_pending = 1;
+	taskqueue_enqueue_timeout_sbt(taskqueue_thread, &sc->idle_task,
+	    delay, delay / 8, 0);
+}
+
+static void
+idle_enter(ig4iic_softc_t *sc)
+{
+	mtx_lock(&sc->io_lock);
+	save_context(sc, &sc->ctx);
+	set_controller(sc, 0);
+	set_devidle(sc, true);
+	sc->rpm_idle = 1;
+	if (sc->idle_d3 && sc->pci_pm)
+		sc->rpm_d3 = 1;
+	mtx_unlock(&sc->io_lock);
+
+	if (sc->rpm_d3) {
+		pci_save_state(sc->dev);
+		pci_set_powerstate(sc->dev, PCI_POWERSTATE_D3);
+	}
+	sc->idle_start = sbinuptime();
+	sc->idle_count++;
+}
+
+static void
+idle_wake(ig4iic_softc_t *sc)
+{
+	sbintime_t start, t;
+	bool lost;
+
+	start = sbinuptime();
+	sc->idle_time_ms += sbttoms(start - sc->idle_start);
+	lost = false;
+	if (sc->rpm_d3) {
+		pci_set_powerstate(sc->dev, PCI_POWERSTATE_D0);
+		pci_restore_state(sc->dev);
+		lost = true;
+	}
+
+	mtx_lock(&sc->io_lock);
+	sc->rpm_d3 = 0;
+	if (restore_required(sc))
+		lost = true;
+	else
+		set_devidle(sc, false);
+	if (lost || reg_read(sc, IG4_REG_CTL) != sc->ctx.ctl)
+		restore_context(sc, &sc->ctx);
+	set_controller(sc, IG4_I2C_ENABLE);
+	sc->rpm_idle = 0;
+	mtx_unlock(&sc->io_lock);
+
+	t = sbinuptime() - start;
+	sc->wake_us = sbttous(t);
+	ig4iic_hist_add(&sc->wake_hist, t);
+}
+
+static void
+ig4iic_idle_task(void *arg, int pending)
+{
+	ig4iic_softc_t *sc = arg;
+	sbintime_t remain;
+
+	sx_xlock(&sc->call_lock);
+	sc->idle_pending = 0;
+	if (sc->idle_delay_ms > 0 && !sc->rpm_idle && !sc->suspended &&
+	    sc->iicbus != NULL) {
+		remain = sc->last_active + sc->idle_delay_ms * SBT_1MS -
+		    sbinuptime();
+		if (remain > 0)
+			idle_schedule(sc, remain);
+		else
+			idle_enter(sc);
+	}
+	sx_xunlock(&sc->call_lock);
+}
+
+static int
+ig4iic_sysctl_idle_delay(SYSCTL_HANDLER_ARGS)
+{
+	ig4iic_softc_t *sc = arg1;
+	int error;
+	int ms;
+
+	ms = sc->idle_delay_ms;
+	error = sysctl_handle_int(oidp, &ms, 0, req);
+	if (error != 0 || req->newptr == NULL)
+		return (error);
+	if (ms > 0 && sc->bus_acquire != NULL)
+		return (EINVAL);
+	sx_xlock(&sc->call_lock);
+	sc->idle_delay_ms = ms;
+	if (ms > 0)
+		idle_schedule(sc, ms * SBT_1MS);
+	sx_xunlock(&sc->call_lock);
+	return (0);
+}
+
+/*
+ * Register access trace.  Writing trace_entries (rounded up to a power
+ * of two, 0 turns tracing off) replaces the ring, trace_buf returns its
+ * valid records oldest first.
+ */
+static int
+ig4iic_sysctl_trace_entries(SYSCTL_HANDLER_ARGS)
+{
+	ig4iic_softc_t *sc = arg1;
+	struct ig4iic_trace_ent *new, *old;
+	u_int n;
+	int error;
+
+	n = sc->trace_entries;
+	error = sysctl_handle_int(oidp, &n, 0, req);
+	if (error != 0 || req->newptr == NULL)
+		return (error);
+	if (n > IG4_TRACE_MAX)
+		return (EINVAL);
+	if (n != 0 && !powerof2(n))
+		n = 1u << fls(n);
+
+	new = NULL;
+	if (n != 0)
+		new = malloc(n * sizeof(*new), M_DEVBUF, M_WAITOK | M_ZERO);
+	sx_xlock(&sc->call_lock);
+	mtx_lock(&sc->io_lock);
+	old = sc->trace;
+	atomic_store_rel_ptr((volatile uintptr_t *)&sc->trace, 0);
+	/*
+	 * The filter does not take io_lock.  Once it is not running, it
+	 * sees the ring gone, see ig4iic_filter().
+	 */
+	atomic_thread_fence_seq_cst();
+	while (atomic_load_acq_int(&sc->filter_busy) != 0)
+		cpu_spinwait();
+	sc->trace_entries = n;
+	sc->trace_head = 0;
+	/* Slot 0 is claimed first, make it look unwritten until then. */
+	if (new != NULL)
+		new[0].seq = UINT32_MAX;
+	atomic_store_rel_ptr((volatile uintptr_t *)&sc->trace,
+	    (uintptr_t)new);
+	mtx_unlock(&sc->io_lock);
+	sx_xunlock(&sc->call_lock);
+	free(old, M_DEVBUF);
+	return (0);
+}
+
+static int
+ig4iic_sysctl_trace_buf(SYSCTL_HANDLER_ARGS)
+{
+	ig4iic_softc_t *sc = arg1;
+	struct ig4iic_trace_ent *buf, *e;
+	u_int head, i, n, seq;
+	int error;
+
+	sx_xlock(&sc->call_lock);
+	if (sc->trace == NULL) {
+		sx_xunlock(&sc->call_lock);
+		return (SYSCTL_OUT(req, NULL, 0));
+	}
+	buf = malloc(sc->trace_entries * sizeof(*buf), M_DEVBUF, M_WAITOK);
+	mtx_lock(&sc->io_lock);
+	head = sc->trace_head;
+	n = min(head, sc->trace_entries);
+	for (i = 0; i < n; i++) {
+		seq = head - n + i;
+		e = &sc->trace[seq & (sc->trace_entries - 1)];
+		if (atomic_load_acq_32(&e->seq) != seq)
+			break;
+		buf[i] = *e;
+	}
+	mtx_unlock(&sc->io_lock);
+	sx_xunlock(&sc->call_lock);
+
+	error = SYSCTL_OUT(req, buf, i * sizeof(*buf));
+	free(buf, M_DEVBUF);
+	return (error);
+}
+
+/*
+ * Append a completed transfer to the capture buffer, or count it as
+ * dropped if it does not fit.  Called with call_lock held.
+ */
+static void
+ig4iic_capture(ig4iic_softc_t *sc, struct iic_msg *msgs, uint32_t nmsgs,
+    sbintime_t start, sbintime_t end, int error)
+{
+	struct ig4iic_cap_rec *rec;
+	struct ig4iic_cap_msg *cm;
+	uint8_t *p;
+	size_t size;
+	uint32_t i;
+
+	size = sizeof(*rec) + nmsgs * sizeof(*cm);
+	for (i = 0; i < nmsgs; i++)
+		size += min(msgs[i].len, IG4_CAP_DATA_MAX);
+	size = roundup2(size, IG4_CAP_ALIGN);
+	if (size > sc->cap_size - sc->cap_len) {
+		sc->cap_seq++;
+		sc->cap_drops++;
+		sc->cap_dropped = true;
+		return;
+	}
+
+	rec = (struct ig4iic_cap_rec *)(sc->cap_buf + sc->cap_len);
+	rec->size = size;
+	rec->seq = sc->cap_seq++;
+	rec->start = start;
+	rec->end = end;
+	rec->error = error;
+	rec->nmsgs = nmsgs;
+	rec->flags = sc->cap_dropped ? IG4_CAP_DROPPED : 0;
+	sc->cap_dropped = false;
+	cm = (struct ig4iic_cap_msg *)(rec + 1);
+	p = (uint8_t *)(cm + nmsgs);
+	for (i = 0; i < nmsgs; i++) {
+		cm[i].slave = msgs[i].slave;
+		cm[i].flags = msgs[i].flags;
+		cm[i].len = msgs[i].len;
+		cm[i].caplen = min(msgs[i].len, IG4_CAP_DATA_MAX);
+		memcpy(p, msgs[i].buf, cm[i].caplen);
+		p += cm[i].caplen;
+	}
+	memset(p, 0, (uint8_t *)rec + size - p);
+	sc->cap_len += size;
+}
+
+/*
+ * Writing capture_size (bytes, 0 turns capturing off) replaces the
+ * buffer and discards what it held.
+ */
+static int
+ig4iic_sysctl_capture_size(SYSCTL_HANDLER_ARGS)
+{
+	ig4iic_softc_t *sc = arg1;
+	uint8_t *new, *old;
+	u_int n;
+	int error;
+
+	n = sc->cap_size;
+	error = sysctl_handle_int(oidp, &n, 0, req);
+	if (error != 0 || req->newptr == NULL)
+		return (error);
+	if (n > IG4_CAP_SIZE_MAX)
+		return (EINVAL);
+
+	new = NULL;
+	if (n != 0)
+		new = malloc(n, M_DEVBUF, M_WAITOK);
+	sx_xlock(&sc->call_lock);
+	old = sc->cap_buf;
+	sc->cap_buf = new;
+	sc->cap_size = n;
+	sc->cap_len = 0;
+	sc->cap_dropped = false;
+	sx_xunlock(&sc->call_lock);
+	free(old, M_DEVBUF);
+	return (0);
+}
+
+/*
+ * Hand out the oldest records that fit in the caller's buffer and
+ * remove them.  A size probe (no buffer) reports everything pending.
+ */
+static int
+ig4iic_sysctl_capture_buf(SYSCTL_HANDLER_ARGS)
+{
+	ig4iic_softc_t *sc = arg1;
+	struct ig4iic_cap_rec *rec;
+	uint8_t *buf;
+	u_int len;
+	int error;
+
+	sx_xlock(&sc->call_lock);
+	if (req->oldptr == NULL || sc->cap_len == 0) {
+		len = sc->cap_len;
+		sx_xunlock(&sc->call_lock);
+		return (SYSCTL_OUT(req, NULL, len));
+	}
+	for (len = 0; len < sc->cap_len; len += rec->size) {
+		rec = (struct ig4iic_cap_rec *)(sc->cap_buf + len);
+		if (len + rec->size > req->oldlen)
+			break;
+	}
+	if (len == 0) {
+		sx_xunlock(&sc->call_lock);
+		return (ENOMEM);
+	}
+	buf = malloc(len, M_DEVBUF, M_WAITOK);
+	memcpy(buf, sc->cap_buf, len);
+	memmove(sc->cap_buf, sc->cap_buf + len, sc->cap_len - len);
+	sc->cap_len -= len;
+	sx_xunlock(&sc->call_lock);
+
+	error = SYSCTL_OUT(req, buf, len);
+	free(buf, M_DEVBUF);
+	return (error);
+}
+
+/*
+ * Latency tolerance reporting.  A tight tolerance keeps the package out
+ * of deep C-states while a transfer is in flight, so the interrupt
+ * latency does not grow by hundreds of microseconds mid-transfer.
+ */
+static uint32_t
+ltr_encode(int us)
+{
+	if (us < 0)
+		return (0);
+	if (us > IG4_SWLTR_SNOOP_VALUE_MAX)
+		return (IG4_SWLTR_SNOOP_REQ | IG4_SWLTR_SNOOP_SCALE_32US |
+		    min(us >> 5, IG4_SWLTR_SNOOP_VALUE_MAX));
+	return (IG4_SWLTR_SNOOP_REQ | IG4_SWLTR_SNOOP_SCALE_1US | us);
+}
+
+static void
+set_ltr(ig4iic_softc_t *sc, int us)
+{
+	uint32_t v;
+
+	if (us == sc->ltr_cur)
+		return;
+	sc->ltr_cur = us;
+	if (sc->priv_ops != NULL) {
+		sc->priv_ops->set_ltr(sc, us);
+	} else if (sc->version == IG4_SKYLAKE) {
+		v = ltr_encode(us);
+		reg_write(sc, IG4_REG_ACTIVE_LTR_VALUE, v);
+		reg_write(sc, IG4_REG_IDLE_LTR_VALUE, v);
+	} else if (sc->version == IG4_HASWELL) {
+		/* Attach switched the controller to SW LTR mode. */
+		reg_write(sc, IG4_REG_SW_LTR_VALUE, ltr_encode(us));
+	}
+}
+
+static int
+ig4iic_sysctl_ltr(SYSCTL_HANDLER_ARGS)
+{
+	ig4iic_softc_t *sc = arg1;
+	int *valp;
+	int error;
+	int us;
+
+	valp = arg2 ? &sc->ltr_active_us : &sc->ltr_idle_us;
+	us = *valp;
+	error = sysctl_handle_int(oidp, &us, 0, req);
+	if (error != 0 || req->newptr == NULL)
+		return (error);
+	if (us < IG4_LTR_NONE)
+		return (EINVAL);
+	sx_xlock(&sc->call_lock);
+	*valp = us;
+	if (!sc->rpm_idle) {
+		mtx_lock(&sc->io_lock);
+		set_ltr(sc, sc->ltr_idle_us);
+		mtx_unlock(&sc->io_lock);
+	}
+	sx_xunlock(&sc->call_lock);
+	return (0);
+}
+
+/*
+ * Acquire/release the bus from platform firmware sharing it, if any.
+ * The firmware needs the bus for its own power management, so it is
+ * only held for the duration of one controller operation.
+ */
+static int
+acquire_bus(ig4iic_softc_t *sc)
+{
+	sbintime_t start;
+	int error;
+
+	if (sc->bus_acquire == NULL)
+		return (0);
+
+	start = sbinuptime();
+	error = sc->bus_acquire(sc);
+	if (error == 0) {
+		sc->bus_acquired = sbinuptime();
+		ig4iic_hist_add(&sc->bus_acquire_hist,
+		    sc->bus_acquired - start);
+	}
+	return (error);
+}
+
+static void
+release_bus(ig4iic_softc_t *sc)
+{
+	if (sc->bus_release == NULL)
+		return;
+
+	ig4iic_hist_add(&sc->bus_hold_hist, sbinuptime() - sc->bus_acquired);
+	sc->bus_release(sc);
+}
+
+/*
+ * Steer the controller interrupt to a CPU, -1 lets the kernel choose.
+ */
+static int
+bind_intr(ig4iic_softc_t *sc, int cpu)
+{
+	int error;
+
+	if (cpu < -1 || cpu > (int)mp_maxid || (cpu >= 0 && CPU_ABSENT(cpu)))
+		return (EINVAL);
+	error = bus_bind_intr(sc->dev, sc->intr_res, cpu < 0 ? NOCPU : cpu);
+	if (error == 0)
+		sc->intr_cpu = cpu;
+	return (error);
+}
+
+static int
+ig4iic_sysctl_intr_cpu(SYSCTL_HANDLER_ARGS)
+{
+	ig4iic_softc_t *sc = arg1;
+	int error;
+	int cpu;
+
+	cpu = sc->intr_cpu;
+	error = sysctl_handle_int(oidp, &cpu, 0, req);
+	if (error != 0 || req->newptr == NULL)
+		return (error);
+	sx_xlock(&sc->call_lock);
+	error = bind_intr(sc, cpu);
+	sx_xunlock(&sc->call_lock);
+	return (error);
+}
+
+/*
+ * Run the calling thread on the interrupt CPU for the duration of a
+ * transfer, so the ISR and the waiter share the same caches.  Returns
+ * true if the thread was bound and must be unbound afterwards.
+ */
+static bool
+bind_waiter(ig4iic_softc_t *sc)
+{
+	struct thread *td = curthread;
+	int cpu;
+
+	cpu = sc->intr_cpu;
+	if (!sc->bind_waiter || cpu < 0)
+		return (false);
+	thread_lock(td);
+	if (sched_is_bound(td)) {
+		thread_unlock(td);
+		return (false);
+	}
+	sched_bind(td, cpu);
+	thread_unlock(td);
+	return (true);
+}
+
+static void
+unbind_waiter(void)
+{
+	struct thread *td = curthread;
+
+	thread_lock(td);
+	sched_unbind(td);
+	thread_unlock(td);
+}
+
 /*
  *				IICBUS API FUNCTIONS
  */
@@ -294,79 +1143,214 @@ ig4iic_xfer_start(ig4iic_softc_t *sc, uint16_t slave)
 	return (0);
 }
 
+/*
+ * A message without a START continues the transaction on the current
+ * target.  Without one set up there is nothing to continue; that is a
+ * request the controller cannot do, not an errno.
+ */
 static int
-ig4iic_read(ig4iic_softc_t *sc, uint8_t *buf, uint16_t len,
-    bool repeated_start, bool stop)
+ig4iic_xfer_continue(ig4iic_softc_t *sc, uint16_t slave)
+{
+	if (sc->slave_valid && (slave >> 1) == sc->last_slave)
+		return (0);
+	device_printf(sc->dev, "start condition suppressed"
+	    " but slave address is not set up\n");
+	return (IIC_ENOTSUPP);
+}
+
+/*
+ * A failed message leaves the controller in the middle of the
+ * transaction, with commands possibly still queued and the bus held.
+ * Disabling the controller flushes the FIFOs and ends the transaction
+ * with a STOP, the target address is kept.
+ */
+static void
+ig4iic_xfer_abort(ig4iic_softc_t *sc)
+{
+	set_controller(sc, 0);
+	set_controller(sc, IG4_I2C_ENABLE);
+}
+
+/*
+ * Queue one DATA_CMD word once the TX FIFO has room for it.
+ */
+static int
+queue_cmd(ig4iic_softc_t *sc, uint32_t cmd)
 {
-	uint32_t cmd;
-	uint16_t i;
 	int error;
 
-	if (len == 0)
-		return (0);
+	error = wait_status(sc, IG4_STATUS_TX_NOTFULL);
+	if (error == 0)
+		reg_write(sc, IG4_REG_DATA_CMD, cmd);
+	return (error);
+}
 
-	cmd = IG4_DATA_COMMAND_RD;
-	cmd |= repeated_start ? IG4_DATA_RESTART : 0;
-	cmd |= stop && len == 1 ? IG4_DATA_STOP : 0;
+/*
+ * Word i of a message, from the program if it was compiled.
+ */
+static __inline uint32_t
+pmsg_word(const struct ig4iic_pmsg *pm, const uint32_t *cmd,
+    const uint8_t *buf, uint16_t i)
+{
+	uint32_t v;
 
-	/* Issue request for the first byte (could be last as well). */
-	reg_write(sc, IG4_REG_DATA_CMD, cmd);
+	if (__predict_true(cmd != NULL))
+		return (cmd[i]);
+	v = pm->rd ? IG4_DATA_COMMAND_RD : buf[i];
+	if (i == 0)
+		v |= pm->first;
+	if (i == pm->len - 1)
+		v |= pm->last;
+	return (v);
+}
+
+static int
+ig4iic_read(ig4iic_softc_t *sc, const struct ig4iic_pmsg *pm,
+    const uint32_t *cmd, uint8_t *buf)
+{
+	uint16_t len = pm->len;
+	uint16_t i;
+	int error;
+
+	/*
+	 * Issue request for the first byte (could be last as well).  A
+	 * preceding write may still fill the TX FIFO, it returns as soon as
+	 * its bytes are queued, so the first two commands wait for room.
+	 * Once the first byte has arrived only our own read commands are
+	 * left in the FIFO.
+	 */
+	error = queue_cmd(sc, pmsg_word(pm, cmd, buf, 0));
+	if (error)
+		return (error);
 
 	for (i = 0; i < len; i++) {
 		/*
 		 * Maintain a pipeline by queueing the allowance for the next
 		 * read before waiting for the current read.
 		 */
-		cmd = IG4_DATA_COMMAND_RD;
 		if (i < len - 1) {
-			cmd = IG4_DATA_COMMAND_RD;
-			cmd |= stop && i == len - 2 ? IG4_DATA_STOP : 0;
-			reg_write(sc, IG4_REG_DATA_CMD, cmd);
+			if (i == 0) {
+				error = queue_cmd(sc, pmsg_word(pm, cmd, buf, 1));
+				if (error)
+					break;
+			} else
+				reg_write(sc, IG4_REG_DATA_CMD,
+				    pmsg_word(pm, cmd, buf, i + 1));
 		}
 		error = wait_status(sc, IG4_STATUS_RX_NOTEMPTY);
 		if (error)
 			break;
 		buf[i] = data_read(sc);
 	}
-
-	(void)reg_read(sc, IG4_REG_TX_ABRT_SOURCE);
-	return (error);
+
+	return (error);
+}
+
+/*
+ * Wait for a write that ends the transaction with a STOP to leave the
+ * bus.  Its bytes are only queued, a NACK from the target shows up
+ * afterwards: in rx_aborted once the filter has run, in RAW_INTR_STAT
+ * before that.  TX_ABRT_SOURCE is read first, the filter clears both.
+ */
+static int
+write_done(ig4iic_softc_t *sc)
+{
+	uint32_t source;
+	u_int count_us;
+	int error;
+
+	error = wait_status(sc, IG4_STATUS_TX_EMPTY);
+	for (count_us = 0; error == 0; count_us += 25) {
+		if ((reg_read(sc, IG4_REG_I2C_STA) & IG4_STATUS_ACTIVITY) == 0)
+			break;
+		if (count_us >= 25000)
+			error = IIC_ETIMEOUT;
+		else
+			DELAY(25);
+	}
+	if (error != 0)
+		return (error);
+	source = reg_read(sc, IG4_REG_TX_ABRT_SOURCE);
+	if (reg_read(sc, IG4_REG_RAW_INTR_STAT) & IG4_INTR_TX_ABRT)
+		return (abort_error(source));
+	if (atomic_load_acq_int(&sc->rx_aborted) != 0)
+		return (abort_error(sc->rx_abort_source));
+	return (0);
 }
 
 static int
-ig4iic_write(ig4iic_softc_t *sc, uint8_t *buf, uint16_t len,
-    bool repeated_start, bool stop)
+ig4iic_write(ig4iic_softc_t *sc, const struct ig4iic_pmsg *pm,
+    const uint32_t *cmd, const uint8_t *buf)
 {
-	uint32_t cmd;
 	uint16_t i;
 	int error;
 
-	if (len == 0)
-		return (0);
-
-	cmd = repeated_start ? IG4_DATA_RESTART : 0;
-	for (i = 0; i < len; i++) {
-		error = wait_status(sc, IG4_STATUS_TX_NOTFULL);
+	error = 0;
+	for (i = 0; i < pm->len; i++) {
+		error = queue_cmd(sc, pmsg_word(pm, cmd, buf, i));
 		if (error)
 			break;
-		cmd |= buf[i];
-		cmd |= stop && i == len - 1 ? IG4_DATA_STOP : 0;
-		reg_write(sc, IG4_REG_DATA_CMD, cmd);
-		cmd = 0;
 	}
+	if (error == 0 && pm->last != 0)
+		error = write_done(sc);
 
-	(void)reg_read(sc, IG4_REG_TX_ABRT_SOURCE);
 	return (error);
 }
 
-int
-ig4iic_transfer(device_t dev, struct iic_msg *msgs, uint32_t nmsgs)
+/*
+ * Make room for a program of nmsgs messages and ncmd command words.
+ * The arrays grow as needed, ig4iic_prog_trim() frees them again once
+ * they hold more than a typical transfer needs.  Called with the
+ * call_lock held.
+ */
+static void
+ig4iic_prog_reserve(struct ig4iic_prog *prog, uint32_t nmsgs, uint32_t ncmd)
 {
-	ig4iic_softc_t *sc = device_get_softc(dev);
-	const char *reason = NULL;
-	uint32_t i;
-	int error;
-	int unit;
+	if (nmsgs > prog->msg_size) {
+		free(prog->msg, M_DEVBUF);
+		prog->msg_size = MAX(nmsgs, 2 * prog->msg_size);
+		prog->msg = malloc(prog->msg_size * sizeof(*prog->msg),
+		    M_DEVBUF, M_WAITOK);
+	}
+	if (ncmd > prog->cmd_size) {
+		free(prog->cmd, M_DEVBUF);
+		prog->cmd_size = MAX(ncmd, 2 * prog->cmd_size);
+		prog->cmd = malloc(prog->cmd_size * sizeof(*prog->cmd),
+		    M_DEVBUF, M_WAITOK);
+	}
+}
+
+/*
+ * Free the descriptors of an unusually long transfer.  The words are
+ * bounded by IG4_PROG_MAXCMD already.
+ */
+static void
+ig4iic_prog_trim(struct ig4iic_prog *prog)
+{
+	if (prog->msg_size > IG4_PROG_MAXMSGS) {
+		free(prog->msg, M_DEVBUF);
+		prog->msg = NULL;
+		prog->msg_size = 0;
+	}
+}
+
+/*
+ * Check the messages against what the controller can do and turn them
+ * into a program, the DATA_CMD words to feed it.  Running the transfer
+ * then only copies words into the FIFO and bytes out of it, every
+ * RESTART and STOP decision is made here, once.  The program replaces
+ * the oldest cache entry if it fits, sc->prog otherwise.  Returns NULL
+ * on success, or why the transfer cannot be done.
+ */
+static const char *
+ig4iic_compile(ig4iic_softc_t *sc, struct iic_msg *msgs, uint32_t nmsgs,
+    struct ig4iic_prog **progp)
+{
+	struct ig4iic_prog *prog;
+	struct ig4iic_pmsg *pm;
+	uint64_t total;
+	uint32_t *cmd;
+	uint32_t i, j, ncmd;
 	bool rpstart;
 	bool stop;
 
@@ -388,49 +1372,292 @@ ig4iic_transfer(device_t dev, struct iic_msg *msgs, uint32_t nmsgs)
 	 * state, so it's impossible to do that without the stop followed
 	 * by the start.
 	 */
+	total = 0;
 	for (i = 0; i < nmsgs; i++) {
 #if 0
-		if (i == 0 && (msgs[i].flags & IIC_M_NOSTART) != 0) {
-			reason = "first message without start";
-			break;
-		}
-		if (i == nmsgs - 1 && (msgs[i].flags & IIC_M_NOSTOP) != 0) {
-			reason = "last message without stop";
-			break;
-		}
+		if (i == 0 && (msgs[i].flags & IIC_M_NOSTART) != 0)
+			return ("first message without start");
+		if (i == nmsgs - 1 && (msgs[i].flags & IIC_M_NOSTOP) != 0)
+			return ("last message without stop");
 #endif
-		if (msgs[i].len == 0) {
-			reason = "message with no data";
-			break;
-		}
+		if (msgs[i].len == 0)
+			return ("message with no data");
 		if (i > 0) {
 			if ((msgs[i].flags & IIC_M_NOSTART) != 0 &&
-			    (msgs[i - 1].flags & IIC_M_NOSTOP) == 0) {
-				reason = "stop not followed by start";
-				break;
-			}
+			    (msgs[i - 1].flags & IIC_M_NOSTOP) == 0)
+				return ("stop not followed by start");
 			if ((msgs[i - 1].flags & IIC_M_NOSTOP) != 0 &&
-			    msgs[i].slave != msgs[i - 1].slave) {
-				reason = "change of slave without stop";
-				break;
-			}
+			    msgs[i].slave != msgs[i - 1].slave)
+				return ("change of slave without stop");
 			if ((msgs[i].flags & IIC_M_NOSTART) != 0 &&
 			    (msgs[i].flags & IIC_M_RD) !=
-			    (msgs[i - 1].flags & IIC_M_RD)) {
-				reason = "change of direction without repeated"
-				    " start";
-				break;
-			}
+			    (msgs[i - 1].flags & IIC_M_RD))
+				return ("change of direction without repeated"
+				    " start");
+		}
+		total += msgs[i].len;
+	}
+
+	if (nmsgs <= IG4_PCACHE_MSGS && total <= IG4_PCACHE_CMD) {
+		prog = &sc->pcache[sc->pcache_next].prog;
+		sc->pcache_next = (sc->pcache_next + 1) % IG4_PCACHE_SIZE;
+	} else {
+		prog = &sc->prog;
+		ig4iic_prog_reserve(prog, nmsgs,
+		    total <= IG4_PROG_MAXCMD ? total : 0);
+	}
+	prog->nmsgs = nmsgs;
+	prog->ncmd = total <= IG4_PROG_MAXCMD ? total : 0;
+	prog->nbus = total;
+	prog->rd = false;
+
+	rpstart = false;
+	ncmd = 0;
+	for (i = 0; i < nmsgs; i++) {
+		pm = &prog->msg[i];
+		pm->cmd = ncmd;
+		pm->len = msgs[i].len;
+		ncmd += pm->len;
+		pm->slave = msgs[i].slave;
+		pm->flags = msgs[i].flags;
+		pm->start = (msgs[i].flags & IIC_M_NOSTART) == 0;
+		pm->rd = (msgs[i].flags & IIC_M_RD) != 0;
+		if (!pm->start)
+			rpstart = false;
+		if (pm->start || rpstart)
+			prog->nbus++;
+		prog->rd |= pm->rd;
+		stop = (msgs[i].flags & IIC_M_NOSTOP) == 0;
+		pm->first = rpstart ? IG4_DATA_RESTART : 0;
+		pm->last = stop ? IG4_DATA_STOP : 0;
+		rpstart = !stop;
+		if (prog->ncmd == 0)
+			continue;
+
+		cmd = &prog->cmd[pm->cmd];
+		if (pm->rd) {
+			for (j = 0; j < pm->len; j++)
+				cmd[j] = IG4_DATA_COMMAND_RD;
+		} else {
+			for (j = 0; j < pm->len; j++)
+				cmd[j] = msgs[i].buf[j];
+		}
+		cmd[0] |= pm->first;
+		cmd[pm->len - 1] |= pm->last;
+	}
+
+	*progp = prog;
+	return (NULL);
+}
+
+static bool
+ig4iic_pcache_match(struct ig4iic_prog *prog, struct iic_msg *msgs,
+    uint32_t nmsgs)
+{
+	struct ig4iic_pmsg *pm;
+	uint32_t *cmd;
+	uint32_t i, j;
+
+	/* Unused entries have no messages. */
+	if (nmsgs == 0 || prog->nmsgs != nmsgs)
+		return (false);
+	for (i = 0; i < nmsgs; i++) {
+		pm = &prog->msg[i];
+		if (pm->slave != msgs[i].slave || pm->len != msgs[i].len ||
+		    pm->flags != msgs[i].flags)
+			return (false);
+		if (pm->rd)
+			continue;
+		cmd = &prog->cmd[pm->cmd];
+		for (j = 0; j < pm->len; j++)
+			if ((uint8_t)cmd[j] != msgs[i].buf[j])
+				return (false);
+	}
+	return (true);
+}
+
+/*
+ * Find a cached program for the messages.  Only programs that passed
+ * validation are cached, so a hit needs neither validation nor command
+ * generation.
+ */
+static struct ig4iic_prog *
+ig4iic_pcache_lookup(ig4iic_softc_t *sc, struct iic_msg *msgs,
+    uint32_t nmsgs)
+{
+	u_int i;
+
+	for (i = 0; i < IG4_PCACHE_SIZE; i++)
+		if (ig4iic_pcache_match(&sc->pcache[i].prog, msgs, nmsgs))
+			return (&sc->pcache[i].prog);
+	return (NULL);
+}
+
+/*
+ * Feed the compiled program to the controller.  Read data goes to the
+ * buffers of msgs, which the program was compiled from.
+ */
+static int
+ig4iic_run(ig4iic_softc_t *sc, struct ig4iic_prog *prog,
+    struct iic_msg *msgs)
+{
+	struct ig4iic_pmsg *pm;
+	const uint32_t *cmd;
+	uint32_t i;
+	int error;
+
+	error = 0;
+	for (i = 0; i < prog->nmsgs; i++) {
+		pm = &prog->msg[i];
+		if (pm->start)
+			error = ig4iic_xfer_start(sc, pm->slave);
+		else
+			error = ig4iic_xfer_continue(sc, pm->slave);
+		if (error != 0)
+			break;
+
+		cmd = prog->ncmd != 0 ? &prog->cmd[pm->cmd] : NULL;
+		if (pm->rd)
+			error = ig4iic_read(sc, pm, cmd, msgs[i].buf);
+		else
+			error = ig4iic_write(sc, pm, cmd, msgs[i].buf);
+		if (error != 0)
+			break;
+	}
+
+	return (error);
+}
+
+/*
+ * Nominal time for a byte and its ACK at the configured speed.  The
+ * controller's input clock is not known, so this is only where byte_ns
+ * starts from.
+ */
+static u_int
+nominal_byte_ns(ig4iic_softc_t *sc)
+{
+	switch (shadow_read(sc, IG4_REG_CTL) & IG4_CTL_SPEED_MASK) {
+	case IG4_CTL_SPEED_HIGH:
+		return (9 * (1000000000 / 3400000));
+	case IG4_CTL_SPEED_FAST:
+		return (9 * (1000000000 / 400000));
+	default:
+		return (9 * (1000000000 / 100000));
+	}
+}
+
+/*
+ * The spin_max_us sysctl in ns, read once per transfer.  More than a
+ * second is pointless, wait_status() gives up long before.
+ */
+static u_int
+spin_max_ns(ig4iic_softc_t *sc)
+{
+	int us;
+
+	us = sc->spin_max_us;
+	if (us <= 0)
+		return (0);
+	return (MIN(us, 1000000) * 1000U);
+}
+
+/*
+ * Decide how a transfer waits for its read data.  When its bus time is
+ * shorter than a sleep and wakeup, wait_status() polls for the data for
+ * up to twice the estimate, but never longer than max_ns.  Called with
+ * io_lock held.
+ */
+static bool
+spin_start(ig4iic_softc_t *sc, struct ig4iic_prog *prog, u_int max_ns)
+{
+	uint64_t est;
+
+	if (!prog->rd)
+		return (false);
+	est = (uint64_t)prog->nbus * sc->byte_ns;
+	if (max_ns == 0 || est > sc->spin_ns || est > max_ns) {
+		sc->sleep_count++;
+		return (false);
+	}
+	sc->spin_until = sbinuptime() + MIN(2 * est, max_ns) * SBT_1NS;
+	sc->spin_count++;
+	return (true);
+}
+
+/*
+ * Tune the estimates from a transfer that took elapsed to run.  Polling
+ * that ran out backs spin_ns off.  A transfer that slept but would have
+ * fitted in spin_max_us lets it grow again.  A polled transfer measures
+ * the bus time per byte; a sleeping one only bounds it, its time
+ * includes the wakeup.
+ */
+static void
+spin_done(ig4iic_softc_t *sc, struct ig4iic_prog *prog, u_int max_ns,
+    bool spun, int error, sbintime_t elapsed)
+{
+	u_int ns;
+
+	ns = sbttons(elapsed) / MAX(prog->nbus, 1);
+	if (spun) {
+		if (sc->spin_until == 0) {
+			sc->spin_fallbacks++;
+			sc->spin_ns -= sc->spin_ns / 4;
+		} else if (error == 0) {
+			sc->byte_ns = (7 * (uint64_t)sc->byte_ns + ns) / 8;
 		}
+		sc->spin_until = 0;
+	} else if (prog->rd && error == 0) {
+		if (ns < sc->byte_ns)
+			sc->byte_ns = (7 * (uint64_t)sc->byte_ns + ns) / 8;
+		if (sbttons(elapsed) <= max_ns)
+			sc->spin_ns += sc->spin_ns / 8 + 1000;
 	}
-	if (reason != NULL) {
+	if (sc->spin_ns > max_ns)
+		sc->spin_ns = max_ns;
+}
+
+int
+ig4iic_transfer(device_t dev, struct iic_msg *msgs, uint32_t nmsgs)
+{
+	ig4iic_softc_t *sc = device_get_softc(dev);
+	struct ig4iic_prog *prog;
+	const char *reason;
+	int error;
+	int unit;
+	u_int rnext;
+	uint64_t mmio;
+	u_int max_ns;
+	sbintime_t start, run, now;
+	bool bound;
+	bool spun;
+
+	start = sbinuptime();
+	bound = bind_waiter(sc);
+	sx_xlock(&sc->call_lock);
+	prog = ig4iic_pcache_lookup(sc, msgs, nmsgs);
+	if (prog != NULL) {
+		sc->pcache_hits++;
+	} else if ((reason = ig4iic_compile(sc, msgs, nmsgs, &prog)) == NULL) {
+		sc->pcache_misses++;
+	} else {
+		sx_xunlock(&sc->call_lock);
+		if (bound)
+			unbind_waiter();
 		if (bootverbose)
 			device_printf(dev, "%s\n", reason);
 		return (IIC_ENOTSUPP);
 	}
-
-	sx_xlock(&sc->call_lock);
+	if (acquire_bus(sc) != 0) {
+		sx_xunlock(&sc->call_lock);
+		if (bound)
+			unbind_waiter();
+		return (IIC_EBUSBSY);
+	}
+	if (sc->rpm_idle)
+		idle_wake(sc);
 	mtx_lock(&sc->io_lock);
+	mmio = counter_u64_fetch(sc->mmio_ops);
+	set_ltr(sc, sc->ltr_active_us);
 
 	/* Debugging - dump registers. */
 	if (ig4_dump) {
@@ -448,48 +1675,51 @@ ig4iic_transfer(device_t dev, struct iic_msg *msgs, uint32_t nmsgs)
 	reg_read(sc, IG4_REG_CLR_TX_ABORT);
 
 	/*
-	 * Clean out any previously received data.
+	 * Clean out any previously received data.  Only the producer
+	 * moves rnext, so skip over it.
 	 */
-	if (sc->rpos != sc->rnext && bootverbose) {
-		device_printf(sc->dev, "discarding %d bytes of spurious data\n",
-		    sc->rnext - sc->rpos);
-	}
-	sc->rpos = 0;
-	sc->rnext = 0;
-
-	rpstart = false;
-	error = 0;
-	for (i = 0; i < nmsgs; i++) {
-		if ((msgs[i].flags & IIC_M_NOSTART) == 0) {
-			error = ig4iic_xfer_start(sc, msgs[i].slave);
-		} else {
-			if (!sc->slave_valid ||
-			    (msgs[i].slave >> 1) != sc->last_slave) {
-				device_printf(dev, "start condition suppressed"
-				    "but slave address is not set up");
-				error = EINVAL;
-				break;
-			}
-			rpstart = false;
-		}
-		if (error != 0)
-			break;
-
-		stop = (msgs[i].flags & IIC_M_NOSTOP) == 0;
-		if (msgs[i].flags & IIC_M_RD)
-			error = ig4iic_read(sc, msgs[i].buf, msgs[i].len,
-			    rpstart, stop);
-		else
-			error = ig4iic_write(sc, msgs[i].buf, msgs[i].len,
-			    rpstart, stop);
-		if (error != 0)
-			break;
-
-		rpstart = !stop;
+	rnext = atomic_load_acq_int(&sc->rnext);
+	if (sc->rpos != rnext && bootverbose) {
+		device_printf(sc->dev, "discarding %u bytes of spurious data\n",
+		    rnext - sc->rpos);
 	}
-
+	atomic_store_rel_int(&sc->rpos, rnext);
+	atomic_store_int(&sc->rx_aborted, 0);
+
+	max_ns = spin_max_ns(sc);
+	run = sbinuptime();
+	spun = spin_start(sc, prog, max_ns);
+	error = ig4iic_run(sc, prog, msgs);
+	spin_done(sc, prog, max_ns, spun, error, sbinuptime() - run);
+	if (prog == &sc->prog)
+		ig4iic_prog_trim(prog);
+
+	if (error != 0)
+		ig4iic_xfer_abort(sc);
+
+	set_ltr(sc, sc->ltr_idle_us);
+	sc->xfer_mmio_last = counter_u64_fetch(sc->mmio_ops) - mmio;
+	sc->xfer_mmio += sc->xfer_mmio_last;
+	sc->xfer_count++;
 	mtx_unlock(&sc->io_lock);
+	release_bus(sc);
+	now = sbinuptime();
+	if (error != 0) {
+		sc->xfer_errors++;
+		ig4iic_hist_add(&sc->error_hist, now - start);
+		if (sc->fail_since == 0)
+			sc->fail_since = start;
+	} else if (sc->fail_since != 0) {
+		ig4iic_hist_add(&sc->recovery_hist, now - sc->fail_since);
+		sc->fail_since = 0;
+	}
+	if (sc->cap_buf != NULL)
+		ig4iic_capture(sc, msgs, nmsgs, start, now, error);
+	sc->last_active = now;
+	idle_schedule(sc, sc->idle_delay_ms * SBT_1MS);
 	sx_unlock(&sc->call_lock);
+	if (bound)
+		unbind_waiter();
 	return (error);
 }
 
@@ -499,6 +1729,12 @@ ig4iic_reset(device_t dev, u_char speed, u_char addr, u_char *oldaddr)
 	ig4iic_softc_t *sc = device_get_softc(dev);
 
 	sx_xlock(&sc->call_lock);
+	if (acquire_bus(sc) != 0) {
+		sx_xunlock(&sc->call_lock);
+		return (IIC_EBUSBSY);
+	}
+	if (sc->rpm_idle)
+		idle_wake(sc);
 	mtx_lock(&sc->io_lock);
 
 	/* TODO handle speed configuration? */
@@ -509,10 +1745,63 @@ ig4iic_reset(device_t dev, u_char speed, u_char addr, u_char *oldaddr)
 		sc->slave_valid = false;
 
 	mtx_unlock(&sc->io_lock);
+	release_bus(sc);
+	sc->last_active = sbinuptime();
+	idle_schedule(sc, sc->idle_delay_ms * SBT_1MS);
 	sx_unlock(&sc->call_lock);
 	return (0);
 }
 
+/*
+ * Statistics helpers.
+ */
+void
+ig4iic_hist_add(struct ig4iic_hist *h, sbintime_t sbt)
+{
+	uint64_t us;
+	int b;
+
+	us = sbt > 0 ? sbttous(sbt) : 0;
+	b = us == 0 ? 0 : flsll(us) - 1;
+	if (b >= IG4_HIST_BUCKETS)
+		b = IG4_HIST_BUCKETS - 1;
+	h->bucket[b]++;
+}
+
+/*
+ * Histograms read as "<lower bound in us>:<count>" pairs, empty buckets
+ * are omitted.
+ */
+static int
+ig4iic_sysctl_hist(SYSCTL_HANDLER_ARGS)
+{
+	struct ig4iic_hist *h = arg1;
+	struct sbuf sb;
+	int error;
+	int i;
+
+	sbuf_new_for_sysctl(&sb, NULL, 128, req);
+	for (i = 0; i < IG4_HIST_BUCKETS; i++) {
+		if (h->bucket[i] == 0)
+			continue;
+		sbuf_printf(&sb, "%s%ju:%ju", sbuf_len(&sb) > 0 ? " " : "",
+		    (uintmax_t)1 << i, (uintmax_t)h->bucket[i]);
+	}
+	error = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+	return (error);
+}
+
+void
+ig4iic_hist_sysctl(ig4iic_softc_t *sc, const char *name,
+    struct ig4iic_hist *h, const char *descr)
+{
+	SYSCTL_ADD_PROC(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO, name,
+	    CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE, h, 0,
+	    ig4iic_sysctl_hist, "A", descr);
+}
+
 /*
  * Called from ig4iic_pci_attach/detach()
  */
@@ -520,22 +1809,57 @@ int
 ig4iic_attach(ig4iic_softc_t *sc)
 {
 	int error;
+	int cpu;
+	int i;
+	int n;
 	uint32_t v;
 
 	device_printf(sc->dev, "%s: Entered.\n", __func__);
+	sc->mmio_ops = counter_u64_alloc(M_WAITOK);
+	if (sc->regs_res != NULL) {
+		sc->regs_t = rman_get_bustag(sc->regs_res);
+		sc->regs_h = rman_get_bushandle(sc->regs_res);
+		/* Controllers without a private block never touch priv_h. */
+		if (sc->priv_res != NULL)
+			sc->priv_h = rman_get_bushandle(sc->priv_res);
+		else if (rman_get_size(sc->regs_res) <= IG4_REG_PRIV_BASE ||
+		    bus_space_subregion(sc->regs_t, sc->regs_h,
+		    IG4_REG_PRIV_BASE, rman_get_size(sc->regs_res) -
+		    IG4_REG_PRIV_BASE, &sc->priv_h) != 0)
+			sc->priv_h = sc->regs_h;
+	}
 	mtx_init(&sc->io_lock, "IG4 I/O lock", NULL, MTX_DEF);
 	sx_init(&sc->call_lock, "IG4 call lock");
+	for (i = 0; i < IG4_PCACHE_SIZE; i++) {
+		sc->pcache[i].prog.msg = sc->pcache[i].msg;
+		sc->pcache[i].prog.cmd = sc->pcache[i].cmd;
+		sc->pcache[i].prog.msg_size = IG4_PCACHE_MSGS;
+		sc->pcache[i].prog.cmd_size = IG4_PCACHE_CMD;
+	}
+	TIMEOUT_TASK_INIT(taskqueue_thread, &sc->idle_task, 0,
+	    ig4iic_idle_task, sc);
+
+	/* hint.ig4iic.N.trace_entries traces from attach on. */
+	if (resource_int_value(device_get_name(sc->dev),
+	    device_get_unit(sc->dev), "trace_entries", &n) == 0 && n > 0 &&
+	    n <= IG4_TRACE_MAX) {
+		sc->trace_entries = powerof2(n) ? n : 1u << fls(n);
+		sc->trace = malloc(sc->trace_entries * sizeof(*sc->trace),
+		    M_DEVBUF, M_WAITOK | M_ZERO);
+		sc->trace[0].seq = UINT32_MAX;
+	}
 
-	v = reg_read(sc, IG4_REG_DEVIDLE_CTRL);
-	if (sc->version == IG4_SKYLAKE && (v & IG4_RESTORE_REQUIRED) ) {
-		reg_write(sc, IG4_REG_DEVIDLE_CTRL, IG4_DEVICE_IDLE | IG4_RESTORE_REQUIRED);
-		reg_write(sc, IG4_REG_DEVIDLE_CTRL, 0);
-
-		reg_write(sc, IG4_REG_RESETS_SKL, IG4_RESETS_ASSERT_SKL);
-		reg_write(sc, IG4_REG_RESETS_SKL, IG4_RESETS_DEASSERT_SKL);
-		DELAY(1000);
+	/* hint.ig4iic.N.capture_size captures from attach on. */
+	if (resource_int_value(device_get_name(sc->dev),
+	    device_get_unit(sc->dev), "capture_size", &n) == 0 && n > 0 &&
+	    n <= IG4_CAP_SIZE_MAX) {
+		sc->cap_size = n;
+		sc->cap_buf = malloc(n, M_DEVBUF, M_WAITOK);
 	}
 
+	restore_required(sc);
+	shadow_load(sc);
+
 	if (sc->version == IG4_ATOM)
 		v = reg_read(sc, IG4_REG_COMP_TYPE);
 	
@@ -557,7 +1881,7 @@ ig4iic_attach(ig4iic_softc_t *sc)
 	if (sc->version == IG4_HASWELL) {
 		v = reg_read(sc, IG4_REG_SW_LTR_VALUE);
 		v = reg_read(sc, IG4_REG_AUTO_LTR_VALUE);
-	} else if (sc->version == IG4_SKYLAKE) {
+	} else if (sc->version == IG4_SKYLAKE && sc->priv_ops == NULL) {
 		v = reg_read(sc, IG4_REG_ACTIVE_LTR_VALUE);
 		v = reg_read(sc, IG4_REG_IDLE_LTR_VALUE);
 	}
@@ -570,16 +1894,10 @@ ig4iic_attach(ig4iic_softc_t *sc)
 			goto done;
 		}
 	}
-	v = reg_read(sc, IG4_REG_SS_SCL_HCNT);
-	v = reg_read(sc, IG4_REG_SS_SCL_LCNT);
-	v = reg_read(sc, IG4_REG_FS_SCL_HCNT);
-	v = reg_read(sc, IG4_REG_FS_SCL_LCNT);
-	v = reg_read(sc, IG4_REG_SDA_HOLD);
-
-	v = reg_read(sc, IG4_REG_SS_SCL_HCNT);
-	reg_write(sc, IG4_REG_FS_SCL_HCNT, v);
-	v = reg_read(sc, IG4_REG_SS_SCL_LCNT);
-	reg_write(sc, IG4_REG_FS_SCL_LCNT, v);
+	shadow_write(sc, IG4_REG_FS_SCL_HCNT,
+	    shadow_read(sc, IG4_REG_SS_SCL_HCNT));
+	shadow_write(sc, IG4_REG_FS_SCL_LCNT,
+	    shadow_read(sc, IG4_REG_SS_SCL_LCNT));
 
 	/*
 	 * Program based on a 25000 Hz clock.  This is a bit of a
@@ -588,10 +1906,12 @@ ig4iic_attach(ig4iic_softc_t *sc)
 	 * utterly (presumably cause an abort) because the clock time
 	 * is ~18.8ms by default.  This brings it down to ~4ms (for now).
 	 */
-	reg_write(sc, IG4_REG_SS_SCL_HCNT, 100);
-	reg_write(sc, IG4_REG_SS_SCL_LCNT, 125);
-	reg_write(sc, IG4_REG_FS_SCL_HCNT, 100);
-	reg_write(sc, IG4_REG_FS_SCL_LCNT, 125);
+	shadow_write(sc, IG4_REG_SS_SCL_HCNT, 100);
+	shadow_write(sc, IG4_REG_SS_SCL_LCNT, 125);
+	shadow_write(sc, IG4_REG_FS_SCL_HCNT, 100);
+	shadow_write(sc, IG4_REG_FS_SCL_LCNT, 125);
+	if (sc->sda_hold != 0)
+		shadow_write(sc, IG4_REG_SDA_HOLD, sc->sda_hold);
 
 	/*
 	 * Use a threshold of 1 so we get interrupted on each character,
@@ -600,13 +1920,193 @@ ig4iic_attach(ig4iic_softc_t *sc)
 	 *
 	 * See ig4_var.h for details on interrupt handler synchronization.
 	 */
-	reg_write(sc, IG4_REG_RX_TL, 1);
-
-	reg_write(sc, IG4_REG_CTL,
-		  IG4_CTL_MASTER |
-		  IG4_CTL_SLAVE_DISABLE |
-		  IG4_CTL_RESTARTEN |
-		  IG4_CTL_SPEED_STD);
+	shadow_write(sc, IG4_REG_RX_TL, 1);
+
+	shadow_write(sc, IG4_REG_CTL,
+		     IG4_CTL_MASTER |
+		     IG4_CTL_SLAVE_DISABLE |
+		     IG4_CTL_RESTARTEN |
+		     IG4_CTL_SPEED_STD);
+
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "resume_us", CTLFLAG_RD, &sc->resume_us, 0,
+	    "Duration of the last resume in microseconds");
+	ig4iic_hist_sysctl(sc, "resume_hist", &sc->resume_hist,
+	    "Resume latency");
+	SYSCTL_ADD_COUNTER_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "mmio_ops", CTLFLAG_RD, &sc->mmio_ops,
+	    "Controller register accesses");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "xfer_count", CTLFLAG_RD, &sc->xfer_count, 0,
+	    "Number of transfers");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "xfer_mmio", CTLFLAG_RD, &sc->xfer_mmio, 0,
+	    "Register accesses made during transfers, ISR included");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "xfer_mmio_last", CTLFLAG_RD, &sc->xfer_mmio_last, 0,
+	    "Register accesses made during the last transfer");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "intr_count", CTLFLAG_RD, &sc->intr_count, 0,
+	    "Interrupt filter invocations");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "intr_stray", CTLFLAG_RD, &sc->intr_stray, 0,
+	    "Interrupts that were not ours (shared line)");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "ithread_count", CTLFLAG_RD, &sc->ithread_count, 0,
+	    "Interrupt thread runs");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "wakeups", CTLFLAG_RD, &sc->wakeups, 0,
+	    "Sleeps ended by a wakeup rather than the timeout");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "wakeups_spurious", CTLFLAG_RD, &sc->wakeups_spurious, 0,
+	    "Wakeups that found the awaited condition not met");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "pcache_hits", CTLFLAG_RD, &sc->pcache_hits, 0,
+	    "Transfers run from a cached command program");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "pcache_misses", CTLFLAG_RD, &sc->pcache_misses, 0,
+	    "Transfers that had to be validated and compiled");
+
+	sc->byte_ns = nominal_byte_ns(sc);
+	sc->spin_max_us = IG4_SPIN_MAX_US;
+	resource_int_value(device_get_name(sc->dev), device_get_unit(sc->dev),
+	    "spin_max_us", &sc->spin_max_us);
+	sc->spin_ns = spin_max_ns(sc);
+	SYSCTL_ADD_INT(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "spin_max_us", CTLFLAG_RW, &sc->spin_max_us, 0,
+	    "Longest transfer that polls for read data in us (0: always sleep)");
+	SYSCTL_ADD_UINT(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "spin_ns", CTLFLAG_RD, &sc->spin_ns, 0,
+	    "Current limit on the bus time of polled transfers in ns");
+	SYSCTL_ADD_UINT(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "byte_ns", CTLFLAG_RD, &sc->byte_ns, 0,
+	    "Estimated bus time per byte in ns");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "spin_count", CTLFLAG_RD, &sc->spin_count, 0,
+	    "Transfers that polled for read data");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "spin_fallbacks", CTLFLAG_RD, &sc->spin_fallbacks, 0,
+	    "Polled transfers that outlasted their estimate and slept");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "sleep_count", CTLFLAG_RD, &sc->sleep_count, 0,
+	    "Transfers that slept for read data");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "xfer_errors", CTLFLAG_RD, &sc->xfer_errors, 0,
+	    "Number of failed transfers");
+	ig4iic_hist_sysctl(sc, "error_hist", &sc->error_hist,
+	    "Time taken by failed transfers");
+	ig4iic_hist_sysctl(sc, "recovery_hist", &sc->recovery_hist,
+	    "Time from a failure to the next successful transfer");
+#ifdef IG4_FAULT
+	ig4iic_fault_attach(sc);
+#endif
+	SYSCTL_ADD_PROC(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "trace_entries", CTLTYPE_UINT | CTLFLAG_RW | CTLFLAG_MPSAFE, sc, 0,
+	    ig4iic_sysctl_trace_entries, "IU",
+	    "Register access trace ring size (0: tracing off)");
+	SYSCTL_ADD_PROC(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "trace_buf", CTLTYPE_OPAQUE | CTLFLAG_RD | CTLFLAG_MPSAFE, sc, 0,
+	    ig4iic_sysctl_trace_buf, "S,ig4iic_trace_ent",
+	    "Register access trace records (see tools/tools/ig4trace)");
+	SYSCTL_ADD_PROC(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "capture_size", CTLTYPE_UINT | CTLFLAG_RW | CTLFLAG_MPSAFE, sc, 0,
+	    ig4iic_sysctl_capture_size, "IU",
+	    "Transfer capture buffer size in bytes (0: capture off)");
+	SYSCTL_ADD_PROC(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "capture_buf", CTLTYPE_OPAQUE | CTLFLAG_RD | CTLFLAG_MPSAFE, sc, 0,
+	    ig4iic_sysctl_capture_buf, "S,ig4iic_cap_rec",
+	    "Captured transfers, removed when read (see tools/tools/ig4cap)");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "capture_drops", CTLFLAG_RD, &sc->cap_drops, 0,
+	    "Transfers not captured for lack of buffer space");
+
+	sc->ltr_cur = INT_MIN;
+	sc->ltr_active_us = IG4_LTR_ACTIVE_US;
+	sc->ltr_idle_us = IG4_LTR_NONE;
+	resource_int_value(device_get_name(sc->dev), device_get_unit(sc->dev),
+	    "ltr_active_us", &sc->ltr_active_us);
+	resource_int_value(device_get_name(sc->dev), device_get_unit(sc->dev),
+	    "ltr_idle_us", &sc->ltr_idle_us);
+	SYSCTL_ADD_PROC(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "ltr_active_us", CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_MPSAFE, sc, 1,
+	    ig4iic_sysctl_ltr, "I",
+	    "Latency tolerance during transfers in us (-1: none)");
+	SYSCTL_ADD_PROC(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "ltr_idle_us", CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_MPSAFE, sc, 0,
+	    ig4iic_sysctl_ltr, "I",
+	    "Latency tolerance between transfers in us (-1: none)");
+	SYSCTL_ADD_INT(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "ltr_cur", CTLFLAG_RD, &sc->ltr_cur, 0,
+	    "Latency tolerance currently requested in us");
+
+	sc->idle_delay_ms = IG4_IDLE_DELAY_MS;
+	resource_int_value(device_get_name(sc->dev), device_get_unit(sc->dev),
+	    "idle_delay_ms", &sc->idle_delay_ms);
+	resource_int_value(device_get_name(sc->dev), device_get_unit(sc->dev),
+	    "idle_d3", &sc->idle_d3);
+	/*
+	 * Firmware may use a controller shared with the PUNIT at any time,
+	 * keep it powered (as Linux does for shared_with_punit).
+	 */
+	if (sc->bus_acquire != NULL)
+		sc->idle_delay_ms = 0;
+	SYSCTL_ADD_PROC(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "idle_delay_ms", CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_MPSAFE, sc, 0,
+	    ig4iic_sysctl_idle_delay, "I",
+	    "Idle time before runtime suspend in ms (0: never, always 0 for"
+	    " a bus shared with firmware)");
+	SYSCTL_ADD_INT(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "idle_d3", CTLFLAG_RW, &sc->idle_d3, 0,
+	    "Put the PCI function into D3 while idle");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "idle_count", CTLFLAG_RD, &sc->idle_count, 0,
+	    "Number of runtime suspends");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "idle_time_ms", CTLFLAG_RD, &sc->idle_time_ms, 0,
+	    "Total time spent runtime suspended in ms");
+	SYSCTL_ADD_U64(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "wake_us", CTLFLAG_RD, &sc->wake_us, 0,
+	    "Duration of the last runtime wakeup in microseconds");
+	ig4iic_hist_sysctl(sc, "wake_hist", &sc->wake_hist,
+	    "Runtime wakeup latency");
+	if (sc->bus_acquire != NULL) {
+		ig4iic_hist_sysctl(sc, "bus_acquire_hist",
+		    &sc->bus_acquire_hist, "Firmware bus semaphore acquire wait");
+		ig4iic_hist_sysctl(sc, "bus_hold_hist",
+		    &sc->bus_hold_hist, "Firmware bus semaphore hold time");
+	}
 
 	sc->iicbus = device_add_child(sc->dev, "iicbus", -1);
 	if (sc->iicbus == NULL) {
@@ -635,12 +2135,33 @@ ig4iic_attach(ig4iic_softc_t *sc)
 		device_printf(sc->dev, "%s: controller error during attach-2\n", __func__);
 	mtx_unlock(&sc->io_lock);
 	error = bus_setup_intr(sc->dev, sc->intr_res, INTR_TYPE_MISC | INTR_MPSAFE,
-			       NULL, ig4iic_intr, sc, &sc->intr_handle);
+			       ig4iic_filter, ig4iic_intr, sc, &sc->intr_handle);
 	if (error) {
 		device_printf(sc->dev,
 			      "%s: Unable to setup irq: error %d\n", __func__, error);
 	}
 
+	/*
+	 * Interrupt CPU affinity, e.g. hint.ig4iic_pci.0.intr_cpu="2" and
+	 * hint.ig4iic_pci.0.bind_waiter="1" to also run transfers there.
+	 */
+	sc->intr_cpu = -1;
+	if (resource_int_value(device_get_name(sc->dev),
+	    device_get_unit(sc->dev), "intr_cpu", &cpu) == 0 &&
+	    sc->intr_handle != NULL && bind_intr(sc, cpu) != 0)
+		device_printf(sc->dev, "%s: Unable to bind irq to CPU %d\n",
+			      __func__, cpu);
+	resource_int_value(device_get_name(sc->dev), device_get_unit(sc->dev),
+	    "bind_waiter", &sc->bind_waiter);
+	SYSCTL_ADD_PROC(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "intr_cpu", CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_MPSAFE, sc, 0,
+	    ig4iic_sysctl_intr_cpu, "I", "CPU the interrupt is bound to (-1: any)");
+	SYSCTL_ADD_INT(device_get_sysctl_ctx(sc->dev),
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(sc->dev)), OID_AUTO,
+	    "bind_waiter", CTLFLAG_RW, &sc->bind_waiter, 0,
+	    "Run transfers on the interrupt CPU");
+
 	sc->enum_hook.ich_func = ig4iic_start;
 	sc->enum_hook.ich_arg = sc->dev;
 
@@ -676,6 +2197,11 @@ ig4iic_start(void *xdev)
 		device_printf(sc->dev,
 			      "failed to attach child: error %d\n", error);
 	}
+
+	sx_xlock(&sc->call_lock);
+	sc->last_active = sbinuptime();
+	idle_schedule(sc, sc->idle_delay_ms * SBT_1MS);
+	sx_xunlock(&sc->call_lock);
 }
 
 int
@@ -694,55 +2220,202 @@ ig4iic_detach(ig4iic_softc_t *sc)
 		bus_teardown_intr(sc->dev, sc->intr_res, sc->intr_handle);
 
 	sx_xlock(&sc->call_lock);
+	sc->idle_delay_ms = 0;
+	sx_xunlock(&sc->call_lock);
+	taskqueue_drain_timeout(taskqueue_thread, &sc->idle_task);
+
+	sx_xlock(&sc->call_lock);
+	/* Leave the controller alone if the firmware would not let go. */
+	error = acquire_bus(sc);
+	if (error == 0 && sc->rpm_idle)
+		idle_wake(sc);
 	mtx_lock(&sc->io_lock);
 
 	sc->iicbus = NULL;
 	sc->intr_handle = NULL;
-	reg_write(sc, IG4_REG_INTR_MASK, 0);
-	set_controller(sc, 0);
+	if (error == 0)
+		set_controller(sc, 0);
 
 	mtx_unlock(&sc->io_lock);
+	if (error == 0)
+		release_bus(sc);
 	sx_xunlock(&sc->call_lock);
 
 	mtx_destroy(&sc->io_lock);
 	sx_destroy(&sc->call_lock);
+	free(sc->trace, M_DEVBUF);
+	sc->trace = NULL;
+	free(sc->cap_buf, M_DEVBUF);
+	sc->cap_buf = NULL;
+	free(sc->prog.msg, M_DEVBUF);
+	free(sc->prog.cmd, M_DEVBUF);
+	memset(&sc->prog, 0, sizeof(sc->prog));
+	counter_u64_free(sc->mmio_ops);
+	sc->mmio_ops = NULL;
+
+	return (0);
+}
+
+/*
+ * Called from the front-end suspend/resume methods.  Resume only writes
+ * back the saved context, which is much quicker than ig4iic_attach().
+ */
+int
+ig4iic_suspend(ig4iic_softc_t *sc)
+{
+	int error;
+
+	error = bus_generic_suspend(sc->dev);
+	if (error != 0)
+		return (error);
+
+	sx_xlock(&sc->call_lock);
+	/*
+	 * A runtime idle controller is disabled and its context saved.  One
+	 * that the firmware will not let go of is left running.
+	 */
+	if (!sc->rpm_idle && acquire_bus(sc) == 0) {
+		mtx_lock(&sc->io_lock);
+		save_context(sc, &sc->ctx);
+		set_controller(sc, 0);
+		mtx_unlock(&sc->io_lock);
+		release_bus(sc);
+	}
+	sc->suspended = 1;
+	sx_xunlock(&sc->call_lock);
 
 	return (0);
 }
 
+int
+ig4iic_resume(ig4iic_softc_t *sc)
+{
+	sbintime_t start, t;
+	int error;
+
+	start = sbinuptime();
+	sx_xlock(&sc->call_lock);
+	sc->suspended = 0;
+	sc->rpm_d3 = 0;
+	if (acquire_bus(sc) != 0) {
+		/* Let the next transfer restore it, see idle_wake(). */
+		device_printf(sc->dev, "bus busy, restoring on first use\n");
+		sc->rpm_idle = 1;
+		sc->idle_start = start;
+		sx_xunlock(&sc->call_lock);
+		return (bus_generic_resume(sc->dev));
+	}
+	mtx_lock(&sc->io_lock);
+	/* Suspended while runtime idle, DEVICE_IDLE may still be set. */
+	if (!restore_required(sc))
+		set_devidle(sc, false);
+	set_controller(sc, 0);
+	restore_context(sc, &sc->ctx);
+	if (set_controller(sc, IG4_I2C_ENABLE))
+		device_printf(sc->dev, "controller error during resume\n");
+	sc->rpm_idle = 0;
+	mtx_unlock(&sc->io_lock);
+	release_bus(sc);
+	sx_xunlock(&sc->call_lock);
+
+	t = sbinuptime() - start;
+	sc->resume_us = sbttous(t);
+	ig4iic_hist_add(&sc->resume_hist, t);
+	if (bootverbose)
+		device_printf(sc->dev, "resumed in %ju us\n",
+		    (uintmax_t)sc->resume_us);
+
+	error = bus_generic_resume(sc->dev);
+	return (error);
+}
+
 /*
  * Interrupt Operation, see ig4_var.h for locking semantics.
+ *
+ * The filter does the common work: it tells a shared line's interrupt
+ * from ours, moves received bytes into the ring and notes aborts.  A
+ * transfer thread waiting for either can only be woken up with io_lock
+ * held, so that and the INTR_MASK workaround are left to the ithread.
  */
+static int
+filter_intr(ig4iic_softc_t *sc)
+{
+	uint32_t status;
+
+#ifdef IG4_FAULT
+	ig4iic_fault_intr(sc);
+#endif
+	sc->intr_count++;
+	/* Registers of a function in D3 read as all ones. */
+	if (sc->rpm_d3)
+		return (FILTER_STRAY);
+	status = reg_read(sc, IG4_REG_INTR_STAT);
+	if (status == 0 || status == 0xffffffff) {
+		sc->intr_stray++;
+		return (FILTER_STRAY);
+	}
+	if (status & IG4_INTR_TX_ABRT) {
+		sc->rx_abort_source = reg_read(sc, IG4_REG_TX_ABRT_SOURCE);
+		atomic_store_rel_int(&sc->rx_aborted, 1);
+	}
+/*	reg_write(sc, IG4_REG_INTR_MASK, IG4_INTR_STOP_DET);*/
+	reg_read(sc, IG4_REG_CLR_INTR);
+	rx_fill(sc);
+
+	if (sc->access_intr_mask != 0)
+		return (FILTER_SCHEDULE_THREAD);
+
+	/* Pairs with the fence in rx_sleep(). */
+	atomic_thread_fence_seq_cst();
+	if (atomic_load_int(&sc->rx_wait) != 0 && rx_wait_done(sc))
+		return (FILTER_SCHEDULE_THREAD);
+	return (FILTER_HANDLED);
+}
+
+static int
+ig4iic_filter(void *cookie)
+{
+	ig4iic_softc_t *sc = cookie;
+	int rv;
+
+	/*
+	 * Announce ourselves before touching the trace ring, so that
+	 * ig4iic_sysctl_trace_entries() can wait for us before freeing it.
+	 */
+	atomic_add_int(&sc->filter_busy, 1);
+	atomic_thread_fence_seq_cst();
+	rv = filter_intr(sc);
+	atomic_subtract_rel_int(&sc->filter_busy, 1);
+	return (rv);
+}
+
 static void
 ig4iic_intr(void *cookie)
 {
 	ig4iic_softc_t *sc = cookie;
 	uint32_t status;
 
+	sc->ithread_count++;
 	mtx_lock(&sc->io_lock);
-/*	reg_write(sc, IG4_REG_INTR_MASK, IG4_INTR_STOP_DET);*/
-	reg_read(sc, IG4_REG_CLR_INTR);
-	status = reg_read(sc, IG4_REG_I2C_STA);
-	while (status & IG4_STATUS_RX_NOTEMPTY) {
-		sc->rbuf[sc->rnext & IG4_RBUFMASK] =
-		    (uint8_t)reg_read(sc, IG4_REG_DATA_CMD);
-		++sc->rnext;
-		status = reg_read(sc, IG4_REG_I2C_STA);
-	}
 
 	/* 
 	 * Workaround to trigger pending interrupt if IG4_REG_INTR_STAT
 	 * is changed after clearing it
 	 */
 	if (sc->access_intr_mask != 0) {
-		status = reg_read(sc, IG4_REG_INTR_MASK);
+		status = shadow_read(sc, IG4_REG_INTR_MASK);
 		if (status != 0) {
 			reg_write(sc, IG4_REG_INTR_MASK, 0);
 			reg_write(sc, IG4_REG_INTR_MASK, status);
 		}
 	}
 
-	wakeup(sc);
+	/*
+	 * With io_lock held rx_wait is only set while the transfer thread
+	 * sleeps.  Leave it asleep if it consumed what the filter saw.
+	 */
+	if (sc->rx_wait != 0 && rx_wait_done(sc))
+		wakeup(__DEVOLATILE(void *, &sc->rx_wait));
 	mtx_unlock(&sc->io_lock);
 }
 
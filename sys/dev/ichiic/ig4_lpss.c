@@ -65,102 +65,102 @@ __FBSDID("$FreeBSD$");
 
 #include <dev/ichiic/ig4_reg.h>
 #include <dev/ichiic/ig4_var.h>
+#include <dev/intel/lpss_var.h>
 
-#define USE_DEV_IDENTIFY 1
+#include "lpss_if.h"
 
 static int ig4iic_lpss_detach(device_t dev);
 
-static int
-ig4iic_lpss_probe(device_t dev)
+/*
+ * The LPSS private block (resets, device idle, LTR) belongs to the lpss
+ * parent, go through it rather than touching the shared registers.
+ */
+static bool
+ig4iic_lpss_restore_required(ig4iic_softc_t *sc)
 {
-#if 0
-//	ig4iic_softc_t *sc = device_get_softc(dev);
-	devclass_t dc;
-	device_t *devices = NULL;
-	int num_devices = 0;
-
-	dc = devclass_find("lpss");
-	if (dc != NULL) {
-		if (devclass_get_devices(dc, &devices, &num_devices) == 0 && num_devices > 0) {
-			int i;
-
-			for (i = 0; i < num_devices; ++i) {
-				device_printf(dev, "HOORAY! Found lpss class device unit %d.\n", device_get_unit(devices[i]));
-			}
-			free(devices, M_TEMP);
-			return (BUS_PROBE_DEFAULT);
-		} else {
-			device_printf(dev, "No lpss class devices found.\n");
-		}
-	} else {
-		device_printf(dev, "lpss class not found.\n");
-	}
-#else
-	device_printf(dev, "%s: Returning BUS_PROBE_NOWILDCARD.\n", __func__);
-	return BUS_PROBE_NOWILDCARD;
-#endif
+	return (LPSS_RESTORE_REQUIRED(device_get_parent(sc->dev),
+	    sc->dev) != 0);
 }
 
-#if defined(USE_DEV_IDENTIFY)
 static void
-ig4iic_lpss_identify(driver_t *driver, device_t parent)
+ig4iic_lpss_set_idle(ig4iic_softc_t *sc, bool idle)
 {
-	/* Add only a single device instance. */
-	device_printf(parent, "%s: Entered.\n", __func__);
-	if (device_find_child(parent, "ig4iic_lpss", -1) == NULL) {
-		if (BUS_ADD_CHILD(parent, 0, "ig4iic_lpss", -1) == NULL) {
-			device_printf(parent, "add ig4iic_lpss child failed\n");
-		}
-	}
+	LPSS_SET_IDLE(device_get_parent(sc->dev), sc->dev, idle);
+}
+
+static void
+ig4iic_lpss_set_ltr(ig4iic_softc_t *sc, int us)
+{
+	LPSS_SET_LTR(device_get_parent(sc->dev), sc->dev, us);
 }
-#endif
+
+static const struct ig4iic_priv_ops ig4iic_lpss_priv_ops = {
+	.restore_required =	ig4iic_lpss_restore_required,
+	.set_idle =		ig4iic_lpss_set_idle,
+	.set_ltr =		ig4iic_lpss_set_ltr,
+};
 
 static int
-ig4iic_lpss_attach(device_t dev)
+ig4iic_lpss_probe(device_t dev)
 {
-	int error = ENXIO;
+	if (lpss_get_type(dev) != LPSS_TYPE_I2C)
+		return (ENXIO);
+	device_set_desc(dev, "Intel LPSS I2C Controller");
+	return (BUS_PROBE_DEFAULT);
+}
 
-	device_printf(dev, "%s: Entered.\n", __func__);
+static int
+ig4iic_lpss_attach(device_t dev)
+{
 	ig4iic_softc_t *sc = device_get_softc(dev);
-	int count = 1;
+	uint32_t hold_ns;
+	int error;
 
 	sc->dev = dev;
-	sc->regs_rid = PCIR_BAR(0);
+	/* Sunrise Point and later, which is all lpss knows about. */
+	sc->version = IG4_SKYLAKE;
+
+	/*
+	 * The parent hands out windows of the BAR it has mapped already:
+	 * the I2C registers and the private block behind them.
+	 */
+	sc->regs_rid = LPSS_RID_DEV;
 	sc->regs_res = bus_alloc_resource_any(dev, SYS_RES_MEMORY,
-					  &sc->regs_rid, RF_SHAREABLE | RF_ACTIVE);
-	if (sc->regs_res == NULL) {
-		device_printf(dev, "%s: Unable to map registers\n", __func__);
+	    &sc->regs_rid, RF_ACTIVE);
+	sc->priv_rid = LPSS_RID_PRIV;
+	sc->priv_res = bus_alloc_resource_any(dev, SYS_RES_MEMORY,
+	    &sc->priv_rid, RF_ACTIVE);
+	if (sc->regs_res == NULL || sc->priv_res == NULL) {
+		device_printf(dev, "Unable to map registers\n");
 		ig4iic_lpss_detach(dev);
 		return (ENXIO);
-	} else {
-		device_printf(dev, "%s: Got memory resource.\n", __func__);
-	}
-	if (pci_alloc_msi(dev, &count) == 0) {
-		device_printf(dev, "Using MSI\n");
-		sc->intr_type = INTR_TYPE_MSI;
-		sc->intr_rid = 1;
-	}
-	else
-	{
-		sc->intr_type = INTR_TYPE_PCI;
-		sc->intr_rid = 0;
 	}
+
+	/* SDA hold time from the platform data, in input clock cycles. */
+	if (lpss_get_property(dev, "i2c-sda-hold-time-ns", &hold_ns) == 0)
+		sc->sda_hold = (uint64_t)hold_ns * lpss_get_input_clock(dev) /
+		    1000000000;
+
+	/*
+	 * The interrupt belongs to the lpss parent, which already did the
+	 * MSI/INTx selection; rid 0 always names it.
+	 */
+	sc->intr_type = INTR_TYPE_PCI;
+	sc->intr_rid = 0;
 	sc->intr_res = bus_alloc_resource_any(dev, SYS_RES_IRQ,
 					  &sc->intr_rid, RF_SHAREABLE | RF_ACTIVE);
 	if (sc->intr_res == NULL) {
 		device_printf(dev, "Unable to map interrupt\n");
 		ig4iic_lpss_detach(dev);
 		return (ENXIO);
-	} else {
-		device_printf(dev, "%s: Got interrupt resource.\n", __func__);
 	}
 	sc->platform_attached = 1;
+	sc->priv_ops = &ig4iic_lpss_priv_ops;
 
 	error = ig4iic_attach(sc);
 	if (error)
 		ig4iic_lpss_detach(dev);
 
-	device_printf(dev, "%s: Returning %d.\n", __func__, error);
 	return (error);
 }
 
@@ -170,7 +170,6 @@ ig4iic_lpss_detach(device_t dev)
 	int error = 0;
 	ig4iic_softc_t *sc = device_get_softc(dev);
 
-	device_printf(dev, "%s: Entered.\n", __func__);
 	if (sc->platform_attached) {
 		error = ig4iic_detach(sc);
 		if (error)
@@ -183,8 +182,10 @@ ig4iic_lpss_detach(device_t dev)
 				     sc->intr_rid, sc->intr_res);
 		sc->intr_res = NULL;
 	}
-	if (sc->intr_type == INTR_TYPE_MSI) {
-		pci_release_msi(dev);
+	if (sc->priv_res) {
+		bus_release_resource(dev, SYS_RES_MEMORY,
+				     sc->priv_rid, sc->priv_res);
+		sc->priv_res = NULL;
 	}
 	if (sc->regs_res) {
 		bus_release_resource(dev, SYS_RES_MEMORY,
@@ -194,14 +195,29 @@ ig4iic_lpss_detach(device_t dev)
 	return (error);
 }
 
+static int
+ig4iic_lpss_suspend(device_t dev)
+{
+	ig4iic_softc_t *sc = device_get_softc(dev);
+
+	return (ig4iic_suspend(sc));
+}
+
+static int
+ig4iic_lpss_resume(device_t dev)
+{
+	ig4iic_softc_t *sc = device_get_softc(dev);
+
+	return (ig4iic_resume(sc));
+}
+
 static device_method_t ig4iic_lpss_methods[] = {
 	/* Device interface */
 	DEVMETHOD(device_probe, ig4iic_lpss_probe),
-#if defined(USE_DEV_IDENTIFY)
-	DEVMETHOD(device_identify,ig4iic_lpss_identify),
-#endif
 	DEVMETHOD(device_attach, ig4iic_lpss_attach),
 	DEVMETHOD(device_detach, ig4iic_lpss_detach),
+	DEVMETHOD(device_suspend, ig4iic_lpss_suspend),
+	DEVMETHOD(device_resume, ig4iic_lpss_resume),
 
 	DEVMETHOD(iicbus_transfer, ig4iic_transfer),
 	DEVMETHOD(iicbus_reset, ig4iic_reset),
@@ -147,6 +147,7 @@ static int
 ig4iic_pci_attach(device_t dev)
 {
 	ig4iic_softc_t *sc = device_get_softc(dev);
+	int count;
 	int error;
 
 	sc->dev = dev;
@@ -158,18 +159,24 @@ ig4iic_pci_attach(device_t dev)
 		ig4iic_pci_detach(dev);
 		return (ENXIO);
 	}
-	sc->intr_rid = 0;
-	if (pci_alloc_msi(dev, &sc->intr_rid)) {
+	count = 1;
+	if (pci_msi_count(dev) > 0 && pci_alloc_msi(dev, &count) == 0) {
 		device_printf(dev, "Using MSI\n");
+		sc->intr_type = INTR_TYPE_MSI;
+		sc->intr_rid = 1;
+	} else {
+		sc->intr_type = INTR_TYPE_PCI;
+		sc->intr_rid = 0;
 	}
-	sc->intr_res = bus_alloc_resource_any(dev, SYS_RES_IRQ,
-					  &sc->intr_rid, RF_SHAREABLE | RF_ACTIVE);
+	sc->intr_res = bus_alloc_resource_any(dev, SYS_RES_IRQ, &sc->intr_rid,
+	    RF_ACTIVE | (sc->intr_type == INTR_TYPE_PCI ? RF_SHAREABLE : 0));
 	if (sc->intr_res == NULL) {
 		device_printf(dev, "unable to map interrupt\n");
 		ig4iic_pci_detach(dev);
 		return (ENXIO);
 	}
 	sc->platform_attached = 1;
+	sc->pci_pm = 1;
 
 	error = ig4iic_attach(sc);
 	if (error)
@@ -196,8 +203,10 @@ ig4iic_pci_detach(device_t dev)
 				     sc->intr_rid, sc->intr_res);
 		sc->intr_res = NULL;
 	}
-	if (sc->intr_rid != 0)
+	if (sc->intr_type == INTR_TYPE_MSI) {
 		pci_release_msi(dev);
+		sc->intr_type = INTR_TYPE_PCI;
+	}
 	if (sc->regs_res) {
 		bus_release_resource(dev, SYS_RES_MEMORY,
 				     sc->regs_rid, sc->regs_res);
@@ -207,11 +216,29 @@ ig4iic_pci_detach(device_t dev)
 	return (0);
 }
 
+static int
+ig4iic_pci_suspend(device_t dev)
+{
+	ig4iic_softc_t *sc = device_get_softc(dev);
+
+	return (ig4iic_suspend(sc));
+}
+
+static int
+ig4iic_pci_resume(device_t dev)
+{
+	ig4iic_softc_t *sc = device_get_softc(dev);
+
+	return (ig4iic_resume(sc));
+}
+
 static device_method_t ig4iic_pci_methods[] = {
 	/* Device interface */
 	DEVMETHOD(device_probe, ig4iic_pci_probe),
 	DEVMETHOD(device_attach, ig4iic_pci_attach),
 	DEVMETHOD(device_detach, ig4iic_pci_detach),
+	DEVMETHOD(device_suspend, ig4iic_pci_suspend),
+	DEVMETHOD(device_resume, ig4iic_pci_resume),
 
 	DEVMETHOD(iicbus_transfer, ig4iic_transfer),
 	DEVMETHOD(iicbus_reset, ig4iic_reset),
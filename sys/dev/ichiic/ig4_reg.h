@@ -118,6 +118,7 @@
 /* Available at least on Atom SoCs */
 #define IG4_REG_COMP_TYPE	0x00FC	/* RO	Probe width/endian? (linux) */
 /* Available on Skylake-U/Y and Kaby Lake-U/Y */
+#define IG4_REG_PRIV_BASE	0x0200	/* LPSS private register block */
 #define IG4_REG_RESETS_SKL	0x0204	/* RW	Reset Register */
 #define IG4_REG_ACTIVE_LTR_VALUE 0x0210	/* RW	Active LTR Value */
 #define IG4_REG_IDLE_LTR_VALUE	0x0214	/* RW	Idle LTR Value */
@@ -154,6 +155,8 @@
 #define IG4_CTL_SLAVE_DISABLE	0x0040	/* snarfed from linux */
 #define IG4_CTL_RESTARTEN	0x0020	/* Allow Restart when master */
 #define IG4_CTL_10BIT		0x0010	/* ctlr accepts 10-bit addresses */
+#define IG4_CTL_SPEED_MASK	0x0006
+#define IG4_CTL_SPEED_HIGH	0x0006
 #define IG4_CTL_SPEED_FAST	0x0004	/* snarfed from linux */
 #define IG4_CTL_SPEED_STD	0x0002	/* snarfed from linux */
 #define IG4_CTL_MASTER		0x0001	/* snarfed from linux */
@@ -647,5 +650,6 @@
 #define IG4_SWLTR_SNOOP_SCALE_32US	0x00000C00	/* (rw) */
 #define IG4_SWLTR_SNOOP_VALUE_DECODE(v)	 ((v) & 0x3F)
 #define IG4_SWLTR_SNOOP_VALUE_ENCODE(v)	 ((v) & 0x3F)
+#define IG4_SWLTR_SNOOP_VALUE_MAX	0x03FF	/* 10-bit value on Skylake */
 
 #endif /* _ICHIIC_IG4_REG_H_ */
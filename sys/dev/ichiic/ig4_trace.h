@@ -0,0 +1,50 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef _ICHIIC_IG4_TRACE_H_
+#define _ICHIIC_IG4_TRACE_H_
+
+/*
+ * Register access trace record.  The ring is exported as an array of
+ * these, oldest first, through dev.ig4iic.N.trace_buf and is decoded by
+ * tools/tools/ig4trace.  Fixed-width types only, this header is shared
+ * with userland.
+ */
+struct ig4iic_trace_ent {
+	uint64_t	sbt;		/* sbinuptime() of the access */
+	uint32_t	seq;		/* access number */
+	uint32_t	reg;		/* register offset, see ig4_reg.h */
+	uint32_t	value;		/* value read or written */
+	uint16_t	cpu;
+	uint16_t	flags;
+#define IG4_TRACE_WRITE	0x0001
+};
+
+#define IG4_TRACE_MAX	65536	/* largest ring, in entries */
+
+#endif /* _ICHIIC_IG4_TRACE_H_ */
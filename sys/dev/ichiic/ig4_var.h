@@ -43,18 +43,155 @@
 #include "pci_if.h"
 #include "iicbus_if.h"
 
+#include <dev/ichiic/ig4_capture.h>
+#include <dev/ichiic/ig4_trace.h>
+
 #define IG4_RBUFSIZE	128
 #define IG4_RBUFMASK	(IG4_RBUFSIZE - 1)
 
 enum ig4_op { IG4_IDLE, IG4_READ, IG4_WRITE };
 enum ig4_vers { IG4_HASWELL, IG4_ATOM, IG4_SKYLAKE, IG4_APL };
 
+/*
+ * Latency histogram with power-of-two buckets.  Bucket N counts samples
+ * of [2^N, 2^(N+1)) microseconds, bucket 0 also counts anything shorter
+ * and the last bucket everything longer.
+ */
+#define IG4_HIST_BUCKETS	24
+
+struct ig4iic_hist {
+	uint64_t	bucket[IG4_HIST_BUCKETS];
+};
+
+#ifdef IG4_FAULT
+/*
+ * Fault injection configuration and state, see ig4_fault.c.
+ */
+struct ig4iic_fault {
+	u_int		abort_ppm;
+	u_int		abort_source;
+	u_int		rx_drop_ppm;
+	u_int		enable_stuck_ppm;
+	u_int		intr_delay_ppm;
+	u_int		intr_delay_us;
+
+	volatile u_int	aborted;	/* TX FIFO held until cleared */
+	bool		enable_stuck;	/* ENABLE_STATUS not following */
+	uint32_t	enable;		/* last IC_ENABLE written */
+
+	uint64_t	aborts;
+	uint64_t	rx_drops;
+	uint64_t	enable_stucks;
+	uint64_t	intr_delays;
+};
+#endif
+
+/*
+ * Driver-programmed controller state, written back on resume and after a
+ * runtime wakeup that lost the context instead of redoing the attach-time
+ * probing.  The fields up to intr_mask are live shadows of the registers
+ * (see reg_shadow() in ig4_iic.c), the rest is saved on suspend.
+ */
+struct ig4iic_ctx {
+	uint32_t	ctl;
+	uint32_t	tar_add;
+	uint32_t	ss_scl_hcnt;
+	uint32_t	ss_scl_lcnt;
+	uint32_t	fs_scl_hcnt;
+	uint32_t	fs_scl_lcnt;
+	uint32_t	sda_hold;
+	uint32_t	rx_tl;
+	uint32_t	tx_tl;
+	uint32_t	intr_mask;
+	uint32_t	general;	/* Haswell/Atom */
+	uint32_t	sw_ltr;		/* Haswell */
+	uint32_t	active_ltr;	/* Skylake */
+	uint32_t	idle_ltr;	/* Skylake */
+};
+
+struct ig4iic_softc;
+typedef int ig4iic_bus_acquire_t(struct ig4iic_softc *sc);
+typedef void ig4iic_bus_release_t(struct ig4iic_softc *sc);
+
+/*
+ * LPSS private block services of a parent driver that owns the block
+ * (see ig4_lpss.c).  Without them the controller's private registers
+ * are accessed directly.
+ */
+struct ig4iic_priv_ops {
+	bool	(*restore_required)(struct ig4iic_softc *sc);
+	void	(*set_idle)(struct ig4iic_softc *sc, bool idle);
+	void	(*set_ltr)(struct ig4iic_softc *sc, int us);
+};
+
+#define IG4_LTR_NONE	(-1)	/* no latency tolerance requirement */
+
+/*
+ * A transfer compiled into the DATA_CMD words that feed the controller,
+ * RESTART, STOP and the read command already set, write data included.
+ * Each message has a descriptor telling where its words start and, for
+ * a read, that its bytes go to the buffer of that iic_msg.  Transfers of
+ * more than IG4_PROG_MAXCMD words are not compiled (ncmd 0), their words
+ * are made from the descriptors and the iic_msg buffers as they are fed.
+ */
+#define IG4_PROG_MAXCMD	1024	/* words in a compiled program */
+#define IG4_PROG_MAXMSGS 64	/* descriptors kept between transfers */
+
+struct ig4iic_pmsg {
+	uint32_t	cmd;		/* index of the first word */
+	uint32_t	first;		/* RESTART for the first word */
+	uint32_t	last;		/* STOP for the last word */
+	uint16_t	len;
+	uint16_t	slave;
+	uint16_t	flags;		/* IIC_M_* */
+	bool		start;		/* address the slave first */
+	bool		rd;
+};
+
+struct ig4iic_prog {
+	struct ig4iic_pmsg *msg;
+	uint32_t	*cmd;
+	uint32_t	nmsgs;
+	uint32_t	ncmd;
+	uint32_t	nbus;		/* bytes on the bus, addresses too */
+	bool		rd;		/* has a read message */
+	uint32_t	msg_size;	/* allocated */
+	uint32_t	cmd_size;
+};
+
+/*
+ * Recently compiled programs, for callers that poll a device with the
+ * same transaction over and over.  An entry matches messages with the
+ * same slave, flags, lengths and write data.  Bigger programs are not
+ * cached, they are compiled into the softc's prog.
+ */
+#define IG4_PCACHE_SIZE	8
+#define IG4_PCACHE_MSGS	4	/* messages in a cached program */
+#define IG4_PCACHE_CMD	32	/* words in a cached program */
+
+struct ig4iic_pcache {
+	struct ig4iic_prog prog;	/* nmsgs 0: unused */
+	struct ig4iic_pmsg msg[IG4_PCACHE_MSGS];
+	uint32_t	cmd[IG4_PCACHE_CMD];
+};
+
 struct ig4iic_softc {
 	device_t	dev;
 	struct		intr_config_hook enum_hook;
 	device_t	iicbus;
 	struct resource	*regs_res;
 	int		regs_rid;
+	struct resource	*priv_res;	/* separate LPSS private block */
+	int		priv_rid;
+	/*
+	 * Register window, set up from regs_res.  Offsets from
+	 * IG4_REG_PRIV_BASE up are reached through priv_h, which maps
+	 * priv_res if the front-end has one, else the rest of regs_res.
+	 */
+	bus_space_tag_t	regs_t;
+	bus_space_handle_t regs_h;
+	bus_space_handle_t priv_h;
+	uint32_t	sda_hold;	/* SDA hold in clocks, 0: default */
 	struct resource	*intr_res;
 	int		intr_rid;
 	void		*intr_handle;
@@ -62,13 +199,38 @@ struct ig4iic_softc {
 #define INTR_TYPE_MSI  1
 #define INTR_TYPE_MSIX 2
 	int		intr_type;
+	int		intr_cpu;	/* bound CPU or -1 */
+	int		bind_waiter;	/* run transfers on intr_cpu */
 	enum ig4_vers	version;
 	enum ig4_op	op;
 	int		cmd;
-	int		rnext;
-	int		rpos;
-	char		rbuf[IG4_RBUFSIZE];
+
+	/*
+	 * Receive ring, a single-producer single-consumer queue between
+	 * whoever moves bytes out of the RX FIFO and the transfer thread.
+	 * The producer publishes bytes with a release store to rnext, the
+	 * consumer hands slots back with a release store to rpos; neither
+	 * takes io_lock.  Filling is normally done by the interrupt
+	 * handler and by the transfer thread only when it polls, rx_filling
+	 * makes one of them the producer at a time and rx_again tells it
+	 * that the other one found it busy.  rx_wait is set while the
+	 * transfer thread sleeps on it for data or for a transmit abort,
+	 * which the filter reports in rx_aborted and rx_abort_source.
+	 * Only when one of them is there the ithread takes io_lock to
+	 * wake it up.
+	 */
+	volatile u_int	rnext;
+	volatile u_int	rpos;
+	volatile u_int	rx_filling;
+	volatile u_int	rx_again;
+	volatile u_int	rx_wait;
+	volatile u_int	rx_aborted;
+	uint32_t	rx_abort_source;
+	uint8_t		rbuf[IG4_RBUFSIZE];
 	int		error;
+	struct ig4iic_prog prog;	/* too big for the cache */
+	struct ig4iic_pcache pcache[IG4_PCACHE_SIZE];
+	u_int		pcache_next;	/* entry to replace next */
 	uint8_t		last_slave;
 	int		platform_attached : 1;
 	int		use_10bit : 1;
@@ -76,6 +238,116 @@ struct ig4iic_softc {
 	int		read_started : 1;
 	int		write_started : 1;
 	int		access_intr_mask : 1;
+	int		suspended : 1;
+	int		pci_pm : 1;	/* direct PCI child, may use D3 */
+	int		rpm_idle : 1;	/* runtime idle, context in ctx */
+	int		rpm_d3 : 1;	/* runtime idle in D3 */
+	int		idle_pending : 1;
+
+	/*
+	 * Optional arbitration with platform firmware sharing the bus, set
+	 * up by the front-end before ig4iic_attach() (see ig4_baytrail.c).
+	 * bus_acquire is called before and bus_release after controller
+	 * I/O, with call_lock held and io_lock not held.  The bus is
+	 * held for one transfer at a time, never across an iicbus request.
+	 */
+	ig4iic_bus_acquire_t *bus_acquire;
+	ig4iic_bus_release_t *bus_release;
+	uint32_t	bus_sem_addr;
+	int		bus_sem_spin_us;
+	sbintime_t	bus_acquired;
+	struct ig4iic_hist bus_acquire_hist;
+	struct ig4iic_hist bus_hold_hist;
+
+	struct ig4iic_ctx ctx;		/* shadows, saved across suspend */
+	counter_u64_t	mmio_ops;	/* register accesses, per CPU */
+	uint64_t	xfer_count;
+	uint64_t	xfer_mmio;	/* register accesses in transfers */
+	uint64_t	xfer_mmio_last;
+	uint64_t	intr_count;	/* filter invocations */
+	uint64_t	intr_stray;	/* not ours, shared line */
+	uint64_t	ithread_count;	/* ithread runs */
+	uint64_t	wakeups;	/* sleeps ended by a wakeup */
+	uint64_t	wakeups_spurious; /* ... with nothing to do */
+	uint64_t	pcache_hits;
+	uint64_t	pcache_misses;
+
+	/*
+	 * Short reads poll for their data instead of sleeping.  A transfer
+	 * whose estimated bus time, nbus * byte_ns, is at most spin_ns polls
+	 * until spin_until and then falls back to sleeping.  Both estimates
+	 * are tuned from the outcome of each transfer, spin_ns up to
+	 * spin_max_us.
+	 */
+	int		spin_max_us;
+	u_int		spin_ns;
+	u_int		byte_ns;
+	sbintime_t	spin_until;	/* 0: sleep for data */
+	uint64_t	spin_count;	/* transfers that polled */
+	uint64_t	spin_fallbacks;	/* ... and had to sleep after all */
+	uint64_t	sleep_count;	/* transfers that slept from the start */
+
+	/*
+	 * Failed transfers: error_hist is the time a failing transfer took
+	 * to return, recovery_hist the time from the start of the first
+	 * failure to the end of the next successful transfer.
+	 */
+	uint64_t	xfer_errors;
+	sbintime_t	fail_since;	/* 0 while transfers succeed */
+	struct ig4iic_hist error_hist;
+	struct ig4iic_hist recovery_hist;
+#ifdef IG4_FAULT
+	struct ig4iic_fault fault;
+#endif
+
+	/*
+	 * Optional register access trace, trace_entries (a power of two)
+	 * records in a ring.  trace is NULL while tracing is off, it only
+	 * changes with call_lock and io_lock held and, as the filter takes
+	 * neither, once filter_busy has dropped to 0.
+	 */
+	struct ig4iic_trace_ent *trace;
+	u_int		trace_entries;
+	volatile u_int	trace_head;	/* next sequence number */
+	volatile u_int	filter_busy;	/* filter running */
+
+	/*
+	 * Optional transfer capture (see ig4_capture.h), cap_len of
+	 * cap_size bytes in use.  Protected by call_lock.
+	 */
+	uint8_t		*cap_buf;
+	u_int		cap_size;
+	u_int		cap_len;
+	uint32_t	cap_seq;
+	bool		cap_dropped;
+	uint64_t	cap_drops;
+
+	uint64_t	resume_us;	/* duration of the last resume */
+	struct ig4iic_hist resume_hist;
+
+	/*
+	 * Runtime idle: idle_task puts the controller into device idle
+	 * (or D3 with idle_d3) after idle_delay_ms without transfers, the
+	 * next transfer wakes it up again.  Protected by call_lock.
+	 */
+	struct timeout_task idle_task;
+	int		idle_delay_ms;
+	int		idle_d3;
+	sbintime_t	last_active;
+	sbintime_t	idle_start;
+	uint64_t	idle_count;
+	uint64_t	idle_time_ms;
+	uint64_t	wake_us;	/* duration of the last wakeup */
+	struct ig4iic_hist wake_hist;
+
+	/*
+	 * Latency tolerance, ltr_active_us while a transfer is in flight and
+	 * ltr_idle_us otherwise (microseconds or IG4_LTR_NONE).
+	 */
+	const struct ig4iic_priv_ops *priv_ops;
+	int		ltr_active_us;
+	int		ltr_idle_us;
+	int		ltr_cur;
 
 	/*
 	 * Locking semantics:
@@ -85,18 +357,21 @@ struct ig4iic_softc {
 	 * to prevent interleaving of calls to the interface and a lock on
 	 * io_lock right afterwards, to synchronize controller I/O activity.
 	 *
-	 * The interrupt handler can only read data while no iicbus call
-	 * is in progress or while io_lock is dropped during mtx_sleep in
-	 * wait_status and set_controller. It is safe to drop io_lock in those
-	 * places, because the interrupt handler only accesses those registers:
+	 * The interrupt filter runs without io_lock, concurrently with
+	 * an iicbus call.  That is safe because it only accesses these
+	 * registers, and received data only through the receive ring:
 	 *
+	 * - IG4_REG_INTR_STAT (Interrupt Status)
+	 * - IG4_REG_TX_ABRT_SOURCE (Transmit Abort Source)
 	 * - IG4_REG_I2C_STA  (I2C Status)
 	 * - IG4_REG_DATA_CMD (Data Buffer and Command)
 	 * - IG4_REG_CLR_INTR (Clear Interrupt)
 	 *
-	 * Locking outside of those places is required to make the content
-	 * of rpos/rnext predictable (e.g. whenever data_read is called and in
-	 * ig4iic_transfer).
+	 * The filter schedules the ithread only when there is something
+	 * it cannot do itself: wake up a transfer thread sleeping in
+	 * wait_status, and the INTR_MASK workaround (access_intr_mask),
+	 * which goes through the shadow registers.  The ithread does both
+	 * under io_lock.
 	 */
 	struct sx	call_lock;
 	struct mtx	io_lock;
@@ -107,6 +382,26 @@ typedef struct ig4iic_softc ig4iic_softc_t;
 /* Attach/Detach called from ig4iic_pci_*() */
 int ig4iic_attach(ig4iic_softc_t *sc);
 int ig4iic_detach(ig4iic_softc_t *sc);
+int ig4iic_suspend(ig4iic_softc_t *sc);
+int ig4iic_resume(ig4iic_softc_t *sc);
+
+/* Platform bus semaphore, called from ig4iic_acpi_attach() */
+#if defined(__amd64__) || defined(__i386__)
+int ig4iic_baytrail_setup(ig4iic_softc_t *sc, bool cherrytrail);
+#endif
+
+#ifdef IG4_FAULT
+/* Fault injection hooks, ig4_fault.c */
+uint32_t ig4iic_fault_read(ig4iic_softc_t *sc, uint32_t reg, uint32_t value);
+bool ig4iic_fault_write(ig4iic_softc_t *sc, uint32_t reg, uint32_t value);
+void ig4iic_fault_intr(ig4iic_softc_t *sc);
+void ig4iic_fault_attach(ig4iic_softc_t *sc);
+#endif
+
+/* Statistics helpers */
+void ig4iic_hist_add(struct ig4iic_hist *h, sbintime_t sbt);
+void ig4iic_hist_sysctl(ig4iic_softc_t *sc, const char *name,
+    struct ig4iic_hist *h, const char *descr);
 
 /* iicbus methods */
 extern iicbus_transfer_t ig4iic_transfer;
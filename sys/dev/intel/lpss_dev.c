@@ -30,9 +30,14 @@ __FBSDID("$FreeBSD$");
 #include <sys/param.h>
 #include <sys/bus.h>
 #include <sys/kernel.h>
+#include <sys/lock.h>
+#include <sys/malloc.h>
 #include <sys/module.h>
+#include <sys/mutex.h>
 #include <sys/rman.h>
+#include <sys/sysctl.h>
 #include <sys/systm.h>
+#include <sys/time.h>
 
 #include <machine/bus.h>
 #include <machine/resource.h>
@@ -43,6 +48,10 @@ __FBSDID("$FreeBSD$");
 #include <dev/pci/pcireg.h>
 #include <dev/pci/pcivar.h>
 
+#include <dev/intel/lpss_var.h>
+
+#include "lpss_if.h"
+
 #define BIT(nr) (1UL << (nr))
 
 #define LPSS_DEV_OFFSET		0x000
@@ -53,7 +62,24 @@ __FBSDID("$FreeBSD$");
 #define LPSS_IDMA64_OFFSET	0x800
 #define LPSS_IDMA64_SIZE	0x800
 
+/* Child memory windows, indexed by LPSS_RID_* */
+static const struct {
+	bus_size_t	offset;
+	bus_size_t	size;
+} lpss_windows[] = {
+	[LPSS_RID_DEV] =	{ LPSS_DEV_OFFSET,	LPSS_DEV_SIZE },
+	[LPSS_RID_PRIV] =	{ LPSS_PRIV_OFFSET,	LPSS_PRIV_SIZE },
+	[LPSS_RID_IDMA] =	{ LPSS_IDMA64_OFFSET,	LPSS_IDMA64_SIZE },
+};
+
 /* Offsets from lpss->sc_map_priv */
+#define LPSS_PRIV_CLOCK_PARAMS		0x00
+#define LPSS_PRIV_CLOCK_EN		BIT(0)
+#define LPSS_PRIV_CLOCK_M_SHIFT		1
+#define LPSS_PRIV_CLOCK_N_SHIFT		16
+#define LPSS_PRIV_CLOCK_MN_MAX		0x7fff	/* 15-bit M and N */
+#define LPSS_PRIV_CLOCK_UPDATE		BIT(31)
+
 #define LPSS_PRIV_RESETS		0x04
 #define LPSS_PRIV_RESETS_IDMA		BIT(2)
 #define LPSS_PRIV_RESETS_FUNC		0x3
@@ -68,8 +94,17 @@ __FBSDID("$FreeBSD$");
 #define LPSS_PRIV_LTR_VALUE_MASK	0x3ff
 
 #define LPSS_PRIV_SSP_REG		0x20
+#define LPSS_PRIV_CS_CTRL		0x24	/* SPI only */
+#define LPSS_PRIV_CS_CTRL_SW_MODE	BIT(0)
+#define LPSS_PRIV_CS_CTRL_HIGH		BIT(1)
+#define LPSS_PRIV_CS_CTRL_SEL_SHIFT	8
+#define LPSS_PRIV_CS_CTRL_SEL_MASK	(0x3 << LPSS_PRIV_CS_CTRL_SEL_SHIFT)
 #define LPSS_PRIV_REMAP_ADDR		0x40
 
+#define LPSS_PRIV_DEVIDLE		0x4c
+#define LPSS_PRIV_DEVIDLE_IDLE		BIT(2)
+#define LPSS_PRIV_DEVIDLE_RESTORE	BIT(3)	/* write 1 to clear */
+
 #define LPSS_PRIV_CAPS		0xfc
 #define LPSS_PRIV_CAPS_TYPE_SHIFT	4
 #define LPSS_PRIV_CAPS_TYPE_MASK	(0xf << LPSS_PRIV_CAPS_TYPE_SHIFT)
@@ -78,9 +113,9 @@ __FBSDID("$FreeBSD$");
 
 #define LPSS_PRIV_READ_4(sc, offset) \
 	bus_read_4(&(sc)->sc_map_priv, (offset))
-#define LPSS_PRIV_WRITE_4(res, offset, value) \
+#define LPSS_PRIV_WRITE_4(sc, offset, value) \
 	bus_write_4(&(sc)->sc_map_priv, (offset), (value))
-#define LPSS_PRIV_WRITE_8(res, offset, value) \
+#define LPSS_PRIV_WRITE_8(sc, offset, value) \
 	bus_write_8(&(sc)->sc_map_priv, (offset), (value))
 
 /* This matches the type field in CAPS register */
@@ -96,16 +131,28 @@ static void lo_hi_writeq(const struct resource_map *map, unsigned long addr, uin
 	bus_write_4(map, addr + 4, value >> 32);
 }
 
+struct intel_lpss_platform_info;
+
+struct lpss_clk_div {
+	uint64_t		rate;		/* requested output rate */
+	uint16_t		m;
+	uint16_t		n;
+};
+
 struct lpss_softc {
 	device_t		sc_dev;
 	int			sc_mem_rid;
 	struct resource		*sc_mem_res;
 	int			sc_irq_rid;
+	int			sc_irq_msi;
 	struct resource		*sc_irq_res;
 	void			*sc_irq_ih;
-	struct resource_map	sc_map_dev;
 	struct resource_map	sc_map_priv;
+	struct rman		sc_mem_rman;	/* child windows of the BAR */
+	int			sc_rman_init;
 	unsigned long 		sc_clock_rate;
+	const struct intel_lpss_platform_info *sc_info;
+	device_t		sc_child;
 	uint32_t		sc_caps;
 	int			sc_type;	// LPSS_PRIV_TYPE_*
 #define LPSS_PRIV_TYPE_I2C	0
@@ -113,15 +160,25 @@ struct lpss_softc {
 #define LPSS_PRIV_TYPE_SPI	2
 #define LPSS_PRIV_TYPE_MAX	LPSS_PRIV_TYPE_SPI
 	uint32_t                priv_ctx[LPSS_PRIV_REG_COUNT];
+	uint64_t		sc_resume_us;	/* last resume duration */
+	struct mtx		sc_mtx;		/* private register updates */
+	int			sc_ltr_req_us;	/* last child request */
+	int			sc_ltr_override_us; /* -2 follows the child */
+	/*
+	 * Shadows of the private registers programmed on behalf of the
+	 * child, see lpss_if.m.  Protected by sc_mtx.
+	 */
+	uint32_t		sc_ltr;		/* ACTIVELTR and IDLELTR */
+	uint32_t		sc_clk_params;	/* CLOCK_PARAMS, sans UPDATE */
+	uint32_t		sc_resets;	/* RESETS */
+	uint32_t		sc_devidle;	/* DEVIDLE */
+	uint64_t		sc_remap;	/* REMAP_ADDR */
+	uint32_t		sc_cs_ctrl;	/* CS_CTRL */
+	struct lpss_clk_div	*sc_clk_table;	/* precomputed dividers */
+	int			sc_clk_count;
 };
 
-struct device;
-struct resource;
-struct property_entry
-{
-	const char *name;
-	uint32_t value;
-};
+#define LPSS_LTR_FOLLOW		(-2)
 
 #define PROPERTY_ENTRY_U32(_name, _value) { .name = _name, .value = _value }
 #define PROPERTY_ENTRY_BOOL(_name) PROPERTY_ENTRY_U32(_name, 0)
@@ -131,14 +188,14 @@ struct intel_lpss_platform_info {
 	int irq;
 	unsigned long clock_rate;
 	const char *clock_con_id;
-	struct property_entry *properties;
+	const struct lpss_property *properties;
 };
 
 static const struct intel_lpss_platform_info spt_info = {
 	.clock_rate = 120000000,
 };
 
-static struct property_entry spt_i2c_properties[] = {
+static const struct lpss_property spt_i2c_properties[] = {
 	PROPERTY_ENTRY_U32("i2c-sda-hold-time-ns", 230),
 	{ },
 };
@@ -148,7 +205,7 @@ static const struct intel_lpss_platform_info spt_i2c_info = {
 	.properties = spt_i2c_properties,
 };
 
-static struct property_entry uart_properties[] = {
+static const struct lpss_property uart_properties[] = {
 	PROPERTY_ENTRY_U32("reg-io-width", 4),
 	PROPERTY_ENTRY_U32("reg-shift", 2),
 	PROPERTY_ENTRY_BOOL("snps,uart-16550-compatible"),
@@ -171,7 +228,7 @@ static const struct intel_lpss_platform_info bxt_uart_info = {
 	.properties = uart_properties,
 };
 
-static struct property_entry bxt_i2c_properties[] = {
+static const struct lpss_property bxt_i2c_properties[] = {
 	PROPERTY_ENTRY_U32("i2c-sda-hold-time-ns", 42),
 	PROPERTY_ENTRY_U32("i2c-sda-falling-time-ns", 171),
 	PROPERTY_ENTRY_U32("i2c-scl-falling-time-ns", 208),
@@ -183,7 +240,7 @@ static const struct intel_lpss_platform_info bxt_i2c_info = {
 	.properties = bxt_i2c_properties,
 };
 
-static struct property_entry apl_i2c_properties[] = {
+static const struct lpss_property apl_i2c_properties[] = {
 	PROPERTY_ENTRY_U32("i2c-sda-hold-time-ns", 207),
 	PROPERTY_ENTRY_U32("i2c-sda-falling-time-ns", 171),
 	PROPERTY_ENTRY_U32("i2c-scl-falling-time-ns", 208),
@@ -357,7 +414,8 @@ lpss_pci_probe(device_t dev)
 					intel_lpss_pci_ids[i].device);
 #endif
 			sc = device_get_softc(dev);
-			sc->sc_clock_rate = intel_lpss_pci_ids[i].info->clock_rate;
+			sc->sc_info = intel_lpss_pci_ids[i].info;
+			sc->sc_clock_rate = sc->sc_info->clock_rate;
 			device_set_desc(dev, "Intel LPSS PCI Driver");
 			return (BUS_PROBE_DEFAULT);
 		}
@@ -370,25 +428,33 @@ static bool intel_lpss_has_idma(const struct lpss_softc *sc)
 	return (sc->sc_caps & LPSS_PRIV_CAPS_NO_IDMA) == 0;
 }
 
-static void intel_lpss_set_remap_addr(const struct lpss_softc *sc)
+static void intel_lpss_set_remap_addr(struct lpss_softc *sc, uint64_t addr)
 {
-	lo_hi_writeq(&sc->sc_map_priv, LPSS_PRIV_REMAP_ADDR,
-			(uintptr_t)sc->sc_map_priv.r_vaddr);
+	mtx_assert(&sc->sc_mtx, MA_OWNED);
+	if (addr == sc->sc_remap)
+		return;
+	lo_hi_writeq(&sc->sc_map_priv, LPSS_PRIV_REMAP_ADDR, addr);
+	sc->sc_remap = addr;
 }
 
-static void intel_lpss_deassert_reset(const struct lpss_softc *sc)
+static void intel_lpss_deassert_reset(struct lpss_softc *sc)
 {
 	/* Bring out the device from reset */
-	LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_RESETS,
-			LPSS_PRIV_RESETS_FUNC | LPSS_PRIV_RESETS_IDMA);
+	sc->sc_resets = LPSS_PRIV_RESETS_FUNC | LPSS_PRIV_RESETS_IDMA;
+	LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_RESETS, sc->sc_resets);
 }
 
-static void intel_lpss_init_dev(const struct lpss_softc *sc)
+static void intel_lpss_init_dev(struct lpss_softc *sc)
 {
 	intel_lpss_deassert_reset(sc);
 
 	if (intel_lpss_has_idma(sc)) {
-		intel_lpss_set_remap_addr(sc);
+		/* The iDMA engine needs the bus address of the BAR. */
+		mtx_lock(&sc->sc_mtx);
+		sc->sc_remap = LPSS_PRIV_READ_4(sc, LPSS_PRIV_REMAP_ADDR) |
+		    (uint64_t)LPSS_PRIV_READ_4(sc, LPSS_PRIV_REMAP_ADDR + 4) << 32;
+		intel_lpss_set_remap_addr(sc, rman_get_start(sc->sc_mem_res));
+		mtx_unlock(&sc->sc_mtx);
 
 		/* Make sure that SPI multiblock DMA transfers are re-enabled */
 		if (sc->sc_type == LPSS_PRIV_TYPE_SPI) {
@@ -398,6 +464,389 @@ static void intel_lpss_init_dev(const struct lpss_softc *sc)
 	}
 }
 
+/*
+ * Latency tolerance reporting, see intel_lpss_ltr_set() in the linux
+ * driver.  The same value is used for the active and idle LTR.
+ */
+static uint32_t
+lpss_ltr_encode(int us)
+{
+	if (us < 0)
+		return (0);
+	if (us > LPSS_PRIV_LTR_VALUE_MASK)
+		return (LPSS_PRIV_LTR_REQ | LPSS_PRIV_LTR_SCALE_32US |
+		    min(us >> 5, LPSS_PRIV_LTR_VALUE_MASK));
+	return (LPSS_PRIV_LTR_REQ | LPSS_PRIV_LTR_SCALE_1US | us);
+}
+
+static void
+lpss_ltr_update(struct lpss_softc *sc)
+{
+	uint32_t ltr;
+
+	mtx_assert(&sc->sc_mtx, MA_OWNED);
+	ltr = lpss_ltr_encode(sc->sc_ltr_override_us != LPSS_LTR_FOLLOW ?
+	    sc->sc_ltr_override_us : sc->sc_ltr_req_us);
+	if (ltr == sc->sc_ltr)
+		return;
+	LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_ACTIVELTR, ltr);
+	LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_IDLELTR, ltr);
+	sc->sc_ltr = ltr;
+}
+
+static void
+lpss_set_ltr(device_t dev, device_t child, int us)
+{
+	struct lpss_softc *sc;
+
+	sc = device_get_softc(dev);
+	mtx_lock(&sc->sc_mtx);
+	sc->sc_ltr_req_us = us;
+	lpss_ltr_update(sc);
+	mtx_unlock(&sc->sc_mtx);
+}
+
+/*
+ * Fractional clock divider, output = sc_clock_rate * M / N, see
+ * intel_lpss_register_clock_divider() in the linux driver.
+ *
+ * Rates UART and SPI drivers commonly ask for (16x the standard baud
+ * rates up to 4 Mbaud, SPI clocks up to 50 MHz) are resolved once at
+ * attach, other requests search the divider on the fly.
+ */
+static const uint64_t lpss_clk_std_rates[] = {
+	/* UART: 16 * baud */
+	16 * 9600, 16 * 19200, 16 * 38400, 16 * 57600, 16 * 115200,
+	16 * 230400, 16 * 460800, 16 * 500000, 16 * 576000, 16 * 921600,
+	16 * 1000000, 16 * 1152000, 16 * 1500000, 16 * 2000000,
+	16 * 2500000, 16 * 3000000, 16 * 3500000, 16 * 4000000,
+	/* SPI */
+	1000000, 2000000, 4000000, 5000000, 8000000, 10000000, 12500000,
+	16000000, 20000000, 25000000, 33333333, 40000000, 50000000,
+};
+
+/*
+ * Best rational approximation m/n of rate/parent with m, n <= max using
+ * continued fractions, cf. rational_best_approximation() in linux.
+ */
+static void
+lpss_clk_best_div(uint64_t rate, uint64_t parent, uint16_t *mp, uint16_t *np)
+{
+	uint64_t num, den, a, t;
+	uint64_t m0, m1, n0, n1;
+
+	if (rate >= parent || rate == 0) {
+		*mp = *np = 1;
+		return;
+	}
+
+	num = rate;
+	den = parent;
+	m0 = 0; m1 = 1;
+	n0 = 1; n1 = 0;
+	while (den != 0) {
+		a = num / den;
+		if (m1 * a + m0 > LPSS_PRIV_CLOCK_MN_MAX ||
+		    n1 * a + n0 > LPSS_PRIV_CLOCK_MN_MAX) {
+			/* Try the best semiconvergent that still fits. */
+			t = (LPSS_PRIV_CLOCK_MN_MAX - n0) / n1;
+			if (m1 != 0 && (LPSS_PRIV_CLOCK_MN_MAX - m0) / m1 < t)
+				t = (LPSS_PRIV_CLOCK_MN_MAX - m0) / m1;
+			if (2 * t >= a && t != 0) {
+				m1 = m1 * t + m0;
+				n1 = n1 * t + n0;
+			}
+			break;
+		}
+		t = m1 * a + m0; m0 = m1; m1 = t;
+		t = n1 * a + n0; n0 = n1; n1 = t;
+		t = num % den; num = den; den = t;
+	}
+	if (m1 == 0) {
+		m1 = 1;
+		n1 = LPSS_PRIV_CLOCK_MN_MAX;
+	}
+	*mp = m1;
+	*np = n1;
+}
+
+static void
+lpss_clk_init_table(struct lpss_softc *sc)
+{
+	int i;
+
+	sc->sc_clk_count = nitems(lpss_clk_std_rates);
+	sc->sc_clk_table = malloc(sc->sc_clk_count * sizeof(*sc->sc_clk_table),
+	    M_DEVBUF, M_WAITOK);
+	for (i = 0; i < sc->sc_clk_count; i++) {
+		sc->sc_clk_table[i].rate = lpss_clk_std_rates[i];
+		lpss_clk_best_div(lpss_clk_std_rates[i], sc->sc_clock_rate,
+		    &sc->sc_clk_table[i].m, &sc->sc_clk_table[i].n);
+	}
+}
+
+static uint64_t
+lpss_clk_params_rate(const struct lpss_softc *sc, uint32_t params)
+{
+	uint64_t m, n;
+
+	if ((params & LPSS_PRIV_CLOCK_EN) == 0)
+		return (0);
+	m = (params >> LPSS_PRIV_CLOCK_M_SHIFT) & LPSS_PRIV_CLOCK_MN_MAX;
+	n = (params >> LPSS_PRIV_CLOCK_N_SHIFT) & LPSS_PRIV_CLOCK_MN_MAX;
+	if (n == 0)
+		return (0);
+	return (sc->sc_clock_rate * m / n);
+}
+
+static void
+lpss_clk_write(struct lpss_softc *sc, uint32_t params)
+{
+	mtx_assert(&sc->sc_mtx, MA_OWNED);
+	/* The new M/N take effect once UPDATE is set. */
+	LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_CLOCK_PARAMS, params);
+	LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_CLOCK_PARAMS,
+	    params | LPSS_PRIV_CLOCK_UPDATE);
+	sc->sc_clk_params = params;
+}
+
+static int
+lpss_set_clock_rate(device_t dev, device_t child, uint64_t rate,
+    uint64_t *actual)
+{
+	struct lpss_softc *sc;
+	uint32_t params;
+	uint16_t m, n;
+	int i;
+
+	sc = device_get_softc(dev);
+	if (sc->sc_type == LPSS_PRIV_TYPE_I2C || sc->sc_clock_rate == 0)
+		return (ENODEV);
+
+	for (i = 0; i < sc->sc_clk_count; i++)
+		if (sc->sc_clk_table[i].rate == rate)
+			break;
+	if (i < sc->sc_clk_count) {
+		m = sc->sc_clk_table[i].m;
+		n = sc->sc_clk_table[i].n;
+	} else
+		lpss_clk_best_div(rate, sc->sc_clock_rate, &m, &n);
+
+	params = LPSS_PRIV_CLOCK_EN | (uint32_t)m << LPSS_PRIV_CLOCK_M_SHIFT |
+	    (uint32_t)n << LPSS_PRIV_CLOCK_N_SHIFT;
+	mtx_lock(&sc->sc_mtx);
+	if (params != sc->sc_clk_params)
+		lpss_clk_write(sc, params);
+	mtx_unlock(&sc->sc_mtx);
+
+	if (actual != NULL)
+		*actual = lpss_clk_params_rate(sc, params);
+	return (0);
+}
+
+static uint64_t
+lpss_get_clock_rate(device_t dev, device_t child)
+{
+	struct lpss_softc *sc;
+
+	sc = device_get_softc(dev);
+	if (sc->sc_type == LPSS_PRIV_TYPE_I2C)
+		return (sc->sc_clock_rate);
+	return (lpss_clk_params_rate(sc, sc->sc_clk_params));
+}
+
+/*
+ * Function reset and device idle.  DEVIDLE tells whether the function
+ * lost its context while idle, in which case the private registers are
+ * reprogrammed from the shadows as well.
+ */
+static void
+lpss_reset_locked(struct lpss_softc *sc)
+{
+	mtx_assert(&sc->sc_mtx, MA_OWNED);
+	LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_RESETS, 0);
+	intel_lpss_deassert_reset(sc);
+}
+
+static void
+lpss_reset(device_t dev, device_t child)
+{
+	struct lpss_softc *sc;
+
+	sc = device_get_softc(dev);
+	mtx_lock(&sc->sc_mtx);
+	lpss_reset_locked(sc);
+	mtx_unlock(&sc->sc_mtx);
+}
+
+static void
+lpss_priv_restore(struct lpss_softc *sc)
+{
+	uint64_t remap;
+
+	mtx_assert(&sc->sc_mtx, MA_OWNED);
+	LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_ACTIVELTR, sc->sc_ltr);
+	LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_IDLELTR, sc->sc_ltr);
+	if (sc->sc_type != LPSS_PRIV_TYPE_I2C &&
+	    (sc->sc_clk_params & LPSS_PRIV_CLOCK_EN) != 0)
+		lpss_clk_write(sc, sc->sc_clk_params);
+	if (sc->sc_type == LPSS_PRIV_TYPE_SPI)
+		LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_CS_CTRL, sc->sc_cs_ctrl);
+	if (intel_lpss_has_idma(sc)) {
+		remap = sc->sc_remap;
+		sc->sc_remap = ~remap;
+		intel_lpss_set_remap_addr(sc, remap);
+	}
+}
+
+static int
+lpss_restore_required(device_t dev, device_t child)
+{
+	struct lpss_softc *sc;
+	uint32_t v;
+
+	sc = device_get_softc(dev);
+	v = LPSS_PRIV_READ_4(sc, LPSS_PRIV_DEVIDLE);
+	if ((v & LPSS_PRIV_DEVIDLE_RESTORE) == 0)
+		return (0);
+
+	mtx_lock(&sc->sc_mtx);
+	LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_DEVIDLE,
+	    LPSS_PRIV_DEVIDLE_IDLE | LPSS_PRIV_DEVIDLE_RESTORE);
+	LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_DEVIDLE, 0);
+	sc->sc_devidle = 0;
+	lpss_reset_locked(sc);
+	lpss_priv_restore(sc);
+	mtx_unlock(&sc->sc_mtx);
+	DELAY(1000);
+	return (1);
+}
+
+static void
+lpss_set_idle(device_t dev, device_t child, int idle)
+{
+	struct lpss_softc *sc;
+	uint32_t v;
+
+	sc = device_get_softc(dev);
+	v = idle ? LPSS_PRIV_DEVIDLE_IDLE : 0;
+	mtx_lock(&sc->sc_mtx);
+	if (v != sc->sc_devidle) {
+		LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_DEVIDLE, v);
+		sc->sc_devidle = v;
+	}
+	mtx_unlock(&sc->sc_mtx);
+}
+
+static void
+lpss_set_cs(device_t dev, device_t child, int cs, int high)
+{
+	struct lpss_softc *sc;
+	uint32_t v;
+
+	sc = device_get_softc(dev);
+	if (sc->sc_type != LPSS_PRIV_TYPE_SPI)
+		return;
+	v = LPSS_PRIV_CS_CTRL_SW_MODE |
+	    ((cs << LPSS_PRIV_CS_CTRL_SEL_SHIFT) & LPSS_PRIV_CS_CTRL_SEL_MASK) |
+	    (high ? LPSS_PRIV_CS_CTRL_HIGH : 0);
+	mtx_lock(&sc->sc_mtx);
+	if (v != sc->sc_cs_ctrl) {
+		LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_CS_CTRL, v);
+		sc->sc_cs_ctrl = v;
+	}
+	mtx_unlock(&sc->sc_mtx);
+}
+
+static void
+lpss_remap(device_t dev, device_t child, uint64_t addr)
+{
+	struct lpss_softc *sc;
+
+	sc = device_get_softc(dev);
+	if (!intel_lpss_has_idma(sc))
+		return;
+	mtx_lock(&sc->sc_mtx);
+	intel_lpss_set_remap_addr(sc, addr);
+	mtx_unlock(&sc->sc_mtx);
+}
+
+static int
+lpss_sysctl_clock_rate(SYSCTL_HANDLER_ARGS)
+{
+	struct lpss_softc *sc = arg1;
+	uint64_t rate;
+
+	rate = lpss_get_clock_rate(sc->sc_dev, NULL);
+	return (sysctl_handle_64(oidp, &rate, 0, req));
+}
+
+static int
+lpss_sysctl_ltr_override(SYSCTL_HANDLER_ARGS)
+{
+	struct lpss_softc *sc = arg1;
+	int error;
+	int us;
+
+	us = sc->sc_ltr_override_us;
+	error = sysctl_handle_int(oidp, &us, 0, req);
+	if (error != 0 || req->newptr == NULL)
+		return (error);
+	if (us < LPSS_LTR_FOLLOW)
+		return (EINVAL);
+	mtx_lock(&sc->sc_mtx);
+	sc->sc_ltr_override_us = us;
+	lpss_ltr_update(sc);
+	mtx_unlock(&sc->sc_mtx);
+	return (0);
+}
+
+static int
+lpss_sysctl_priv_reg(SYSCTL_HANDLER_ARGS)
+{
+	struct lpss_softc *sc = arg1;
+	uint32_t v;
+
+	v = LPSS_PRIV_READ_4(sc, arg2);
+	return (sysctl_handle_32(oidp, &v, 0, req));
+}
+
+static void
+lpss_sysctl_init(struct lpss_softc *sc)
+{
+	struct sysctl_ctx_list *ctx;
+	struct sysctl_oid_list *children;
+
+	ctx = device_get_sysctl_ctx(sc->sc_dev);
+	children = SYSCTL_CHILDREN(device_get_sysctl_tree(sc->sc_dev));
+
+	SYSCTL_ADD_U64(ctx, children, OID_AUTO, "resume_us", CTLFLAG_RD,
+	    &sc->sc_resume_us, 0, "Duration of the last resume in microseconds");
+	SYSCTL_ADD_PROC(ctx, children, OID_AUTO, "active_ltr",
+	    CTLTYPE_U32 | CTLFLAG_RD | CTLFLAG_MPSAFE, sc, LPSS_PRIV_ACTIVELTR,
+	    lpss_sysctl_priv_reg, "IU", "Active LTR register");
+	SYSCTL_ADD_PROC(ctx, children, OID_AUTO, "idle_ltr",
+	    CTLTYPE_U32 | CTLFLAG_RD | CTLFLAG_MPSAFE, sc, LPSS_PRIV_IDLELTR,
+	    lpss_sysctl_priv_reg, "IU", "Idle LTR register");
+	SYSCTL_ADD_INT(ctx, children, OID_AUTO, "ltr_request_us", CTLFLAG_RD,
+	    &sc->sc_ltr_req_us, 0,
+	    "Latency tolerance requested by the child in us (-1: none)");
+	SYSCTL_ADD_PROC(ctx, children, OID_AUTO, "clock_rate",
+	    CTLTYPE_U64 | CTLFLAG_RD | CTLFLAG_MPSAFE, sc, 0,
+	    lpss_sysctl_clock_rate, "QU", "Function clock rate in Hz");
+	SYSCTL_ADD_PROC(ctx, children, OID_AUTO, "ltr_override_us",
+	    CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_MPSAFE, sc, 0,
+	    lpss_sysctl_ltr_override, "I",
+	    "Fixed latency tolerance in us (-1: none, -2: follow the child)");
+}
+
+/* Child driver for each LPSS_PRIV_TYPE_* */
+static const char *lpss_child_names[] = {
+	[LPSS_PRIV_TYPE_I2C] =	"ig4iic_lpss",
+	[LPSS_PRIV_TYPE_UART] =	"uart",
+	[LPSS_PRIV_TYPE_SPI] =	"lpss_spi",
+};
+
 static int
 lpss_pci_attach(device_t dev)
 {
@@ -412,6 +861,9 @@ lpss_pci_attach(device_t dev)
 		goto error;
 	}
 	sc->sc_dev = dev;
+	mtx_init(&sc->sc_mtx, "lpss", NULL, MTX_DEF);
+	sc->sc_ltr_req_us = LPSS_LTR_NONE;
+	sc->sc_ltr_override_us = LPSS_LTR_FOLLOW;
 	sc->sc_mem_rid = PCIR_BAR(0);
 	sc->sc_mem_res = bus_alloc_resource_any(sc->sc_dev,
 	    SYS_RES_MEMORY, &sc->sc_mem_rid, RF_ACTIVE | RF_SHAREABLE);
@@ -420,32 +872,41 @@ lpss_pci_attach(device_t dev)
 		goto error;
 	}
 
-	if (pci_alloc_msi(dev, &count) == 0) {
+	sc->sc_mem_rman.rm_type = RMAN_ARRAY;
+	sc->sc_mem_rman.rm_descr = "LPSS function windows";
+	if (rman_init(&sc->sc_mem_rman) != 0) {
+		device_printf(dev, "Can't initialize memory windows\n");
+		goto error;
+	}
+	sc->sc_rman_init = 1;
+	if (rman_manage_region(&sc->sc_mem_rman, rman_get_start(sc->sc_mem_res),
+	    rman_get_end(sc->sc_mem_res)) != 0) {
+		device_printf(dev, "Can't manage memory windows\n");
+		goto error;
+	}
+
+	/* Prefer MSI, fall back to shared INTx. */
+	count = 1;
+	if (pci_msi_count(dev) > 0 && pci_alloc_msi(dev, &count) == 0) {
 		device_printf(dev, "Using MSI\n");
+		sc->sc_irq_msi = 1;
 		sc->sc_irq_rid = 1;
 	} else {
+		sc->sc_irq_msi = 0;
 		sc->sc_irq_rid = 0;
 	}
-	sc->sc_irq_res = bus_alloc_resource_any(sc->sc_dev,
-	    SYS_RES_IRQ, &sc->sc_irq_rid, RF_ACTIVE | RF_SHAREABLE);
+	sc->sc_irq_res = bus_alloc_resource_any(sc->sc_dev, SYS_RES_IRQ,
+	    &sc->sc_irq_rid, RF_ACTIVE | (sc->sc_irq_msi ? 0 : RF_SHAREABLE));
 	if (sc->sc_irq_res == NULL) {
 		device_printf(dev, "Can't allocate IRQ resource\n");
 		goto error;
 	}
 	device_printf(dev, "IRQ: %d\n", sc->sc_irq_rid);
 
-	/* Set up DEV memory region */
-	resource_init_map_request(&map_req);
-	map_req.offset = LPSS_DEV_OFFSET;
-	map_req.length = LPSS_DEV_SIZE;
-	if (bus_map_resource(sc->sc_dev, SYS_RES_MEMORY, sc->sc_mem_res,
-				&map_req, &sc->sc_map_dev) != 0)
-	{
-		device_printf(dev, "Can't map DEV memory resource\n");
-		goto error;
-	}
-
-	/* Set up PRIV memory region */
+	/*
+	 * Set up PRIV memory region.  The function registers are only
+	 * touched by the child, through its LPSS_RID_DEV window.
+	 */
 	resource_init_map_request(&map_req);
 	map_req.offset = LPSS_PRIV_OFFSET;
 	map_req.length = LPSS_PRIV_SIZE;
@@ -471,24 +932,50 @@ lpss_pci_attach(device_t dev)
 
 	/* Finish initialization */
 	intel_lpss_init_dev(sc);
+	sc->sc_ltr = LPSS_PRIV_READ_4(sc, LPSS_PRIV_ACTIVELTR);
+	sc->sc_devidle = LPSS_PRIV_READ_4(sc, LPSS_PRIV_DEVIDLE) &
+	    LPSS_PRIV_DEVIDLE_IDLE;
+	if (sc->sc_type == LPSS_PRIV_TYPE_SPI)
+		sc->sc_cs_ctrl = LPSS_PRIV_READ_4(sc, LPSS_PRIV_CS_CTRL);
+	if (sc->sc_type != LPSS_PRIV_TYPE_I2C) {
+		sc->sc_clk_params = LPSS_PRIV_READ_4(sc, LPSS_PRIV_CLOCK_PARAMS) &
+		    ~LPSS_PRIV_CLOCK_UPDATE;
+		lpss_clk_init_table(sc);
+	}
+	lpss_sysctl_init(sc);
 
-#if 0
-	if (sc->sc_type == LPSS_PRIV_TYPE_I2C) {
-		device_add_child(dev, "ig4iic_lpss", -1);
+	/*
+	 * The function type is known here, so add the one matching child
+	 * directly; it is handed the register windows mapped above.
+	 */
+	sc->sc_child = device_add_child(dev, lpss_child_names[sc->sc_type], -1);
+	if (sc->sc_child == NULL) {
+		device_printf(dev, "Can't add %s child\n",
+		    lpss_child_names[sc->sc_type]);
+		goto error;
 	}
-#endif
 
 	return bus_generic_attach(dev);
 
 error:
 	bus_unmap_resource(sc->sc_dev, SYS_RES_MEMORY, sc->sc_mem_res, &sc->sc_map_priv);
-	bus_unmap_resource(sc->sc_dev, SYS_RES_MEMORY, sc->sc_mem_res, &sc->sc_map_dev);
 	if (sc->sc_mem_res != NULL) {
 		bus_release_resource(dev, SYS_RES_MEMORY, sc->sc_mem_rid, sc->sc_mem_res);
 	}
 	if (sc->sc_irq_res != NULL) {
 		bus_release_resource(dev, SYS_RES_IRQ, sc->sc_irq_rid, sc->sc_irq_res);
 	}
+	if (sc->sc_irq_msi) {
+		pci_release_msi(dev);
+		sc->sc_irq_msi = 0;
+	}
+	if (sc->sc_rman_init) {
+		rman_fini(&sc->sc_mem_rman);
+		sc->sc_rman_init = 0;
+	}
+	free(sc->sc_clk_table, M_DEVBUF);
+	sc->sc_clk_table = NULL;
+	mtx_destroy(&sc->sc_mtx);
 
 	return ENXIO;
 }
@@ -497,6 +984,7 @@ static int
 lpss_pci_detach(device_t dev)
 {
 	struct lpss_softc *sc;
+	int error;
 
 	sc = device_get_softc(dev);
 
@@ -504,15 +992,33 @@ lpss_pci_detach(device_t dev)
 		device_printf(dev, "Error getting softc from device.");
 		return ENXIO;
 	}
+
+	/* Children use the shared resources and services until detached */
+	error = bus_generic_detach(dev);
+	if (error != 0)
+		return (error);
+	device_delete_children(dev);
+	sc->sc_child = NULL;
+
 	bus_unmap_resource(sc->sc_dev, SYS_RES_MEMORY, sc->sc_mem_res, &sc->sc_map_priv);
-	bus_unmap_resource(sc->sc_dev, SYS_RES_MEMORY, sc->sc_mem_res, &sc->sc_map_dev);
 	if (sc->sc_mem_res != NULL) {
 		bus_release_resource(dev, SYS_RES_MEMORY, sc->sc_mem_rid, sc->sc_mem_res);
 	}
 	if (sc->sc_irq_res != NULL) {
 		bus_release_resource(dev, SYS_RES_IRQ, sc->sc_irq_rid, sc->sc_irq_res);
 	}
-	return bus_generic_detach(dev);
+	if (sc->sc_irq_msi) {
+		pci_release_msi(dev);
+		sc->sc_irq_msi = 0;
+	}
+	if (sc->sc_rman_init) {
+		rman_fini(&sc->sc_mem_rman);
+		sc->sc_rman_init = 0;
+	}
+	free(sc->sc_clk_table, M_DEVBUF);
+	sc->sc_clk_table = NULL;
+	mtx_destroy(&sc->sc_mtx);
+	return (0);
 }
 
 static int
@@ -526,6 +1032,7 @@ lpss_pci_suspend(device_t dev)
 {
 	struct lpss_softc *sc;
 	unsigned int i;
+	int error;
 
 	sc = device_get_softc(dev);
 	if (!sc) {
@@ -533,6 +1040,11 @@ lpss_pci_suspend(device_t dev)
 		return ENXIO;
 	}
 
+	/* Children save their own state before the function goes to reset */
+	error = bus_generic_suspend(dev);
+	if (error != 0)
+		return (error);
+
 	/* Save device context */
 	for (i = 0; i < LPSS_PRIV_REG_COUNT; i++) {
 		sc->priv_ctx[i] = LPSS_PRIV_READ_4(sc, i * 4);
@@ -554,6 +1066,7 @@ static int
 lpss_pci_resume(device_t dev)
 {
 	struct lpss_softc *sc;
+	sbintime_t start;
 	unsigned int i;
 
 	sc = device_get_softc(dev);
@@ -562,22 +1075,78 @@ lpss_pci_resume(device_t dev)
 		return ENXIO;
 	}
 
+	start = sbinuptime();
 	intel_lpss_deassert_reset(sc);
 
 	/* Restore device context */
 	for (i = 0; i < LPSS_PRIV_REG_COUNT; i++) {
-		LPSS_PRIV_WRITE_4(sc, sc->priv_ctx[i], i * 4);
+		LPSS_PRIV_WRITE_4(sc, i * 4, sc->priv_ctx[i]);
 	}
-
-	return 0;
+	/* The restored divider only takes effect once latched. */
+	if (sc->sc_type != LPSS_PRIV_TYPE_I2C &&
+	    (sc->sc_clk_params & LPSS_PRIV_CLOCK_EN) != 0)
+		LPSS_PRIV_WRITE_4(sc, LPSS_PRIV_CLOCK_PARAMS,
+		    sc->sc_clk_params | LPSS_PRIV_CLOCK_UPDATE);
+	sc->sc_resume_us = sbttous(sbinuptime() - start);
+	if (bootverbose)
+		device_printf(dev, "resumed in %ju us\n",
+		    (uintmax_t)sc->sc_resume_us);
+
+	return bus_generic_resume(dev);
 }
 
 static device_t
 lpss_add_child(device_t dev, u_int order, const char *name, int unit)
 {
-	device_printf(dev, "%s: Entered order=%u name=\"%s\" unit=%d.\n", __func__,
-			order, name, unit);
-	return device_add_child_ordered(dev, order, name, unit);
+	return (device_add_child_ordered(dev, order, name, unit));
+}
+
+static bool
+lpss_is_window(const struct lpss_softc *sc, struct resource *r)
+{
+	return (sc->sc_rman_init &&
+	    rman_is_region_manager(r, __DECONST(struct rman *,
+	    &sc->sc_mem_rman)));
+}
+
+/*
+ * Memory resources of the child are windows of the BAR, carved out of
+ * the parent's mapping rather than mapped again.
+ */
+static struct resource *
+lpss_alloc_window(struct lpss_softc *sc, device_t child, int rid, u_int flags)
+{
+	struct resource *r;
+	bus_space_handle_t bsh;
+	rman_res_t start;
+	bus_size_t offset, size;
+
+	if ((u_int)rid >= nitems(lpss_windows))
+		return (NULL);
+	if (rid == LPSS_RID_IDMA && !intel_lpss_has_idma(sc))
+		return (NULL);
+	offset = lpss_windows[rid].offset;
+	size = lpss_windows[rid].size;
+
+	start = rman_get_start(sc->sc_mem_res) + offset;
+	r = rman_reserve_resource(&sc->sc_mem_rman, start, start + size - 1,
+	    size, flags & ~RF_ACTIVE, child);
+	if (r == NULL)
+		return (NULL);
+	rman_set_rid(r, rid);
+	if (bus_space_subregion(rman_get_bustag(sc->sc_mem_res),
+	    rman_get_bushandle(sc->sc_mem_res), offset, size, &bsh) != 0) {
+		rman_release_resource(r);
+		return (NULL);
+	}
+	rman_set_bustag(r, rman_get_bustag(sc->sc_mem_res));
+	rman_set_bushandle(r, bsh);
+	rman_set_virtual(r, (char *)rman_get_virtual(sc->sc_mem_res) + offset);
+	if ((flags & RF_ACTIVE) != 0 && rman_activate_resource(r) != 0) {
+		rman_release_resource(r);
+		return (NULL);
+	}
+	return (r);
 }
 
 static struct resource *
@@ -586,58 +1155,148 @@ lpss_alloc_resource(device_t dev, device_t child, int type, int *rid,
 {
 	struct lpss_softc *sc;
 
-	device_printf(dev, "%s: Entered.\n", __func__);
 	sc = device_get_softc(dev);
-	switch (type)
-	{
-		case SYS_RES_MEMORY:
-			if (*rid == sc->sc_mem_rid) {
-				device_printf(dev, "%s: Returning memory resource 0x%p.\n", __func__, sc->sc_mem_res);
-				return sc->sc_mem_res;
-			}
-			break;
-		case SYS_RES_IRQ:
-			if (*rid == sc->sc_irq_rid) {
-				device_printf(dev, "%s: Returning IRQ resource 0x%p.\n", __func__, sc->sc_mem_res);
-				return sc->sc_irq_res;
-			}
-			break;
-
-		default:
-			break;
+	if (device_get_parent(child) != dev)
+		return (bus_generic_alloc_resource(dev, child, type, rid,
+		    start, end, count, flags));
+
+	switch (type) {
+	case SYS_RES_MEMORY:
+		return (lpss_alloc_window(sc, child, *rid, flags));
+	case SYS_RES_IRQ:
+		/*
+		 * Children ask for rid 0; hand them the MSI or INTx
+		 * line allocated at attach.
+		 */
+		if (*rid == 0 || *rid == sc->sc_irq_rid)
+			return (sc->sc_irq_res);
+		return (NULL);
+	default:
+		return (NULL);
 	}
-	return bus_generic_alloc_resource(dev, child, type, rid, start, end, count, flags);
 }
 
 static int
 lpss_release_resource(device_t dev, device_t child, int type, int rid,
     struct resource *r)
 {
-	device_printf(dev, "%s: Entered.\n", __func__);
-	return bus_generic_release_resource(dev, child, type, rid, r);
+	struct lpss_softc *sc;
+
+	sc = device_get_softc(dev);
+	/* Shared resources are released by the parent at detach. */
+	if (r == sc->sc_mem_res || r == sc->sc_irq_res)
+		return (0);
+	if (lpss_is_window(sc, r)) {
+		if (rman_get_flags(r) & RF_ACTIVE)
+			rman_deactivate_resource(r);
+		return (rman_release_resource(r));
+	}
+	return (bus_generic_release_resource(dev, child, type, rid, r));
+}
+
+static int
+lpss_activate_resource(device_t dev, device_t child, int type, int rid,
+    struct resource *r)
+{
+	struct lpss_softc *sc;
+
+	sc = device_get_softc(dev);
+	if (r == sc->sc_irq_res)
+		return (0);
+	if (lpss_is_window(sc, r))
+		return (rman_activate_resource(r));
+	return (bus_generic_activate_resource(dev, child, type, rid, r));
+}
+
+static int
+lpss_deactivate_resource(device_t dev, device_t child, int type, int rid,
+    struct resource *r)
+{
+	struct lpss_softc *sc;
+
+	sc = device_get_softc(dev);
+	if (r == sc->sc_irq_res)
+		return (0);
+	if (lpss_is_window(sc, r))
+		return (rman_deactivate_resource(r));
+	return (bus_generic_deactivate_resource(dev, child, type, rid, r));
 }
 
 static int
 lpss_adjust_resource(device_t bus, device_t child, int type, struct resource *r,
     rman_res_t start, rman_res_t end)
 {
-	device_printf(bus, "%s: Entered.\n", __func__);
-	return bus_generic_adjust_resource(bus, child, type, r, start, end);
+	struct lpss_softc *sc;
+
+	sc = device_get_softc(bus);
+	/* The windows are fixed by the hardware layout. */
+	if (r == sc->sc_mem_res || r == sc->sc_irq_res || lpss_is_window(sc, r))
+		return (EINVAL);
+	return (bus_generic_adjust_resource(bus, child, type, r, start, end));
 }
 
-#if 0
+/*
+ * pci(4) only programs and enables MSI when the handler is set up by
+ * one of its own children, so set the child's handler up as ours.
+ */
 static int
-lpss_child_present(device_t dev, device_t child)
+lpss_setup_intr(device_t dev, device_t child, struct resource *irq,
+    int flags, driver_filter_t *filter, driver_intr_t *intr, void *arg,
+    void **cookiep)
 {
-	device_printf(dev, "%s: Entered.\n", __func__);
-	return (bus_child_present(dev));
+	return (BUS_SETUP_INTR(device_get_parent(dev), dev, irq, flags,
+	    filter, intr, arg, cookiep));
+}
+
+static int
+lpss_teardown_intr(device_t dev, device_t child, struct resource *irq,
+    void *cookie)
+{
+	return (BUS_TEARDOWN_INTR(device_get_parent(dev), dev, irq, cookie));
 }
 
 static int
 lpss_read_ivar(device_t dev, device_t child, int which, uintptr_t *result)
+{
+	struct lpss_softc *sc;
+
+	sc = device_get_softc(dev);
+	switch (which) {
+	case LPSS_IVAR_TYPE:
+		*result = sc->sc_type;
+		break;
+	case LPSS_IVAR_INPUT_CLOCK:
+		*result = sc->sc_clock_rate;
+		break;
+	case LPSS_IVAR_PROPERTIES:
+		*result = (uintptr_t)(sc->sc_info != NULL ?
+		    sc->sc_info->properties : NULL);
+		break;
+	default:
+		return (ENOENT);
+	}
+	return (0);
+}
+
+int
+lpss_get_property(device_t child, const char *name, uint32_t *value)
+{
+	const struct lpss_property *p;
+
+	for (p = lpss_get_properties(child); p != NULL && p->name != NULL; p++)
+		if (strcmp(p->name, name) == 0) {
+			*value = p->value;
+			return (0);
+		}
+	return (ENOENT);
+}
+
+#if 0
+static int
+lpss_child_present(device_t dev, device_t child)
 {
 	device_printf(dev, "%s: Entered.\n", __func__);
-	return(ENOENT);
+	return (bus_child_present(dev));
 }
 
 static int
@@ -666,20 +1325,30 @@ static device_method_t lpss_pci_methods[] = {
 
     /* Bus interface */
     DEVMETHOD(bus_add_child,		lpss_add_child),
-    DEVMETHOD(bus_alloc_resource,	lpss_alloc_resource),		/* bus_generic_alloc_resource */
-    DEVMETHOD(bus_release_resource,	lpss_release_resource),		/* bus_generic_release_resource */
-    DEVMETHOD(bus_adjust_resource,	lpss_adjust_resource),		/* bus_generic_adjust_resource */
-    DEVMETHOD(bus_setup_intr,		bus_generic_setup_intr),
-    DEVMETHOD(bus_teardown_intr,	bus_generic_teardown_intr),
+    DEVMETHOD(bus_alloc_resource,	lpss_alloc_resource),
+    DEVMETHOD(bus_release_resource,	lpss_release_resource),
+    DEVMETHOD(bus_activate_resource,	lpss_activate_resource),
+    DEVMETHOD(bus_deactivate_resource,	lpss_deactivate_resource),
+    DEVMETHOD(bus_adjust_resource,	lpss_adjust_resource),
+    DEVMETHOD(bus_setup_intr,		lpss_setup_intr),
+    DEVMETHOD(bus_teardown_intr,	lpss_teardown_intr),
+    DEVMETHOD(bus_bind_intr,		bus_generic_bind_intr),
+    DEVMETHOD(bus_describe_intr,	bus_generic_describe_intr),
+    DEVMETHOD(bus_read_ivar,		lpss_read_ivar),
+
+    /* LPSS interface */
+    DEVMETHOD(lpss_reset,		lpss_reset),
+    DEVMETHOD(lpss_restore_required,	lpss_restore_required),
+    DEVMETHOD(lpss_set_idle,		lpss_set_idle),
+    DEVMETHOD(lpss_set_ltr,		lpss_set_ltr),
+    DEVMETHOD(lpss_remap,		lpss_remap),
+    DEVMETHOD(lpss_set_cs,		lpss_set_cs),
+    DEVMETHOD(lpss_set_clock_rate,	lpss_set_clock_rate),
+    DEVMETHOD(lpss_get_clock_rate,	lpss_get_clock_rate),
 #if 0
     DEVMETHOD(bus_child_present,	lpss_child_present),		/* pcib_child_present */
-    DEVMETHOD(bus_read_ivar,		lpss_read_ivar),		/* pcib_read_ivar */
     DEVMETHOD(bus_write_ivar,		lpss_write_ivar),		/* pcib_write_ivar */
     DEVMETHOD(bus_print_child,		lpss_print_child),		/* lpss_bus_print_child */
-    DEVMETHOD(bus_activate_resource,	bus_generic_activate_resource),
-    DEVMETHOD(bus_deactivate_resource,	bus_generic_deactivate_resource),
-    DEVMETHOD(bus_setup_intr,		bus_generic_setup_intr),
-    DEVMETHOD(bus_teardown_intr,	bus_generic_teardown_intr),
 #endif
 
     DEVMETHOD_END
@@ -0,0 +1,249 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+#include <sys/param.h>
+#include <sys/bus.h>
+#include <sys/kernel.h>
+#include <sys/rman.h>
+#include <sys/systm.h>
+
+#include <machine/bus.h>
+
+#include <dev/intel/lpss_idma.h>
+
+#define BIT(nr) (1UL << (nr))
+
+/* Channel registers */
+#define IDMA64_CH_LENGTH		0x58
+#define IDMA64_CH(ch, reg)		((ch) * IDMA64_CH_LENGTH + (reg))
+#define IDMA64C_SAR			0x00
+#define IDMA64C_DAR			0x08
+#define IDMA64C_LLP			0x10
+#define IDMA64C_CTL_LO			0x18
+#define IDMA64C_CTLL_INT_EN		BIT(0)
+#define IDMA64C_CTLL_DST_WIDTH(x)	((x) << 1)
+#define IDMA64C_CTLL_SRC_WIDTH(x)	((x) << 4)
+#define IDMA64C_CTLL_DST_FIX		BIT(8)
+#define IDMA64C_CTLL_SRC_FIX		BIT(10)
+#define IDMA64C_CTLL_DST_MSIZE(x)	((x) << 11)
+#define IDMA64C_CTLL_SRC_MSIZE(x)	((x) << 14)
+#define IDMA64C_CTLL_FC_M2P		(1 << 20)
+#define IDMA64C_CTLL_FC_P2M		(2 << 20)
+#define IDMA64C_CTL_HI			0x1c
+#define IDMA64C_CTLH_BLOCK_TS_MASK	LPSS_IDMA_MAX_BLOCK
+#define IDMA64C_CFG_LO			0x40
+#define IDMA64C_CFGL_DST_BURST_ALIGN	BIT(0)
+#define IDMA64C_CFGL_SRC_BURST_ALIGN	BIT(1)
+#define IDMA64C_CFG_HI			0x44
+#define IDMA64C_CFGH_SRC_PER(x)		((x) << 0)
+#define IDMA64C_CFGH_DST_PER(x)		((x) << 4)
+
+/* Common registers, one bit per channel plus write enables at bit 8 */
+#define IDMA64_TFR			0
+#define IDMA64_ERROR			4
+#define IDMA64_NINTR			5
+#define IDMA64_RAW(x)			(0x2c0 + (x) * 8)
+#define IDMA64_STATUS(x)		(0x2e8 + (x) * 8)
+#define IDMA64_MASK(x)			(0x310 + (x) * 8)
+#define IDMA64_CLEAR(x)			(0x338 + (x) * 8)
+#define IDMA64_STATUS_INT		0x360
+#define IDMA64_CFG			0x398
+#define IDMA64_CFG_DMA_EN		BIT(0)
+#define IDMA64_CH_EN			0x3a0
+
+#define IDMA64_CH_MASK			((1 << LPSS_IDMA_NCHAN) - 1)
+#define IDMA64_SET(ch)			((1 << ((ch) + 8)) | (1 << (ch)))
+#define IDMA64_CLR(ch)			(1 << ((ch) + 8))
+
+#define RD4(dma, reg)		bus_read_4((dma)->res, (reg))
+#define WR4(dma, reg, val)	bus_write_4((dma)->res, (reg), (val))
+
+int
+lpss_idma_init(struct lpss_idma *dma, device_t dev, struct resource *res)
+{
+	int ch, i;
+
+	dma->dev = dev;
+	dma->res = res;
+	for (ch = 0; ch < LPSS_IDMA_NCHAN; ch++) {
+		WR4(dma, IDMA64_CH_EN, IDMA64_CLR(ch));
+		for (i = 0; i < IDMA64_NINTR; i++)
+			WR4(dma, IDMA64_MASK(i), IDMA64_CLR(ch));
+	}
+	for (i = 0; i < IDMA64_NINTR; i++)
+		WR4(dma, IDMA64_CLEAR(i), IDMA64_CH_MASK);
+	WR4(dma, IDMA64_CFG, IDMA64_CFG_DMA_EN);
+	return (0);
+}
+
+void
+lpss_idma_fini(struct lpss_idma *dma)
+{
+	int ch;
+
+	if (dma->res == NULL)
+		return;
+	for (ch = 0; ch < LPSS_IDMA_NCHAN; ch++)
+		lpss_idma_stop(dma, ch);
+	WR4(dma, IDMA64_CFG, 0);
+	dma->res = NULL;
+}
+
+/*
+ * Start a single block transfer of len bytes between memory and the
+ * FIFO register at bus address fifo.  Channel completion is reported
+ * through the transfer interrupt.
+ */
+void
+lpss_idma_start(struct lpss_idma *dma, int ch, int dir, bus_addr_t mem,
+    bus_addr_t fifo, bus_size_t len, int width)
+{
+	uint32_t ctl;
+
+	KASSERT(ch < LPSS_IDMA_NCHAN, ("%s: bad channel %d", __func__, ch));
+	KASSERT((len >> width) <= LPSS_IDMA_MAX_BLOCK,
+	    ("%s: block too large", __func__));
+
+	ctl = IDMA64C_CTLL_INT_EN | IDMA64C_CTLL_DST_WIDTH(width) |
+	    IDMA64C_CTLL_SRC_WIDTH(width) | IDMA64C_CTLL_DST_MSIZE(0) |
+	    IDMA64C_CTLL_SRC_MSIZE(0);
+	if (dir == LPSS_IDMA_MEM_TO_DEV) {
+		ctl |= IDMA64C_CTLL_DST_FIX | IDMA64C_CTLL_FC_M2P;
+		bus_write_8(dma->res, IDMA64_CH(ch, IDMA64C_SAR), mem);
+		bus_write_8(dma->res, IDMA64_CH(ch, IDMA64C_DAR), fifo);
+	} else {
+		ctl |= IDMA64C_CTLL_SRC_FIX | IDMA64C_CTLL_FC_P2M;
+		bus_write_8(dma->res, IDMA64_CH(ch, IDMA64C_SAR), fifo);
+		bus_write_8(dma->res, IDMA64_CH(ch, IDMA64C_DAR), mem);
+	}
+	bus_write_8(dma->res, IDMA64_CH(ch, IDMA64C_LLP), 0);
+	WR4(dma, IDMA64_CH(ch, IDMA64C_CTL_LO), ctl);
+	WR4(dma, IDMA64_CH(ch, IDMA64C_CTL_HI), len >> width);
+	WR4(dma, IDMA64_CH(ch, IDMA64C_CFG_LO),
+	    IDMA64C_CFGL_DST_BURST_ALIGN | IDMA64C_CFGL_SRC_BURST_ALIGN);
+	/* Handshake 1 requests transmit data, 0 delivers received data. */
+	WR4(dma, IDMA64_CH(ch, IDMA64C_CFG_HI),
+	    IDMA64C_CFGH_DST_PER(1) | IDMA64C_CFGH_SRC_PER(0));
+	dma->len[ch] = len;
+	dma->width[ch] = width;
+
+	WR4(dma, IDMA64_CLEAR(IDMA64_TFR), 1 << ch);
+	WR4(dma, IDMA64_CLEAR(IDMA64_ERROR), 1 << ch);
+	WR4(dma, IDMA64_MASK(IDMA64_TFR), IDMA64_SET(ch));
+	WR4(dma, IDMA64_MASK(IDMA64_ERROR), IDMA64_SET(ch));
+	WR4(dma, IDMA64_CH_EN, IDMA64_SET(ch));
+}
+
+void
+lpss_idma_stop(struct lpss_idma *dma, int ch)
+{
+	WR4(dma, IDMA64_CH_EN, IDMA64_CLR(ch));
+	WR4(dma, IDMA64_MASK(IDMA64_TFR), IDMA64_CLR(ch));
+	WR4(dma, IDMA64_MASK(IDMA64_ERROR), IDMA64_CLR(ch));
+	WR4(dma, IDMA64_CLEAR(IDMA64_TFR), 1 << ch);
+	WR4(dma, IDMA64_CLEAR(IDMA64_ERROR), 1 << ch);
+}
+
+/* Bytes moved so far by the current (or last) block of ch. */
+bus_size_t
+lpss_idma_done(struct lpss_idma *dma, int ch)
+{
+	uint32_t ts;
+
+	ts = RD4(dma, IDMA64_CH(ch, IDMA64C_CTL_HI)) &
+	    IDMA64C_CTLH_BLOCK_TS_MASK;
+	return (MIN((bus_size_t)ts << dma->width[ch], dma->len[ch]));
+}
+
+uint32_t
+lpss_idma_intr(struct lpss_idma *dma, uint32_t *errp)
+{
+	uint32_t tfr, err;
+
+	if (dma->res == NULL || RD4(dma, IDMA64_STATUS_INT) == 0) {
+		*errp = 0;
+		return (0);
+	}
+	tfr = RD4(dma, IDMA64_STATUS(IDMA64_TFR)) & IDMA64_CH_MASK;
+	err = RD4(dma, IDMA64_STATUS(IDMA64_ERROR)) & IDMA64_CH_MASK;
+	if (tfr != 0)
+		WR4(dma, IDMA64_CLEAR(IDMA64_TFR), tfr);
+	if (err != 0)
+		WR4(dma, IDMA64_CLEAR(IDMA64_ERROR), err);
+	*errp = err;
+	return (tfr);
+}
+
+static void
+lpss_idma_buf_cb(void *arg, bus_dma_segment_t *segs, int nseg, int error)
+{
+	struct lpss_idma_buf *buf = arg;
+
+	if (error == 0)
+		buf->pa = segs[0].ds_addr;
+}
+
+int
+lpss_idma_buf_alloc(device_t dev, bus_size_t size, struct lpss_idma_buf *buf)
+{
+	int error;
+
+	buf->size = size;
+	error = bus_dma_tag_create(bus_get_dma_tag(dev), 4, 0,
+	    BUS_SPACE_MAXADDR, BUS_SPACE_MAXADDR, NULL, NULL, size, 1, size,
+	    0, NULL, NULL, &buf->tag);
+	if (error != 0)
+		return (error);
+	error = bus_dmamem_alloc(buf->tag, &buf->va,
+	    BUS_DMA_WAITOK | BUS_DMA_COHERENT, &buf->map);
+	if (error != 0)
+		goto fail;
+	error = bus_dmamap_load(buf->tag, buf->map, buf->va, size,
+	    lpss_idma_buf_cb, buf, BUS_DMA_NOWAIT);
+	if (error != 0)
+		goto fail;
+	return (0);
+fail:
+	lpss_idma_buf_free(buf);
+	return (error);
+}
+
+void
+lpss_idma_buf_free(struct lpss_idma_buf *buf)
+{
+	if (buf->pa != 0)
+		bus_dmamap_unload(buf->tag, buf->map);
+	if (buf->va != NULL)
+		bus_dmamem_free(buf->tag, buf->va, buf->map);
+	if (buf->tag != NULL)
+		bus_dma_tag_destroy(buf->tag);
+	buf->pa = 0;
+	buf->va = NULL;
+	buf->tag = NULL;
+}
@@ -0,0 +1,78 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef _DEV_INTEL_LPSS_IDMA_H_
+#define _DEV_INTEL_LPSS_IDMA_H_
+
+/*
+ * Minimal driver for the iDMA64 engine found behind UART and SPI LPSS
+ * functions (LPSS_RID_IDMA window).  Each transfer is a single block
+ * between a bounce buffer and the function's data register, using the
+ * fixed hardware handshake of the channel direction.  See idma64.c in
+ * linux for the register layout.
+ */
+
+#define LPSS_IDMA_NCHAN		2
+
+/* Transfer directions */
+#define LPSS_IDMA_MEM_TO_DEV	0
+#define LPSS_IDMA_DEV_TO_MEM	1
+
+#define LPSS_IDMA_MAX_BLOCK	0x1ffff	/* items per block */
+
+struct lpss_idma {
+	device_t		dev;
+	struct resource		*res;
+	bus_size_t		len[LPSS_IDMA_NCHAN];
+	int			width[LPSS_IDMA_NCHAN];	/* log2 bytes */
+};
+
+/* Physically contiguous bounce buffer. */
+struct lpss_idma_buf {
+	bus_dma_tag_t		tag;
+	bus_dmamap_t		map;
+	void			*va;
+	bus_addr_t		pa;
+	bus_size_t		size;
+};
+
+int	lpss_idma_init(struct lpss_idma *dma, device_t dev,
+	    struct resource *res);
+void	lpss_idma_fini(struct lpss_idma *dma);
+void	lpss_idma_start(struct lpss_idma *dma, int ch, int dir,
+	    bus_addr_t mem, bus_addr_t fifo, bus_size_t len, int width);
+void	lpss_idma_stop(struct lpss_idma *dma, int ch);
+bus_size_t lpss_idma_done(struct lpss_idma *dma, int ch);
+/* Acknowledge the interrupt; returns completed channels, *errp errors. */
+uint32_t lpss_idma_intr(struct lpss_idma *dma, uint32_t *errp);
+
+int	lpss_idma_buf_alloc(device_t dev, bus_size_t size,
+	    struct lpss_idma_buf *buf);
+void	lpss_idma_buf_free(struct lpss_idma_buf *buf);
+
+#endif /* _DEV_INTEL_LPSS_IDMA_H_ */
@@ -0,0 +1,140 @@
+#-
+# Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+# OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+# HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+# OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+# SUCH DAMAGE.
+#
+# $FreeBSD$
+#
+
+#include <sys/bus.h>
+
+/**
+ * @defgroup LPSS lpss - KObj methods for LPSS function drivers
+ * @brief Access to the LPSS private register block.
+ *
+ * The private block is shared by the lpss parent and its function driver
+ * child.  The parent owns it: it keeps a shadow copy of every register it
+ * programs, skips writes that would not change anything and reprograms
+ * the block from the shadows when the function lost its context.  The
+ * child never touches these registers itself.
+ * @{
+ */
+INTERFACE lpss;
+
+/**
+ * @brief Put the function (and its iDMA) through a reset cycle.
+ *
+ * @param _dev		the lpss device
+ * @param _child	the function driver
+ */
+METHOD void reset {
+	device_t	_dev;
+	device_t	_child;
+};
+
+/**
+ * @brief Check whether the function lost its context in device idle.
+ *
+ * If it did, the function is brought out of idle, reset and the private
+ * registers are reprogrammed from their shadows.  The child then has to
+ * restore its own registers.
+ *
+ * @retval 0		the function kept its context
+ * @retval 1		the context was lost and the function was reset
+ */
+METHOD int restore_required {
+	device_t	_dev;
+	device_t	_child;
+};
+
+/**
+ * @brief Enter (_idle != 0) or leave device idle.
+ */
+METHOD void set_idle {
+	device_t	_dev;
+	device_t	_child;
+	int		_idle;
+};
+
+/**
+ * @brief Set the latency tolerance in microseconds, or LPSS_LTR_NONE.
+ *
+ * Ignored while the parent's ltr_override_us sysctl is set.
+ */
+METHOD void set_ltr {
+	device_t	_dev;
+	device_t	_child;
+	int		_us;
+};
+
+/**
+ * @brief Program the address the iDMA engine uses to reach the function.
+ */
+METHOD void remap {
+	device_t	_dev;
+	device_t	_child;
+	uint64_t	_addr;
+};
+
+/**
+ * @brief Drive the chip select line of an SPI child.
+ *
+ * The line is put under software control on first use.
+ *
+ * @param _cs		chip select number
+ * @param _high		line level, 1 is high (deasserted for the usual
+ *			active-low chip select)
+ */
+METHOD void set_cs {
+	device_t	_dev;
+	device_t	_child;
+	int		_cs;
+	int		_high;
+};
+
+/**
+ * @brief Set the function clock of a UART or SPI child.
+ *
+ * The fractional M/N divider with the lowest error is used.
+ *
+ * @param _rate		requested rate in Hz
+ * @param _actual	if not NULL, the resulting rate in Hz
+ *
+ * @retval ENODEV	the function has no divider
+ */
+METHOD int set_clock_rate {
+	device_t	_dev;
+	device_t	_child;
+	uint64_t	_rate;
+	uint64_t	*_actual;
+};
+
+/**
+ * @brief Return the current function clock in Hz, 0 if gated.
+ */
+METHOD uint64_t get_clock_rate {
+	device_t	_dev;
+	device_t	_child;
+};
+
+/** @} */
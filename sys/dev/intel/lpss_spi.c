@@ -0,0 +1,596 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+/*
+ * SPI host controller driver for the SSP block of an LPSS SPI function
+ * (PXA2xx compatible, Sunrise Point flavour).
+ *
+ * Transfers are driven from the FIFO interrupt, keeping no more bytes in
+ * flight than the receive FIFO can hold.  Transfers of at least dma_min
+ * bytes go through the function's iDMA64 engine instead, using bounce
+ * buffers, so that large flash reads don't take an interrupt per FIFO
+ * fill.  The function clock is set from the lpss divider so that a
+ * device runs at its maximum SCLK with the smallest SSP divisor.
+ */
+
+#include <sys/param.h>
+#include <sys/bus.h>
+#include <sys/kernel.h>
+#include <sys/lock.h>
+#include <sys/module.h>
+#include <sys/mutex.h>
+#include <sys/rman.h>
+#include <sys/sysctl.h>
+#include <sys/systm.h>
+
+#include <machine/bus.h>
+#include <machine/resource.h>
+
+#include <dev/spibus/spi.h>
+#include <dev/spibus/spibusvar.h>
+
+#include <dev/intel/lpss_var.h>
+#include <dev/intel/lpss_idma.h>
+
+#include "lpss_if.h"
+#include "spibus_if.h"
+
+#define BIT(nr) (1UL << (nr))
+
+/* SSP registers */
+#define SSCR0			0x00
+#define SSCR0_DSS(bits)		(((bits) - 1) & 0xf)
+#define SSCR0_FRF_MOTOROLA	(0 << 4)
+#define SSCR0_SSE		BIT(7)
+#define SSCR0_SCR(x)		(((x) & 0xfff) << 8)
+#define SSCR0_SCR_MAX		0xfff
+#define SSCR0_RIM		BIT(22)	/* mask RX FIFO overrun */
+#define SSCR0_TIM		BIT(23)	/* mask TX FIFO underrun */
+#define SSCR1			0x04
+#define SSCR1_RIE		BIT(0)
+#define SSCR1_TIE		BIT(1)
+#define SSCR1_SPO		BIT(3)
+#define SSCR1_SPH		BIT(4)
+#define SSCR1_TFT(x)		((((x) - 1) & 0xf) << 6)
+#define SSCR1_RFT(x)		((((x) - 1) & 0xf) << 10)
+#define SSCR1_TINTE		BIT(19)
+#define SSCR1_RSRE		BIT(20)
+#define SSCR1_TSRE		BIT(21)
+#define SSSR			0x08
+#define SSSR_TNF		BIT(2)
+#define SSSR_RNE		BIT(3)
+#define SSSR_BSY		BIT(4)
+#define SSSR_ROR		BIT(7)
+#define SSSR_TINT		BIT(19)
+#define SSSR_TUR		BIT(21)
+#define SSSR_W1C		(SSSR_ROR | SSSR_TINT | SSSR_TUR)
+#define SSDR			0x10
+#define SSTO			0x28
+#define SSPSP			0x2c
+#define SSITF			0x44
+#define SSITF_TXLO(x)		(((x) - 1) << 8)
+#define SSITF_TXHI(x)		((x) - 1)
+#define SSIRF			0x48
+#define SSIRF_RX(x)		((x) - 1)
+
+#define LPSS_SPI_FIFO		64	/* entries in each direction */
+#define LPSS_SPI_RX_THRESH	32
+#define LPSS_SPI_TX_LO		32
+#define LPSS_SPI_TX_HI		56
+#define LPSS_SPI_TIMEOUT	1000	/* RX idle timeout, SSP clocks */
+#define LPSS_SPI_NUM_CS		2
+#define LPSS_SPI_DEF_CLOCK	1000000
+#define LPSS_SPI_DMA_MIN	256	/* default dma_min */
+#define LPSS_SPI_DMA_BUFSZ	(64 * 1024)
+#define LPSS_SPI_DMA_TX		0	/* iDMA channels */
+#define LPSS_SPI_DMA_RX		1
+
+#define RD4(sc, reg)		bus_read_4((sc)->mem_res, (reg))
+#define WR4(sc, reg, val)	bus_write_4((sc)->mem_res, (reg), (val))
+
+struct lpss_spi_softc {
+	device_t		dev;
+	device_t		spibus;
+	struct resource		*mem_res;
+	int			mem_rid;
+	struct resource		*idma_res;
+	int			idma_rid;
+	struct resource		*irq_res;
+	int			irq_rid;
+	void			*intr_handle;
+	struct mtx		mtx;
+	int			busy;
+
+	/* Clock */
+	uint32_t		clk_req;	/* SCLK last asked for */
+	uint32_t		clk_scr;	/* SSP divisor for it */
+	uint64_t		clk_func;	/* function clock */
+
+	/* Current segment */
+	const uint8_t		*tx_buf;	/* NULL: send zeroes */
+	uint8_t			*rx_buf;	/* NULL: discard */
+	uint32_t		len;
+	uint32_t		tx_pos;
+	uint32_t		rx_pos;
+	int			dma;		/* segment uses iDMA */
+	int			done;
+	int			error;
+
+	/* iDMA */
+	struct lpss_idma	idma;
+	struct lpss_idma_buf	dma_tx;
+	struct lpss_idma_buf	dma_rx;
+	int			dma_ok;
+	int			dma_min;
+
+	/* Statistics */
+	uint64_t		xfers;
+	uint64_t		dma_xfers;
+	uint64_t		intrs;
+};
+
+static int lpss_spi_detach(device_t dev);
+
+/*
+ * Pick the function clock and SSP divisor for the fastest SCLK not above
+ * hz.  The divider is asked for hz itself; the SSP divisor only covers
+ * what the divider cannot reach.
+ */
+static void
+lpss_spi_set_clock(struct lpss_spi_softc *sc, uint32_t hz)
+{
+	uint64_t func;
+	uint32_t scr;
+
+	if (hz == sc->clk_req)
+		return;
+	if (LPSS_SET_CLOCK_RATE(device_get_parent(sc->dev), sc->dev, hz,
+	    &func) != 0 || func == 0)
+		func = lpss_get_input_clock(sc->dev);
+	scr = howmany(func, hz);
+	scr = scr > 0 ? scr - 1 : 0;
+	if (scr > SSCR0_SCR_MAX)
+		scr = SSCR0_SCR_MAX;
+	sc->clk_req = hz;
+	sc->clk_scr = scr;
+	sc->clk_func = func;
+}
+
+static void
+lpss_spi_cs(struct lpss_spi_softc *sc, int cs, bool active, bool cs_high)
+{
+	LPSS_SET_CS(device_get_parent(sc->dev), sc->dev, cs,
+	    active == cs_high);
+}
+
+/* Move data between the FIFOs and the segment buffers. */
+static void
+lpss_spi_pio(struct lpss_spi_softc *sc)
+{
+	uint32_t v;
+
+	while (sc->rx_pos < sc->tx_pos && (RD4(sc, SSSR) & SSSR_RNE)) {
+		v = RD4(sc, SSDR);
+		if (sc->rx_buf != NULL)
+			sc->rx_buf[sc->rx_pos] = v;
+		sc->rx_pos++;
+	}
+	while (sc->tx_pos < sc->len &&
+	    sc->tx_pos - sc->rx_pos < LPSS_SPI_FIFO &&
+	    (RD4(sc, SSSR) & SSSR_TNF)) {
+		WR4(sc, SSDR, sc->tx_buf != NULL ? sc->tx_buf[sc->tx_pos] : 0);
+		sc->tx_pos++;
+	}
+}
+
+static void
+lpss_spi_finish(struct lpss_spi_softc *sc, int error)
+{
+	mtx_assert(&sc->mtx, MA_OWNED);
+	WR4(sc, SSCR1, RD4(sc, SSCR1) &
+	    ~(SSCR1_RIE | SSCR1_TIE | SSCR1_TINTE | SSCR1_RSRE | SSCR1_TSRE));
+	if (sc->error == 0)
+		sc->error = error;
+	sc->done = 1;
+	wakeup(sc);
+}
+
+static void
+lpss_spi_intr(void *arg)
+{
+	struct lpss_spi_softc *sc = arg;
+	uint32_t sssr, tfr, err;
+
+	mtx_lock(&sc->mtx);
+	sc->intrs++;
+	if (sc->dma_ok) {
+		tfr = lpss_idma_intr(&sc->idma, &err);
+		if (sc->dma && !sc->done) {
+			if (err != 0)
+				lpss_spi_finish(sc, EIO);
+			else if (tfr & (1 << LPSS_SPI_DMA_RX)) {
+				sc->rx_pos = sc->tx_pos = sc->len;
+				lpss_spi_finish(sc, 0);
+			}
+		}
+	}
+
+	sssr = RD4(sc, SSSR);
+	if (sssr & SSSR_W1C)
+		WR4(sc, SSSR, sssr & SSSR_W1C);
+	if (sc->done || sc->len == 0 || sc->dma) {
+		mtx_unlock(&sc->mtx);
+		return;
+	}
+	if (sssr & SSSR_ROR) {
+		lpss_spi_finish(sc, EIO);
+		mtx_unlock(&sc->mtx);
+		return;
+	}
+	lpss_spi_pio(sc);
+	if (sc->rx_pos == sc->len)
+		lpss_spi_finish(sc, 0);
+	mtx_unlock(&sc->mtx);
+}
+
+static int
+lpss_spi_segment(struct lpss_spi_softc *sc, const void *tx, void *rx,
+    uint32_t len, uint32_t mode)
+{
+	uint32_t sscr1, chunk;
+	int error, timo;
+
+	mtx_assert(&sc->mtx, MA_OWNED);
+	error = 0;
+	while (len > 0 && error == 0) {
+		sc->dma = sc->dma_ok && len >= (uint32_t)sc->dma_min;
+		chunk = sc->dma ? MIN(len, LPSS_SPI_DMA_BUFSZ) : len;
+		sc->tx_buf = tx;
+		sc->rx_buf = rx;
+		sc->len = chunk;
+		sc->tx_pos = sc->rx_pos = 0;
+		sc->done = 0;
+		sc->error = 0;
+
+		sscr1 = SSCR1_RFT(LPSS_SPI_RX_THRESH) |
+		    SSCR1_TFT(LPSS_SPI_TX_LO);
+		if (mode & SPIBUS_MODE_CPOL)
+			sscr1 |= SSCR1_SPO;
+		if (mode & SPIBUS_MODE_CPHA)
+			sscr1 |= SSCR1_SPH;
+
+		WR4(sc, SSCR0, 0);
+		WR4(sc, SSIRF, SSIRF_RX(sc->dma ? 1 : LPSS_SPI_RX_THRESH));
+		WR4(sc, SSITF, SSITF_TXLO(LPSS_SPI_TX_LO) |
+		    SSITF_TXHI(LPSS_SPI_TX_HI));
+		WR4(sc, SSTO, LPSS_SPI_TIMEOUT);
+		WR4(sc, SSSR, SSSR_W1C);
+		WR4(sc, SSCR1, sscr1);
+		WR4(sc, SSCR0, SSCR0_DSS(8) | SSCR0_FRF_MOTOROLA |
+		    SSCR0_SCR(sc->clk_scr) | SSCR0_TIM | SSCR0_SSE);
+
+		if (sc->dma) {
+			if (tx != NULL)
+				memcpy(sc->dma_tx.va, tx, chunk);
+			else
+				memset(sc->dma_tx.va, 0, chunk);
+			bus_dmamap_sync(sc->dma_tx.tag, sc->dma_tx.map,
+			    BUS_DMASYNC_PREWRITE);
+			bus_dmamap_sync(sc->dma_rx.tag, sc->dma_rx.map,
+			    BUS_DMASYNC_PREREAD);
+			/* Receive first, so no byte is missed. */
+			lpss_idma_start(&sc->idma, LPSS_SPI_DMA_RX,
+			    LPSS_IDMA_DEV_TO_MEM, sc->dma_rx.pa,
+			    rman_get_start(sc->mem_res) + SSDR, chunk, 0);
+			lpss_idma_start(&sc->idma, LPSS_SPI_DMA_TX,
+			    LPSS_IDMA_MEM_TO_DEV, sc->dma_tx.pa,
+			    rman_get_start(sc->mem_res) + SSDR, chunk, 0);
+			WR4(sc, SSCR1, sscr1 | SSCR1_RSRE | SSCR1_TSRE);
+		} else {
+			lpss_spi_pio(sc);
+			WR4(sc, SSCR1, sscr1 | SSCR1_RIE | SSCR1_TINTE);
+		}
+
+		/* A second on top of the time on the wire. */
+		timo = hz + (uint64_t)chunk * 8 * (sc->clk_scr + 1) * hz /
+		    MAX(sc->clk_func, 1);
+		while (!sc->done && error == 0)
+			error = mtx_sleep(sc, &sc->mtx, 0, "lpssspi", timo);
+		if (error == EWOULDBLOCK) {
+			device_printf(sc->dev, "transfer timed out\n");
+			lpss_spi_finish(sc, ETIMEDOUT);
+		}
+		if (sc->dma) {
+			lpss_idma_stop(&sc->idma, LPSS_SPI_DMA_TX);
+			lpss_idma_stop(&sc->idma, LPSS_SPI_DMA_RX);
+			bus_dmamap_sync(sc->dma_tx.tag, sc->dma_tx.map,
+			    BUS_DMASYNC_POSTWRITE);
+			bus_dmamap_sync(sc->dma_rx.tag, sc->dma_rx.map,
+			    BUS_DMASYNC_POSTREAD);
+			if (sc->error == 0 && rx != NULL)
+				memcpy(rx, sc->dma_rx.va, chunk);
+			sc->dma_xfers++;
+		}
+		WR4(sc, SSCR0, 0);
+		error = sc->error;
+		sc->len = 0;
+
+		len -= chunk;
+		if (tx != NULL)
+			tx = (const uint8_t *)tx + chunk;
+		if (rx != NULL)
+			rx = (uint8_t *)rx + chunk;
+	}
+	return (error);
+}
+
+static int
+lpss_spi_transfer(device_t dev, device_t child, struct spi_command *cmd)
+{
+	struct lpss_spi_softc *sc;
+	uint32_t cs, clock, mode;
+	bool cs_high;
+	int error;
+
+	sc = device_get_softc(dev);
+	if (cmd->tx_cmd_sz != cmd->rx_cmd_sz ||
+	    cmd->tx_data_sz != cmd->rx_data_sz)
+		return (EINVAL);
+
+	spibus_get_cs(child, &cs);
+	spibus_get_clock(child, &clock);
+	spibus_get_mode(child, &mode);
+#ifdef SPIBUS_CS_HIGH
+	cs_high = (cs & SPIBUS_CS_HIGH) != 0;
+	cs &= ~SPIBUS_CS_HIGH;
+#else
+	cs_high = false;
+#endif
+	if (cs >= LPSS_SPI_NUM_CS)
+		return (EINVAL);
+	if (clock == 0)
+		clock = LPSS_SPI_DEF_CLOCK;
+
+	mtx_lock(&sc->mtx);
+	while (sc->busy)
+		mtx_sleep(&sc->busy, &sc->mtx, 0, "lpssspi", 0);
+	sc->busy = 1;
+
+	lpss_spi_set_clock(sc, clock);
+	lpss_spi_cs(sc, cs, true, cs_high);
+	error = lpss_spi_segment(sc, cmd->tx_cmd, cmd->rx_cmd, cmd->tx_cmd_sz,
+	    mode);
+	if (error == 0)
+		error = lpss_spi_segment(sc, cmd->tx_data, cmd->rx_data,
+		    cmd->tx_data_sz, mode);
+#ifdef SPI_FLAG_KEEP_CS
+	if (error != 0 || (cmd->flags & SPI_FLAG_KEEP_CS) == 0)
+#endif
+		lpss_spi_cs(sc, cs, false, cs_high);
+	sc->xfers++;
+
+	sc->busy = 0;
+	wakeup_one(&sc->busy);
+	mtx_unlock(&sc->mtx);
+	return (error);
+}
+
+static int
+lpss_spi_probe(device_t dev)
+{
+	if (lpss_get_type(dev) != LPSS_TYPE_SPI)
+		return (ENXIO);
+	device_set_desc(dev, "Intel LPSS SPI Controller");
+	return (BUS_PROBE_DEFAULT);
+}
+
+static void
+lpss_spi_dma_init(struct lpss_spi_softc *sc)
+{
+	sc->idma_rid = LPSS_RID_IDMA;
+	sc->idma_res = bus_alloc_resource_any(sc->dev, SYS_RES_MEMORY,
+	    &sc->idma_rid, RF_ACTIVE);
+	if (sc->idma_res == NULL)
+		return;
+	if (lpss_idma_buf_alloc(sc->dev, LPSS_SPI_DMA_BUFSZ, &sc->dma_tx) ||
+	    lpss_idma_buf_alloc(sc->dev, LPSS_SPI_DMA_BUFSZ, &sc->dma_rx)) {
+		device_printf(sc->dev, "no DMA buffers, using PIO only\n");
+		return;
+	}
+	lpss_idma_init(&sc->idma, sc->dev, sc->idma_res);
+	sc->dma_ok = 1;
+}
+
+static int
+lpss_spi_attach(device_t dev)
+{
+	struct lpss_spi_softc *sc;
+	struct sysctl_ctx_list *ctx;
+	struct sysctl_oid_list *children;
+	int error;
+
+	sc = device_get_softc(dev);
+	sc->dev = dev;
+	mtx_init(&sc->mtx, device_get_nameunit(dev), "lpss_spi", MTX_DEF);
+
+	sc->mem_rid = LPSS_RID_DEV;
+	sc->mem_res = bus_alloc_resource_any(dev, SYS_RES_MEMORY,
+	    &sc->mem_rid, RF_ACTIVE);
+	if (sc->mem_res == NULL) {
+		device_printf(dev, "Unable to map registers\n");
+		error = ENXIO;
+		goto fail;
+	}
+	sc->irq_rid = 0;
+	sc->irq_res = bus_alloc_resource_any(dev, SYS_RES_IRQ,
+	    &sc->irq_rid, RF_SHAREABLE | RF_ACTIVE);
+	if (sc->irq_res == NULL) {
+		device_printf(dev, "Unable to map interrupt\n");
+		error = ENXIO;
+		goto fail;
+	}
+
+	WR4(sc, SSCR0, 0);
+	WR4(sc, SSCR1, 0);
+	sc->dma_min = LPSS_SPI_DMA_MIN;
+	resource_int_value(device_get_name(dev), device_get_unit(dev),
+	    "dma_min", &sc->dma_min);
+	lpss_spi_dma_init(sc);
+
+	error = bus_setup_intr(dev, sc->irq_res, INTR_TYPE_MISC | INTR_MPSAFE,
+	    NULL, lpss_spi_intr, sc, &sc->intr_handle);
+	if (error != 0) {
+		device_printf(dev, "Unable to setup irq: error %d\n", error);
+		goto fail;
+	}
+
+	ctx = device_get_sysctl_ctx(dev);
+	children = SYSCTL_CHILDREN(device_get_sysctl_tree(dev));
+	SYSCTL_ADD_INT(ctx, children, OID_AUTO, "dma_min", CTLFLAG_RW,
+	    &sc->dma_min, 0, "Smallest transfer in bytes done with iDMA");
+	SYSCTL_ADD_U32(ctx, children, OID_AUTO, "sclk_div", CTLFLAG_RD,
+	    &sc->clk_scr, 0, "SSP clock divisor minus one");
+	SYSCTL_ADD_U64(ctx, children, OID_AUTO, "func_clock", CTLFLAG_RD,
+	    &sc->clk_func, 0, "Function clock in Hz");
+	SYSCTL_ADD_U64(ctx, children, OID_AUTO, "xfers", CTLFLAG_RD,
+	    &sc->xfers, 0, "Transfers");
+	SYSCTL_ADD_U64(ctx, children, OID_AUTO, "dma_xfers", CTLFLAG_RD,
+	    &sc->dma_xfers, 0, "Transfer chunks done with iDMA");
+	SYSCTL_ADD_U64(ctx, children, OID_AUTO, "intrs", CTLFLAG_RD,
+	    &sc->intrs, 0, "Interrupts");
+
+	sc->spibus = device_add_child(dev, "spibus", -1);
+	return (bus_generic_attach(dev));
+
+fail:
+	lpss_spi_detach(dev);
+	return (error);
+}
+
+static int
+lpss_spi_detach(device_t dev)
+{
+	struct lpss_spi_softc *sc;
+	int error;
+
+	sc = device_get_softc(dev);
+	error = bus_generic_detach(dev);
+	if (error != 0)
+		return (error);
+	device_delete_children(dev);
+
+	if (sc->intr_handle != NULL) {
+		bus_teardown_intr(dev, sc->irq_res, sc->intr_handle);
+		sc->intr_handle = NULL;
+	}
+	if (sc->dma_ok) {
+		lpss_idma_fini(&sc->idma);
+		sc->dma_ok = 0;
+	}
+	lpss_idma_buf_free(&sc->dma_tx);
+	lpss_idma_buf_free(&sc->dma_rx);
+	if (sc->mem_res != NULL)
+		WR4(sc, SSCR0, 0);
+	if (sc->irq_res != NULL)
+		bus_release_resource(dev, SYS_RES_IRQ, sc->irq_rid,
+		    sc->irq_res);
+	if (sc->idma_res != NULL)
+		bus_release_resource(dev, SYS_RES_MEMORY, sc->idma_rid,
+		    sc->idma_res);
+	if (sc->mem_res != NULL)
+		bus_release_resource(dev, SYS_RES_MEMORY, sc->mem_rid,
+		    sc->mem_res);
+	sc->irq_res = sc->idma_res = sc->mem_res = NULL;
+	mtx_destroy(&sc->mtx);
+	return (0);
+}
+
+static int
+lpss_spi_suspend(device_t dev)
+{
+	struct lpss_spi_softc *sc;
+	int error;
+
+	sc = device_get_softc(dev);
+	error = bus_generic_suspend(dev);
+	if (error != 0)
+		return (error);
+	mtx_lock(&sc->mtx);
+	while (sc->busy)
+		mtx_sleep(&sc->busy, &sc->mtx, 0, "lpssspi", 0);
+	sc->busy = 1;
+	mtx_unlock(&sc->mtx);
+	return (0);
+}
+
+static int
+lpss_spi_resume(device_t dev)
+{
+	struct lpss_spi_softc *sc;
+
+	sc = device_get_softc(dev);
+	mtx_lock(&sc->mtx);
+	WR4(sc, SSCR0, 0);
+	WR4(sc, SSCR1, 0);
+	if (sc->dma_ok)
+		lpss_idma_init(&sc->idma, sc->dev, sc->idma_res);
+	/* The clock divider is restored by the parent. */
+	sc->busy = 0;
+	wakeup_one(&sc->busy);
+	mtx_unlock(&sc->mtx);
+	return (bus_generic_resume(dev));
+}
+
+static device_method_t lpss_spi_methods[] = {
+	/* Device interface */
+	DEVMETHOD(device_probe,		lpss_spi_probe),
+	DEVMETHOD(device_attach,	lpss_spi_attach),
+	DEVMETHOD(device_detach,	lpss_spi_detach),
+	DEVMETHOD(device_suspend,	lpss_spi_suspend),
+	DEVMETHOD(device_resume,	lpss_spi_resume),
+
+	/* SPI interface */
+	DEVMETHOD(spibus_transfer,	lpss_spi_transfer),
+
+	DEVMETHOD_END
+};
+
+static driver_t lpss_spi_driver = {
+	"lpss_spi",
+	lpss_spi_methods,
+	sizeof(struct lpss_spi_softc)
+};
+
+static devclass_t lpss_spi_devclass;
+
+DRIVER_MODULE(lpss_spi, lpss, lpss_spi_driver, lpss_spi_devclass, 0, 0);
+DRIVER_MODULE(spibus, lpss_spi, spibus_driver, spibus_devclass, 0, 0);
+MODULE_DEPEND(lpss_spi, lpss, 1, 1, 1);
+MODULE_DEPEND(lpss_spi, spibus, 1, 1, 1);
+MODULE_VERSION(lpss_spi, 1);
@@ -0,0 +1,345 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+/*
+ * uart(4) attachment for LPSS UART functions, a DesignWare 8250 with
+ * 32-bit registers (reg-shift and reg-io-width from the lpss platform
+ * properties).
+ *
+ * The ns8250 class is extended in two ways:
+ *
+ * - The baud clock comes from the lpss fractional divider.  Every baud
+ *   rate is run with rclk = 16 * baud, so non-standard and multi-Mbaud
+ *   rates are exact up to a sixteenth of the input clock.
+ *
+ * - Receive uses the iDMA64 engine when the function has one.  Data
+ *   lands in a bounce buffer without per-byte register reads.  IER_ERXRDY
+ *   stays enabled as ns8250_bus_attach() leaves it, since it also gates
+ *   the receiver timeout, so the buffer is handed to the uart core on
+ *   every receive interrupt (FIFO trigger level or timeout) as well as
+ *   when the block fills.  Whatever is left in the FIFO is picked up by
+ *   the regular PIO path.
+ */
+
+#include <sys/param.h>
+#include <sys/bus.h>
+#include <sys/kernel.h>
+#include <sys/lock.h>
+#include <sys/module.h>
+#include <sys/mutex.h>
+#include <sys/rman.h>
+#include <sys/sysctl.h>
+#include <sys/systm.h>
+
+#include <machine/bus.h>
+#include <machine/resource.h>
+
+#include <dev/ic/ns16550.h>
+#include <dev/uart/uart.h>
+#include <dev/uart/uart_cpu.h>
+#include <dev/uart/uart_bus.h>
+#include <dev/uart/uart_dev_ns8250.h>
+
+#include <dev/intel/lpss_var.h>
+#include <dev/intel/lpss_idma.h>
+
+#include "lpss_if.h"
+#include "uart_if.h"
+
+#define LPSS_UART_DEF_BAUD	115200
+#define LPSS_UART_DMA_BUFSZ	4096
+#define LPSS_UART_DMA_RX	1	/* iDMA channel */
+
+struct lpss_uart_softc {
+	struct ns8250_softc	ns8250;
+
+	int			dma_enable;	/* hint.uart.N.rx_dma */
+	int			dma_on;
+	struct resource		*dma_res;
+	int			dma_rid;
+	struct lpss_idma	idma;
+	struct lpss_idma_buf	dma_buf;
+	uint64_t		dma_blocks;	/* harvested DMA blocks */
+	uint64_t		dma_bytes;
+	uint64_t		dma_overruns;
+	uint64_t		baud_clock;	/* rclk set for the baud rate */
+};
+
+static void
+lpss_uart_dma_start(struct lpss_uart_softc *lsc)
+{
+	struct uart_softc *sc = &lsc->ns8250.base;
+
+	bus_dmamap_sync(lsc->dma_buf.tag, lsc->dma_buf.map,
+	    BUS_DMASYNC_PREREAD);
+	lpss_idma_start(&lsc->idma, LPSS_UART_DMA_RX, LPSS_IDMA_DEV_TO_MEM,
+	    lsc->dma_buf.pa, rman_get_start(sc->sc_rres) +
+	    (REG_DATA << sc->sc_bas.regshft), LPSS_UART_DMA_BUFSZ, 0);
+}
+
+static void
+lpss_uart_dma_setup(struct lpss_uart_softc *lsc)
+{
+	struct uart_softc *sc = &lsc->ns8250.base;
+	struct sysctl_ctx_list *ctx;
+	struct sysctl_oid_list *children;
+
+	if (lsc->dma_res == NULL) {
+		lsc->dma_enable = 1;
+		resource_int_value(device_get_name(sc->sc_dev),
+		    device_get_unit(sc->sc_dev), "rx_dma", &lsc->dma_enable);
+		if (!lsc->dma_enable)
+			return;
+		lsc->dma_rid = LPSS_RID_IDMA;
+		lsc->dma_res = bus_alloc_resource_any(sc->sc_dev,
+		    SYS_RES_MEMORY, &lsc->dma_rid, RF_ACTIVE);
+		if (lsc->dma_res == NULL)
+			return;
+		if (lpss_idma_buf_alloc(sc->sc_dev, LPSS_UART_DMA_BUFSZ,
+		    &lsc->dma_buf) != 0) {
+			bus_release_resource(sc->sc_dev, SYS_RES_MEMORY,
+			    lsc->dma_rid, lsc->dma_res);
+			lsc->dma_res = NULL;
+			return;
+		}
+
+		ctx = device_get_sysctl_ctx(sc->sc_dev);
+		children = SYSCTL_CHILDREN(device_get_sysctl_tree(sc->sc_dev));
+		SYSCTL_ADD_U64(ctx, children, OID_AUTO, "rx_dma_blocks",
+		    CTLFLAG_RD, &lsc->dma_blocks, 0,
+		    "Receive DMA blocks handed to the uart core");
+		SYSCTL_ADD_U64(ctx, children, OID_AUTO, "rx_dma_bytes",
+		    CTLFLAG_RD, &lsc->dma_bytes, 0, "Bytes received by DMA");
+		SYSCTL_ADD_U64(ctx, children, OID_AUTO, "rx_dma_overruns",
+		    CTLFLAG_RD, &lsc->dma_overruns, 0,
+		    "Receive buffer overruns while harvesting DMA data");
+		SYSCTL_ADD_U64(ctx, children, OID_AUTO, "baud_clock",
+		    CTLFLAG_RD, &lsc->baud_clock, 0, "Baud clock in Hz");
+	}
+
+	/*
+	 * RX DMA requests at the FIFO trigger level or on timeout, the
+	 * same points at which IER_ERXRDY interrupts.
+	 */
+	uart_lock(sc->sc_hwmtx);
+	lsc->ns8250.fcr |= FCR_DMA_MODE;
+	uart_setreg(&sc->sc_bas, REG_FCR, lsc->ns8250.fcr);
+	uart_barrier(&sc->sc_bas);
+	lpss_idma_init(&lsc->idma, sc->sc_dev, lsc->dma_res);
+	lpss_uart_dma_start(lsc);
+	lsc->dma_on = 1;
+	uart_unlock(sc->sc_hwmtx);
+}
+
+/* Also called on resume, through uart_bus_resume(). */
+static int
+lpss_uart_bus_attach(struct uart_softc *sc)
+{
+	struct lpss_uart_softc *lsc = (struct lpss_uart_softc *)sc;
+	int error;
+
+	error = ns8250_bus_attach(sc);
+	if (error != 0)
+		return (error);
+	lpss_uart_dma_setup(lsc);
+	return (0);
+}
+
+static int
+lpss_uart_bus_detach(struct uart_softc *sc)
+{
+	struct lpss_uart_softc *lsc = (struct lpss_uart_softc *)sc;
+
+	if (lsc->dma_on) {
+		uart_lock(sc->sc_hwmtx);
+		lpss_idma_fini(&lsc->idma);
+		lsc->dma_on = 0;
+		uart_unlock(sc->sc_hwmtx);
+	}
+	lpss_idma_buf_free(&lsc->dma_buf);
+	if (lsc->dma_res != NULL) {
+		bus_release_resource(sc->sc_dev, SYS_RES_MEMORY, lsc->dma_rid,
+		    lsc->dma_res);
+		lsc->dma_res = NULL;
+	}
+	return (ns8250_bus_detach(sc));
+}
+
+static int
+lpss_uart_bus_ipend(struct uart_softc *sc)
+{
+	struct lpss_uart_softc *lsc = (struct lpss_uart_softc *)sc;
+	uint32_t done, err;
+	int ipend;
+
+	ipend = 0;
+	if (lsc->dma_on) {
+		uart_lock(sc->sc_hwmtx);
+		done = lpss_idma_intr(&lsc->idma, &err);
+		uart_unlock(sc->sc_hwmtx);
+		if ((done | err) & (1 << LPSS_UART_DMA_RX))
+			ipend |= SER_INT_RXREADY;
+	}
+	return (ipend | ns8250_bus_ipend(sc));
+}
+
+static int
+lpss_uart_bus_receive(struct uart_softc *sc)
+{
+	struct lpss_uart_softc *lsc = (struct lpss_uart_softc *)sc;
+	bus_size_t i, n;
+	uint8_t *p;
+	int error;
+
+	if (lsc->dma_on) {
+		uart_lock(sc->sc_hwmtx);
+		lpss_idma_stop(&lsc->idma, LPSS_UART_DMA_RX);
+		n = lpss_idma_done(&lsc->idma, LPSS_UART_DMA_RX);
+		bus_dmamap_sync(lsc->dma_buf.tag, lsc->dma_buf.map,
+		    BUS_DMASYNC_POSTREAD);
+		p = lsc->dma_buf.va;
+		for (i = 0; i < n; i++) {
+			if (uart_rx_full(sc)) {
+				sc->sc_rxbuf[sc->sc_rxput] = UART_STAT_OVERRUN;
+				lsc->dma_overruns++;
+				break;
+			}
+			uart_rx_put(sc, p[i]);
+		}
+		if (n > 0)
+			lsc->dma_blocks++;
+		lsc->dma_bytes += n;
+		uart_unlock(sc->sc_hwmtx);
+	}
+
+	/* Whatever stayed below the DMA request level. */
+	error = ns8250_bus_receive(sc);
+
+	if (lsc->dma_on) {
+		uart_lock(sc->sc_hwmtx);
+		lpss_uart_dma_start(lsc);
+		uart_unlock(sc->sc_hwmtx);
+	}
+	return (error);
+}
+
+/*
+ * Run the divider at 16 times the baud rate, so that the 8250 divisor is
+ * always 1 and the rate is as exact as the fractional divider allows.
+ */
+static int
+lpss_uart_bus_param(struct uart_softc *sc, int baudrate, int databits,
+    int stopbits, int parity)
+{
+	struct lpss_uart_softc *lsc = (struct lpss_uart_softc *)sc;
+	uint64_t rclk;
+
+	if (baudrate > 0 && LPSS_SET_CLOCK_RATE(device_get_parent(sc->sc_dev),
+	    sc->sc_dev, (uint64_t)baudrate * 16, &rclk) == 0 && rclk != 0) {
+		sc->sc_bas.rclk = rclk;
+		lsc->baud_clock = rclk;
+	}
+	return (ns8250_bus_param(sc, baudrate, databits, stopbits, parity));
+}
+
+static kobj_method_t lpss_uart_methods[] = {
+	KOBJMETHOD(uart_attach,		lpss_uart_bus_attach),
+	KOBJMETHOD(uart_detach,		lpss_uart_bus_detach),
+	KOBJMETHOD(uart_flush,		ns8250_bus_flush),
+	KOBJMETHOD(uart_getsig,		ns8250_bus_getsig),
+	KOBJMETHOD(uart_ioctl,		ns8250_bus_ioctl),
+	KOBJMETHOD(uart_ipend,		lpss_uart_bus_ipend),
+	KOBJMETHOD(uart_param,		lpss_uart_bus_param),
+	KOBJMETHOD(uart_probe,		ns8250_bus_probe),
+	KOBJMETHOD(uart_receive,	lpss_uart_bus_receive),
+	KOBJMETHOD(uart_setsig,		ns8250_bus_setsig),
+	KOBJMETHOD(uart_transmit,	ns8250_bus_transmit),
+	KOBJMETHOD(uart_grab,		ns8250_bus_grab),
+	KOBJMETHOD(uart_ungrab,		ns8250_bus_ungrab),
+	KOBJMETHOD_END
+};
+
+static struct uart_class lpss_uart_class = {
+	"lpss_uart",
+	lpss_uart_methods,
+	sizeof(struct lpss_uart_softc),
+	.uc_ops = &uart_ns8250_ops,
+	.uc_range = 8,
+	.uc_rclk = 0,
+	.uc_rshift = 2,
+	.uc_riowidth = 4,
+};
+
+static int
+lpss_uart_probe(device_t dev)
+{
+	struct uart_softc *sc;
+	uint64_t rclk;
+	uint32_t shift, width;
+
+	if (lpss_get_type(dev) != LPSS_TYPE_UART)
+		return (ENXIO);
+
+	shift = lpss_uart_class.uc_rshift;
+	width = lpss_uart_class.uc_riowidth;
+	lpss_get_property(dev, "reg-shift", &shift);
+	lpss_get_property(dev, "reg-io-width", &width);
+
+	/* Start out with the divider the firmware left, if any. */
+	rclk = LPSS_GET_CLOCK_RATE(device_get_parent(dev), dev);
+	if (rclk == 0 && LPSS_SET_CLOCK_RATE(device_get_parent(dev), dev,
+	    16 * LPSS_UART_DEF_BAUD, &rclk) != 0)
+		return (ENXIO);
+
+	sc = device_get_softc(dev);
+	sc->sc_class = &lpss_uart_class;
+	device_set_desc(dev, "Intel LPSS UART");
+	return (uart_bus_probe(dev, shift, width, rclk, LPSS_RID_DEV, 0,
+	    UART_F_BUSY_DETECT));
+}
+
+static device_method_t lpss_uart_bus_methods[] = {
+	/* Device interface */
+	DEVMETHOD(device_probe,		lpss_uart_probe),
+	DEVMETHOD(device_attach,	uart_bus_attach),
+	DEVMETHOD(device_detach,	uart_bus_detach),
+	DEVMETHOD(device_resume,	uart_bus_resume),
+	DEVMETHOD_END
+};
+
+static driver_t lpss_uart_driver = {
+	uart_driver_name,
+	lpss_uart_bus_methods,
+	sizeof(struct uart_softc),
+};
+
+DRIVER_MODULE(lpss_uart, lpss, lpss_uart_driver, uart_devclass, 0, 0);
+MODULE_DEPEND(lpss_uart, lpss, 1, 1, 1);
+MODULE_DEPEND(lpss_uart, uart, 1, 1, 1);
+MODULE_VERSION(lpss_uart, 1);
@@ -0,0 +1,81 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef _DEV_INTEL_LPSS_VAR_H_
+#define _DEV_INTEL_LPSS_VAR_H_
+
+/*
+ * Services the lpss parent provides to its function driver child.
+ */
+
+/* Function types, as found in the CAPS register. */
+#define LPSS_TYPE_I2C		0
+#define LPSS_TYPE_UART		1
+#define LPSS_TYPE_SPI		2
+
+/*
+ * SYS_RES_MEMORY rids of the function windows.  They are carved out of
+ * the BAR the parent has mapped already.
+ */
+#define LPSS_RID_DEV		0	/* function registers */
+#define LPSS_RID_PRIV		1	/* private register block */
+#define LPSS_RID_IDMA		2	/* iDMA64 controller */
+
+/* Platform property, e.g. "i2c-sda-hold-time-ns". */
+struct lpss_property {
+	const char	*name;
+	uint32_t	value;
+};
+
+enum lpss_ivars {
+	LPSS_IVAR_TYPE,		/* LPSS_TYPE_* */
+	LPSS_IVAR_INPUT_CLOCK,	/* input clock of the function in Hz */
+	LPSS_IVAR_PROPERTIES,	/* NULL name terminated, may be NULL */
+};
+
+#define LPSS_ACCESSOR(var, ivar, type)					\
+	__BUS_ACCESSOR(lpss, var, LPSS, ivar, type)
+
+LPSS_ACCESSOR(type,		TYPE,		int)
+LPSS_ACCESSOR(input_clock,	INPUT_CLOCK,	u_long)
+LPSS_ACCESSOR(properties,	PROPERTIES,	const struct lpss_property *)
+
+#undef LPSS_ACCESSOR
+
+/* Look up a platform property of child, returns ENOENT if absent. */
+int lpss_get_property(device_t child, const char *name, uint32_t *value);
+
+/* No latency tolerance requirement, see LPSS_SET_LTR(). */
+#define LPSS_LTR_NONE		(-1)
+
+/*
+ * The private register block (reset, device idle, LTR, iDMA remap and the
+ * clock divider) is only reached through the lpss_if.m methods.
+ */
+
+#endif /* _DEV_INTEL_LPSS_VAR_H_ */
@@ -0,0 +1,184 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * iic(4) backend: transfers go through the I2CRDWR ioctl on /dev/iicN,
+ * one descriptor per client, and the counters come from the ig4iic
+ * sysctls.
+ */
+
+#include <sys/param.h>
+
+#include "ig4bench.h"
+
+#ifdef __FreeBSD__
+
+#include <sys/ioctl.h>
+#include <sys/sysctl.h>
+
+#include <dev/iicbus/iic.h>
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static int	*dev_fds;
+static int	dev_nfds;
+static int	dev_unit;
+
+static int
+dev_open(const struct bench_opts *opts)
+{
+	int i;
+
+	dev_unit = opts->unit;
+	dev_nfds = opts->clients;
+	if ((dev_fds = calloc(dev_nfds, sizeof(*dev_fds))) == NULL)
+		return (ENOMEM);
+	for (i = 0; i < dev_nfds; i++) {
+		if ((dev_fds[i] = open(opts->dev, O_RDWR)) < 0) {
+			warn("%s", opts->dev);
+			return (errno);
+		}
+	}
+	return (0);
+}
+
+static int
+dev_xfer(int client, struct bench_msg *msgs, int nmsgs)
+{
+	struct iic_msg m[BENCH_MAXMSGS];
+	struct iic_rdwr_data rdwr;
+	int i;
+
+	if (nmsgs > (int)nitems(m))
+		return (EINVAL);
+	for (i = 0; i < nmsgs; i++) {
+		m[i].slave = msgs[i].addr << 1;
+		m[i].flags = (msgs[i].flags & BENCH_M_RD ? IIC_M_RD :
+		    IIC_M_WR) | (msgs[i].flags & BENCH_M_NOSTOP ?
+		    IIC_M_NOSTOP : 0) | (msgs[i].flags & BENCH_M_NOSTART ?
+		    IIC_M_NOSTART : 0);
+		m[i].len = msgs[i].len;
+		m[i].buf = msgs[i].buf;
+	}
+	rdwr.msgs = m;
+	rdwr.nmsgs = nmsgs;
+	if (ioctl(dev_fds[client], I2CRDWR, &rdwr) < 0)
+		return (errno);
+	return (0);
+}
+
+static uint64_t
+dev_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+static void
+dev_sleep_ns(uint64_t ns)
+{
+	struct timespec ts;
+
+	ts.tv_sec = ns / 1000000000;
+	ts.tv_nsec = ns % 1000000000;
+	nanosleep(&ts, NULL);
+}
+
+static int
+dev_sysctl(const char *name, uint64_t *val)
+{
+	char oid[64];
+	size_t len;
+
+	snprintf(oid, sizeof(oid), "dev.ig4iic.%d.%s", dev_unit, name);
+	len = sizeof(*val);
+	if (sysctlbyname(oid, val, &len, NULL, 0) < 0) {
+		warn("%s", oid);
+		return (errno);
+	}
+	return (0);
+}
+
+static int
+dev_counters(struct bench_counters *c)
+{
+	int error;
+
+	if ((error = dev_sysctl("intr_count", &c->intrs)) != 0 ||
+	    (error = dev_sysctl("xfer_mmio", &c->mmio)) != 0 ||
+	    (error = dev_sysctl("xfer_count", &c->xfers)) != 0)
+		return (error);
+	return (0);
+}
+
+static void
+dev_close(void)
+{
+	int i;
+
+	for (i = 0; i < dev_nfds; i++)
+		if (dev_fds[i] >= 0)
+			close(dev_fds[i]);
+	free(dev_fds);
+}
+
+const struct bench_backend bench_dev_backend = {
+	.name = "iic",
+	.threads = 1,
+	.open = dev_open,
+	.xfer = dev_xfer,
+	.now_ns = dev_now_ns,
+	.sleep_ns = dev_sleep_ns,
+	.counters = dev_counters,
+	.close = dev_close,
+};
+
+#else /* !__FreeBSD__ */
+
+#include <err.h>
+#include <errno.h>
+
+static int
+dev_open(const struct bench_opts *opts)
+{
+	warnx("iic(4) devices are only available on FreeBSD");
+	return (ENODEV);
+}
+
+const struct bench_backend bench_dev_backend = {
+	.name = "iic",
+	.open = dev_open,
+};
+
+#endif /* __FreeBSD__ */
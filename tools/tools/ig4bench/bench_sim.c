@@ -0,0 +1,169 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+/*
+ * Simulated backends: ig4_iic.c, or the Linux DesignWare master for
+ * comparison, on the ig4sim controller model (tools/tools/ig4sim) with
+ * a register-map slave at each address.  Time is the model's virtual
+ * clock, and both engines are measured by what the model saw, so that
+ * their numbers compare.
+ *
+ * The Linux engine is GPL code and only built into ig4bench-linux, with
+ * WITH_LINUX_REF defined.
+ */
+
+#include "ig4sim.h"
+#include "ig4bench.h"
+
+static device_t	sim_dev;
+static int	sim_linux;
+static uint64_t	sim_xfers;
+
+static int
+sim_open_common(const struct bench_opts *opts)
+{
+	int i, j;
+
+	sim_config.scl_hz = opts->scl_hz;
+	for (i = 0; i < opts->naddr; i++) {
+		for (j = 0; j < i; j++)
+			if (opts->addr[j] == opts->addr[i])
+				break;
+		if (j == i)
+			sim_add_slave(sim_regmap_slave(opts->addr[i], 256, 0));
+	}
+#ifdef WITH_LINUX_REF
+	if (sim_linux)
+		return (sim_linux_attach());
+#endif
+	if ((sim_dev = sim_attach()) == NULL)
+		return (ENXIO);
+	return (0);
+}
+
+static int
+sim_open(const struct bench_opts *opts)
+{
+	sim_linux = 0;
+	return (sim_open_common(opts));
+}
+
+#ifdef WITH_LINUX_REF
+static int
+linux_open(const struct bench_opts *opts)
+{
+	sim_linux = 1;
+	return (sim_open_common(opts));
+}
+#endif
+
+static int
+sim_xfer(int client, struct bench_msg *msgs, int nmsgs)
+{
+	struct iic_msg m[BENCH_MAXMSGS];
+	int i;
+
+	if (nmsgs > (int)nitems(m))
+		return (EINVAL);
+	for (i = 0; i < nmsgs; i++) {
+		m[i].slave = msgs[i].addr << 1;
+		m[i].flags = (msgs[i].flags & BENCH_M_RD ? IIC_M_RD :
+		    IIC_M_WR) | (msgs[i].flags & BENCH_M_NOSTOP ?
+		    IIC_M_NOSTOP : 0) | (msgs[i].flags & BENCH_M_NOSTART ?
+		    IIC_M_NOSTART : 0);
+		m[i].len = msgs[i].len;
+		m[i].buf = msgs[i].buf;
+	}
+	sim_xfers++;
+#ifdef WITH_LINUX_REF
+	if (sim_linux)
+		return (sim_linux_transfer(m, nmsgs));
+#endif
+	return (sim_transfer(sim_dev, m, nmsgs));
+}
+
+static uint64_t
+sim_now_ns(void)
+{
+	return (sbttons(sim_now()));
+}
+
+static void
+sim_sleep_ns(uint64_t ns)
+{
+	sim_idle(nstosbt(ns));
+}
+
+static int
+sim_counters(struct bench_counters *c)
+{
+	c->intrs = sim_stats.intrs;
+	c->mmio = sim_stats.mmio_reads + sim_stats.mmio_writes;
+	c->xfers = sim_xfers;
+	c->bus = 1;
+	c->bus_ns = sbttons(sim_stats.bus_busy);
+	c->stall_ns = sbttons(sim_stats.bus_stall);
+	return (0);
+}
+
+static void
+sim_close(void)
+{
+#ifdef WITH_LINUX_REF
+	if (sim_linux) {
+		sim_linux_detach();
+		return;
+	}
+#endif
+	sim_detach(sim_dev);
+}
+
+const struct bench_backend bench_sim_backend = {
+	.name = "sim",
+	.threads = 0,
+	.open = sim_open,
+	.xfer = sim_xfer,
+	.now_ns = sim_now_ns,
+	.sleep_ns = sim_sleep_ns,
+	.counters = sim_counters,
+	.close = sim_close,
+};
+
+#ifdef WITH_LINUX_REF
+const struct bench_backend bench_linux_backend = {
+	.name = "sim-linux",
+	.threads = 0,
+	.open = linux_open,
+	.xfer = sim_xfer,
+	.now_ns = sim_now_ns,
+	.sleep_ns = sim_sleep_ns,
+	.counters = sim_counters,
+	.close = sim_close,
+};
+#endif
@@ -0,0 +1,598 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Benchmark ig4iic transfers across transfer shapes and print one CSV
+ * row per data point:
+ *
+ *	ig4bench -d /dev/iic0 -u 0 -a 0x50	# hardware, read-only tests
+ *	ig4bench -s 400000			# simulated controller
+ *	ig4bench -r touch.cap			# replay a capture, simulated
+ *	ig4bench-linux -D -t wr		# ig4 against Linux, simulated
+ *
+ * Tests:
+ *	read	single read of size bytes
+ *	write	single write of a register byte plus size bytes (hardware
+ *		only with -W, it modifies the slave)
+ *	wr	register read: write the register byte, repeated start,
+ *		read size bytes
+ *	switch	wr of size bytes alternating between the two slaves every
+ *		clients transfers
+ *	conc	wr of size bytes from clients concurrent clients
+ *
+ * Latency is measured per transfer, from submission to completion, so
+ * under concurrency it includes the wait for the bus.  Interrupts and
+ * register accesses per transfer come from the driver's counters.
+ *
+ * -r replays a capture taken with tools/tools/ig4cap instead: the same
+ * transfers, each issued at its original offset from the first one (or
+ * back to back with -F), reported as a single "replay" row.  On the
+ * simulated controller every captured slave gets a register map.
+ *
+ * -e linux runs the simulated workload through the Linux DesignWare
+ * master (sys/dev/intel/linux_src) on the same model instead of
+ * ig4_iic.c, and -D runs it through both and prints, per data point,
+ * each metric side by side with the relative difference.  The bus
+ * columns, from the model only, show where the engines leave the bus
+ * idle: bus_util is the share of the time it was clocking, gap_us the
+ * idle time per transfer and stall_us the part of that during which
+ * the master held the bus waiting for the TX FIFO.  The Linux engine is
+ * GPL code, so both options are only in ig4bench-linux, built with
+ * WITH_LINUX_REF defined.
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <err.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ig4bench.h"
+
+#ifndef nitems
+#define	nitems(x)	(sizeof((x)) / sizeof((x)[0]))
+#endif
+
+#define	MAXSIZE		256
+#define	MAXCLIENTS	64
+
+struct bench_point {
+	const char	*test;
+	int		size;
+	int		clients;	/* concurrent clients */
+	int		every;		/* switch slaves every N transfers */
+	int		write;
+	int		read;
+	int		reg;		/* register byte before the data */
+};
+
+struct bench_client {
+	const struct bench_point *pt;
+	int		id;
+	int		count;
+	uint64_t	*lat;
+	int		errors;
+	uint8_t		wbuf[1 + MAXSIZE];
+	uint8_t		rbuf[MAXSIZE];
+};
+
+static const char csv_header[] =
+    "backend,test,size,clients,switch_every,xfers,errors,"
+    "bytes_per_s,p50_us,p99_us,intr_per_xfer,mmio_per_xfer,"
+    "bus_util,gap_us_per_xfer,stall_us_per_xfer\n";
+
+static const struct bench_backend *be;
+static struct bench_opts opts;
+static int	count = 200;
+static int	allow_write;
+
+static int
+cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x < y ? -1 : x > y);
+}
+
+static int
+client_xfer(struct bench_client *cl, int seq)
+{
+	const struct bench_point *pt = cl->pt;
+	struct bench_msg m[2];
+	uint16_t addr;
+	int n;
+
+	addr = opts.addr[0];
+	if (pt->every != 0 && (seq / pt->every) % 2 != 0)
+		addr = opts.addr[1];
+	n = 0;
+	cl->wbuf[0] = (uint8_t)(seq * 7);
+	if (pt->write || pt->reg) {
+		m[n].addr = addr;
+		m[n].flags = pt->read ? BENCH_M_NOSTOP : 0;
+		m[n].len = 1 + (pt->write ? pt->size : 0);
+		m[n].buf = cl->wbuf;
+		n++;
+	}
+	if (pt->read) {
+		m[n].addr = addr;
+		m[n].flags = BENCH_M_RD;
+		m[n].len = pt->size;
+		m[n].buf = cl->rbuf;
+		n++;
+	}
+	return (be->xfer(cl->id, m, n));
+}
+
+static void *
+client_run(void *arg)
+{
+	struct bench_client *cl = arg;
+	uint64_t t;
+	int i;
+
+	for (i = 0; i < cl->count; i++) {
+		t = be->now_ns();
+		if (client_xfer(cl, i) != 0)
+			cl->errors++;
+		cl->lat[i] = be->now_ns() - t;
+	}
+	return (NULL);
+}
+
+static void
+run_point(const struct bench_point *pt)
+{
+	static struct bench_client cls[MAXCLIENTS];
+	struct bench_counters c0, c1;
+	struct bench_point pt0;
+	pthread_t tids[MAXCLIENTS];
+	uint64_t *lat, start, t, elapsed;
+	int errors, i, j, n, per;
+
+	per = count / pt->clients;
+	if (per == 0)
+		per = 1;
+	n = per * pt->clients;
+	if ((lat = calloc(n, sizeof(*lat))) == NULL)
+		err(1, "calloc");
+	for (i = 0; i < pt->clients; i++) {
+		cls[i].pt = pt;
+		cls[i].id = i;
+		cls[i].count = per;
+		cls[i].lat = lat + i * per;
+		cls[i].errors = 0;
+		for (j = 0; j < MAXSIZE; j++)
+			cls[i].wbuf[j + 1] = (uint8_t)(i + j);
+	}
+
+	/*
+	 * Writes complete once their bytes are queued; let whatever the
+	 * previous point left in the FIFO drain outside the measurement.
+	 */
+	pt0 = *pt;
+	pt0.clients = 1;
+	pt0.every = 0;
+	pt0.size = 1;
+	pt0.write = 0;
+	pt0.read = 1;
+	cls[0].pt = &pt0;
+	client_xfer(&cls[0], 0);
+	cls[0].pt = pt;
+
+	if (be->counters(&c0) != 0)
+		exit(1);
+	start = be->now_ns();
+	if (pt->clients == 1) {
+		client_run(&cls[0]);
+	} else if (be->threads) {
+		for (i = 0; i < pt->clients; i++)
+			if ((errno = pthread_create(&tids[i], NULL, client_run,
+			    &cls[i])) != 0)
+				err(1, "pthread_create");
+		for (i = 0; i < pt->clients; i++)
+			pthread_join(tids[i], NULL);
+	} else {
+		/*
+		 * All clients submit at once; the driver serializes them on
+		 * its bus lock, so each one waits for those ahead of it.
+		 */
+		for (j = 0; j < per; j++) {
+			t = be->now_ns();
+			for (i = 0; i < pt->clients; i++) {
+				if (client_xfer(&cls[i], j) != 0)
+					cls[i].errors++;
+				cls[i].lat[j] = be->now_ns() - t;
+			}
+		}
+	}
+	elapsed = be->now_ns() - start;
+	if (be->counters(&c1) != 0)
+		exit(1);
+
+	errors = 0;
+	for (i = 0; i < pt->clients; i++)
+		errors += cls[i].errors;
+	bench_row(be, pt->test, pt->size, pt->clients, pt->every, n, errors,
+	    (uint64_t)n * pt->size, elapsed, lat, &c0, &c1);
+	free(lat);
+}
+
+/*
+ * The bus columns are empty unless the backend knows them: the share of
+ * the time the bus was clocking, the idle time on the bus per transfer
+ * (setup, interrupt latency and stalls) and of that the time the master
+ * held the bus waiting for the TX FIFO.
+ */
+void
+bench_row(const struct bench_backend *be, const char *test, int size,
+    int clients, int every, int n, int errors, uint64_t bytes,
+    uint64_t elapsed, uint64_t *lat, const struct bench_counters *c0,
+    const struct bench_counters *c1)
+{
+	uint64_t busy, xfers;
+
+	qsort(lat, n, sizeof(*lat), cmp_u64);
+	xfers = c1->xfers - c0->xfers;
+	printf("%s,%s,%d,%d,%d,%d,%d,%.0f,%.1f,%.1f,%.2f,%.2f,",
+	    be->name, test, size, clients, every, n, errors,
+	    elapsed != 0 ? (double)bytes * 1e9 / elapsed : 0.0,
+	    lat[n / 2] / 1e3, lat[n * 99 / 100] / 1e3,
+	    xfers != 0 ? (double)(c1->intrs - c0->intrs) / xfers : 0.0,
+	    xfers != 0 ? (double)(c1->mmio - c0->mmio) / xfers : 0.0);
+	busy = c1->bus_ns - c0->bus_ns;
+	if (c1->bus && elapsed != 0 && busy <= elapsed)
+		printf("%.3f,%.1f,%.1f\n", (double)busy / elapsed,
+		    (elapsed - busy) / 1e3 / n,
+		    (c1->stall_ns - c0->stall_ns) / 1e3 / n);
+	else
+		printf(",,\n");
+	fflush(stdout);
+}
+
+static int
+parse_list(const char *s, int *v, int max)
+{
+	char *end;
+	int n;
+
+	for (n = 0; n < max && *s != '\0'; n++) {
+		v[n] = strtol(s, &end, 0);
+		if (end == s || v[n] <= 0 || (*end != ',' && *end != '\0'))
+			return (-1);
+		s = *end == ',' ? end + 1 : end;
+	}
+	return (n);
+}
+
+static int
+want(const char *tests, const char *name)
+{
+	size_t len;
+
+	len = strlen(name);
+	while (tests != NULL && *tests != '\0') {
+		if (strncmp(tests, name, len) == 0 &&
+		    (tests[len] == ',' || tests[len] == '\0'))
+			return (1);
+		tests = strchr(tests, ',');
+		if (tests != NULL)
+			tests++;
+	}
+	return (0);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr,
+	    "usage: ig4bench [-DHW] [-a addr] [-b addr] [-c clients] [-d dev]\n"
+	    "                [-e ig4|linux] [-n count] [-s scl_hz] [-S sizes]\n"
+	    "                [-t tests] [-u unit]\n"
+	    "       ig4bench -r capture [-DFH] [-d dev] [-e ig4|linux] [-s scl_hz]\n"
+	    "                [-u unit]\n");
+	exit(1);
+}
+
+static void
+run_tests(const char *tests, const int *sizes, int nsizes)
+{
+	static const int every[] = { 1, 2, 8 };
+	struct bench_point pt;
+	int i, c;
+
+	for (i = 0; i < nsizes; i++) {
+		memset(&pt, 0, sizeof(pt));
+		pt.size = sizes[i];
+		pt.clients = 1;
+		if (want(tests, "read")) {
+			pt.test = "read";
+			pt.read = 1;
+			run_point(&pt);
+		}
+		if (want(tests, "write") &&
+		    (allow_write || be != &bench_dev_backend)) {
+			pt.test = "write";
+			pt.read = 0;
+			pt.write = 1;
+			run_point(&pt);
+		}
+		if (want(tests, "wr")) {
+			pt.test = "wr";
+			pt.read = pt.reg = 1;
+			pt.write = 0;
+			run_point(&pt);
+		}
+	}
+	memset(&pt, 0, sizeof(pt));
+	pt.size = 8;
+	pt.read = pt.reg = 1;
+	pt.clients = 1;
+	if (want(tests, "switch")) {
+		pt.test = "switch";
+		for (i = 0; i < (int)nitems(every); i++) {
+			pt.every = every[i];
+			run_point(&pt);
+		}
+		pt.every = 0;
+	}
+	if (want(tests, "conc")) {
+		pt.test = "conc";
+		for (c = 1; c <= opts.clients; c *= 2) {
+			pt.clients = c;
+			run_point(&pt);
+		}
+	}
+}
+
+static void
+run(const char *replay, int timed, const char *tests, const int *sizes,
+    int nsizes)
+{
+	if (be->open(&opts) != 0)
+		exit(1);
+	if (replay != NULL)
+		replay_run(be, timed);
+	else
+		run_tests(tests, sizes, nsizes);
+	be->close();
+}
+
+#ifdef WITH_LINUX_REF
+static int
+split(char *line, char **f, int max)
+{
+	int n;
+
+	line[strcspn(line, "\n")] = '\0';
+	for (n = 0; n < max && line != NULL; n++)
+		f[n] = strsep(&line, ",");
+	return (n);
+}
+
+/*
+ * Run the same workload through ig4_iic.c and through the Linux
+ * DesignWare master on the model, each in a child of its own so that
+ * both start from a freshly reset model, and print one row per data
+ * point and metric.
+ */
+static void
+run_diff(const char *replay, int timed, const char *tests,
+    const int *sizes, int nsizes)
+{
+	static const struct bench_backend *engines[2] = {
+		&bench_sim_backend, &bench_linux_backend
+	};
+	char hdr[sizeof(csv_header)], *names[16], *f[2][16];
+	char **rows[2], *line;
+	size_t cap;
+	double a, b;
+	FILE *fp;
+	pid_t pid;
+	int fds[2], nrows[2], e, i, j, nf, status;
+
+	for (e = 0; e < 2; e++) {
+		fflush(stdout);
+		if (pipe(fds) != 0)
+			err(1, "pipe");
+		if ((pid = fork()) < 0)
+			err(1, "fork");
+		if (pid == 0) {
+			close(fds[0]);
+			if (dup2(fds[1], STDOUT_FILENO) < 0)
+				err(1, "dup2");
+			be = engines[e];
+			run(replay, timed, tests, sizes, nsizes);
+			fflush(stdout);
+			_exit(0);
+		}
+		close(fds[1]);
+		if ((fp = fdopen(fds[0], "r")) == NULL)
+			err(1, "fdopen");
+		rows[e] = NULL;
+		for (nrows[e] = 0;; nrows[e]++) {
+			if ((rows[e] = realloc(rows[e], (nrows[e] + 1) *
+			    sizeof(*rows[e]))) == NULL)
+				err(1, "realloc");
+			line = NULL;
+			cap = 0;
+			if (getline(&line, &cap, fp) < 0) {
+				free(line);
+				break;
+			}
+			rows[e][nrows[e]] = line;
+		}
+		fclose(fp);
+		if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+		    WEXITSTATUS(status) != 0)
+			errx(1, "%s run failed", engines[e]->name);
+	}
+	if (nrows[0] != nrows[1])
+		errx(1, "runs differ in length");
+
+	memcpy(hdr, csv_header, sizeof(hdr));
+	nf = split(hdr, names, nitems(names));
+	printf("test,size,clients,switch_every,metric,%s,%s,delta_pct\n",
+	    engines[0]->name, engines[1]->name);
+	for (i = 0; i < nrows[0]; i++) {
+		if (split(rows[0][i], f[0], nf) != nf ||
+		    split(rows[1][i], f[1], nf) != nf)
+			errx(1, "bad row %d", i);
+		/* The metrics start after xfers and errors. */
+		for (j = 7; j < nf; j++) {
+			printf("%s,%s,%s,%s,%s,%s,%s,", f[0][1], f[0][2],
+			    f[0][3], f[0][4], names[j], f[0][j], f[1][j]);
+			a = strtod(f[0][j], NULL);
+			b = strtod(f[1][j], NULL);
+			if (*f[0][j] != '\0' && *f[1][j] != '\0' && a != 0)
+				printf("%.1f", (b - a) * 100 / a);
+			printf("\n");
+		}
+		free(rows[0][i]);
+		free(rows[1][i]);
+	}
+	free(rows[0]);
+	free(rows[1]);
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+	const char *engine, *replay, *tests;
+	int sizes[16], nsizes, diff, header, timed, ch, i;
+
+	tests = "read,write,wr,switch,conc";
+	nsizes = parse_list("1,2,4,8,16,32,64,128,256", sizes, nitems(sizes));
+	diff = 0;
+	engine = "ig4";
+	header = 1;
+	replay = NULL;
+	timed = 1;
+	opts.naddr = 2;
+	opts.addr[0] = 0x50;
+	opts.addr[1] = 0x51;
+	opts.clients = 8;
+	while ((ch = getopt(argc, argv, "a:b:c:d:De:FHn:r:s:S:t:u:W")) != -1) {
+		switch (ch) {
+		case 'a':
+			opts.addr[0] = strtoul(optarg, NULL, 0) & 0x7f;
+			break;
+		case 'b':
+			opts.addr[1] = strtoul(optarg, NULL, 0) & 0x7f;
+			break;
+		case 'c':
+			opts.clients = atoi(optarg);
+			break;
+		case 'd':
+			opts.dev = optarg;
+			break;
+		case 'D':
+			diff = 1;
+			break;
+		case 'e':
+			engine = optarg;
+			break;
+		case 'F':
+			timed = 0;
+			break;
+		case 'H':
+			header = 0;
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'r':
+			replay = optarg;
+			break;
+		case 's':
+			opts.scl_hz = atoi(optarg);
+			break;
+		case 'S':
+			nsizes = parse_list(optarg, sizes, nitems(sizes));
+			break;
+		case 't':
+			tests = optarg;
+			break;
+		case 'u':
+			opts.unit = atoi(optarg);
+			break;
+		case 'W':
+			allow_write = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (nsizes <= 0 || count <= 0 || opts.clients <= 0 ||
+	    opts.clients > MAXCLIENTS)
+		usage();
+	if (strcmp(engine, "ig4") != 0 && strcmp(engine, "linux") != 0)
+		usage();
+#ifndef WITH_LINUX_REF
+	if (diff || strcmp(engine, "ig4") != 0)
+		errx(1, "the Linux engine is only in ig4bench-linux");
+#endif
+	if ((diff || strcmp(engine, "ig4") != 0) && opts.dev != NULL)
+		errx(1, "the Linux engine only runs simulated");
+	for (i = 0; i < nsizes; i++)
+		if (sizes[i] > MAXSIZE)
+			errx(1, "size %d larger than %d", sizes[i], MAXSIZE);
+
+	if (replay != NULL) {
+		opts.clients = 1;
+		if (replay_load(replay, &opts) != 0)
+			exit(1);
+	}
+#ifdef WITH_LINUX_REF
+	if (diff) {
+		run_diff(replay, timed, tests, sizes, nsizes);
+		return (0);
+	}
+#endif
+
+	if (opts.dev != NULL)
+		be = &bench_dev_backend;
+#ifdef WITH_LINUX_REF
+	else if (strcmp(engine, "linux") == 0)
+		be = &bench_linux_backend;
+#endif
+	else
+		be = &bench_sim_backend;
+	if (be == &bench_dev_backend && !allow_write && want(tests, "write") &&
+	    replay == NULL)
+		warnx("skipping write tests, use -W to write to the slave");
+	if (header)
+		printf("%s", csv_header);
+	run(replay, timed, tests, sizes, nsizes);
+	return (0);
+}
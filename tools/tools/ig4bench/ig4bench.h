@@ -0,0 +1,108 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef _IG4BENCH_H_
+#define _IG4BENCH_H_
+
+#include <stdint.h>
+
+/*
+ * A transfer as the benchmark describes it, independent of whether it
+ * ends up in an I2CRDWR ioctl or in the simulated controller.  addr is
+ * the 7-bit slave address.
+ */
+struct bench_msg {
+	uint16_t	addr;
+	uint16_t	flags;
+#define	BENCH_M_RD	0x0001
+#define	BENCH_M_NOSTOP	0x0002
+#define	BENCH_M_NOSTART	0x0004
+	uint16_t	len;
+	uint8_t		*buf;
+};
+
+#define	BENCH_MAXMSGS	8		/* messages per transfer */
+#define	BENCH_MAXSLAVES	16
+
+/*
+ * Driver counters, dev.ig4iic.<unit>.{intr_count,xfer_mmio,xfer_count},
+ * or what the register model saw.  Only the model knows how long the
+ * bus was clocking and how long the master held it waiting for the TX
+ * FIFO; bus is set when it filled those in.
+ */
+struct bench_counters {
+	uint64_t	intrs;
+	uint64_t	mmio;
+	uint64_t	xfers;
+	int		bus;
+	uint64_t	bus_ns;
+	uint64_t	stall_ns;
+};
+
+struct bench_opts {
+	const char	*dev;		/* /dev/iicN, NULL: simulated */
+	int		unit;		/* ig4iic unit behind dev */
+	int		scl_hz;		/* simulated bus clock */
+	int		clients;	/* most concurrent clients */
+	int		naddr;
+	uint16_t	addr[BENCH_MAXSLAVES]; /* slaves, the second for
+					   switching */
+};
+
+/*
+ * open() prepares client slots 0 .. opts->clients - 1.  With threads set
+ * the clients run in their own threads and xfer() must be thread safe;
+ * otherwise concurrent clients are modelled by submitting their requests
+ * back to back, which is what serialization on the bus lock amounts to.
+ */
+struct bench_backend {
+	const char	*name;
+	int		threads;
+	int		(*open)(const struct bench_opts *opts);
+	int		(*xfer)(int client, struct bench_msg *msgs, int nmsgs);
+	uint64_t	(*now_ns)(void);
+	void		(*sleep_ns)(uint64_t ns);
+	int		(*counters)(struct bench_counters *c);
+	void		(*close)(void);
+};
+
+extern const struct bench_backend bench_dev_backend;
+extern const struct bench_backend bench_sim_backend;
+extern const struct bench_backend bench_linux_backend;
+
+/* One CSV row, ig4bench.c.  Sorts lat. */
+void	bench_row(const struct bench_backend *be, const char *test, int size,
+	    int clients, int every, int n, int errors, uint64_t bytes,
+	    uint64_t elapsed, uint64_t *lat, const struct bench_counters *c0,
+	    const struct bench_counters *c1);
+
+/* Capture replay, replay.c. */
+int	replay_load(const char *path, struct bench_opts *opts);
+void	replay_run(const struct bench_backend *be, int timed);
+
+#endif /* _IG4BENCH_H_ */
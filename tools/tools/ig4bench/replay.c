@@ -0,0 +1,271 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Capture replay.  The capture (sys/dev/ichiic/ig4_capture.h) is loaded
+ * whole; every record becomes one transfer with the captured slaves,
+ * flags and write data and read buffers of the captured lengths.  Timed
+ * replay issues each transfer at its captured offset from the first one
+ * and counts those that could not start on time because the previous
+ * one was still running.  Outcomes that differ from the capture (an
+ * error where there was none or the other way round, read data that
+ * does not match) are reported on stderr; against the simulated
+ * controller read data differs by design.
+ */
+
+#include <sys/types.h>
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <dev/ichiic/ig4_capture.h>
+
+#include "ig4bench.h"
+
+/* IIC_M_* from dev/iicbus/iic.h, as recorded in the capture. */
+#define	CAP_M_RD	0x0001
+#define	CAP_M_NOSTOP	0x0002
+#define	CAP_M_NOSTART	0x0004
+
+#define	LATE_NS		100000		/* started late by more than this */
+
+struct replay_xfer {
+	uint64_t	at;		/* ns after the first transfer */
+	uint64_t	dur;		/* captured duration, ns */
+	int		error;		/* captured result */
+	int		nmsgs;
+	struct bench_msg msgs[BENCH_MAXMSGS];
+	uint8_t		*cap[BENCH_MAXMSGS]; /* captured data */
+	uint16_t	caplen[BENCH_MAXMSGS];
+};
+
+static struct replay_xfer *xfers;
+static int	nxfers;
+static uint8_t	*image;
+
+static uint64_t
+sbt_to_ns(uint64_t sbt)
+{
+	return ((sbt >> 32) * 1000000000 +
+	    (((sbt & 0xffffffff) * 1000000000) >> 32));
+}
+
+static int
+cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x < y ? -1 : x > y);
+}
+
+static int
+add_slave(struct bench_opts *opts, uint16_t addr)
+{
+	int i;
+
+	for (i = 0; i < opts->naddr; i++)
+		if (opts->addr[i] == addr)
+			return (0);
+	if (opts->naddr == BENCH_MAXSLAVES) {
+		warnx("more than %d slaves in the capture", BENCH_MAXSLAVES);
+		return (E2BIG);
+	}
+	opts->addr[opts->naddr++] = addr;
+	return (0);
+}
+
+/*
+ * Load the capture and replace opts' slaves with the ones it talks to.
+ */
+int
+replay_load(const char *path, struct bench_opts *opts)
+{
+	const struct ig4iic_cap_rec *rec;
+	const struct ig4iic_cap_msg *cm;
+	struct replay_xfer *x;
+	uint64_t first;
+	uint8_t *p;
+	size_t size, off;
+	ssize_t n;
+	int fd, i, error;
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		warn("%s", path);
+		return (errno);
+	}
+	size = 0;
+	image = NULL;
+	for (;;) {
+		if ((image = realloc(image, size + 65536)) == NULL)
+			err(1, "realloc");
+		if ((n = read(fd, image + size, 65536)) < 0)
+			err(1, "%s", path);
+		if (n == 0)
+			break;
+		size += n;
+	}
+	close(fd);
+
+	nxfers = 0;
+	for (off = 0; off + sizeof(*rec) <= size; off += rec->size) {
+		rec = (const struct ig4iic_cap_rec *)(image + off);
+		if (rec->size < sizeof(*rec) || rec->size > size - off)
+			break;
+		nxfers++;
+	}
+	if (off != size) {
+		warnx("%s: bad record at offset %zu", path, off);
+		return (EINVAL);
+	}
+	if (nxfers == 0) {
+		warnx("%s: empty capture", path);
+		return (EINVAL);
+	}
+	if ((xfers = calloc(nxfers, sizeof(*xfers))) == NULL)
+		err(1, "calloc");
+
+	opts->naddr = 0;
+	first = 0;
+	x = xfers;
+	for (off = 0; off < size; off += rec->size, x++) {
+		rec = (const struct ig4iic_cap_rec *)(image + off);
+		if (rec->nmsgs == 0 || rec->nmsgs > BENCH_MAXMSGS ||
+		    sizeof(*rec) + rec->nmsgs * sizeof(*cm) > rec->size) {
+			warnx("%s: record %u: bad message count %u", path,
+			    rec->seq, rec->nmsgs);
+			return (EINVAL);
+		}
+		if (x == xfers)
+			first = rec->start;
+		x->at = sbt_to_ns(rec->start - first);
+		x->dur = sbt_to_ns(rec->end - rec->start);
+		x->error = rec->error;
+		x->nmsgs = rec->nmsgs;
+		cm = (const struct ig4iic_cap_msg *)(rec + 1);
+		p = (uint8_t *)(cm + rec->nmsgs);
+		for (i = 0; i < rec->nmsgs; i++) {
+			if (p + cm[i].caplen > (uint8_t *)rec + rec->size) {
+				warnx("%s: record %u: short data", path,
+				    rec->seq);
+				return (EINVAL);
+			}
+			x->msgs[i].addr = cm[i].slave >> 1;
+			x->msgs[i].flags =
+			    (cm[i].flags & CAP_M_RD ? BENCH_M_RD : 0) |
+			    (cm[i].flags & CAP_M_NOSTOP ? BENCH_M_NOSTOP : 0) |
+			    (cm[i].flags & CAP_M_NOSTART ? BENCH_M_NOSTART : 0);
+			x->msgs[i].len = cm[i].len;
+			if ((x->msgs[i].buf = calloc(1, cm[i].len + 1)) == NULL)
+				err(1, "calloc");
+			x->cap[i] = p;
+			x->caplen[i] = cm[i].caplen;
+			if ((cm[i].flags & CAP_M_RD) == 0)
+				memcpy(x->msgs[i].buf, p, cm[i].caplen);
+			p += cm[i].caplen;
+			if ((error = add_slave(opts, x->msgs[i].addr)) != 0)
+				return (error);
+		}
+	}
+	return (0);
+}
+
+void
+replay_run(const struct bench_backend *be, int timed)
+{
+	struct bench_counters c0, c1;
+	struct replay_xfer *x;
+	uint64_t *lat, *orig, bytes, start, t, late_max, elapsed;
+	int errors, late, newerr, lost, datadiff, error, i, j;
+
+	if ((lat = calloc(nxfers, sizeof(*lat))) == NULL ||
+	    (orig = calloc(nxfers, sizeof(*orig))) == NULL)
+		err(1, "calloc");
+	bytes = 0;
+	errors = late = newerr = lost = datadiff = 0;
+	late_max = 0;
+	if (be->counters(&c0) != 0)
+		exit(1);
+	start = be->now_ns();
+	for (i = 0; i < nxfers; i++) {
+		x = &xfers[i];
+		t = be->now_ns() - start;
+		if (timed && t < x->at) {
+			be->sleep_ns(x->at - t);
+			t = be->now_ns() - start;
+		}
+		if (timed && t > x->at + LATE_NS) {
+			late++;
+			if (t - x->at > late_max)
+				late_max = t - x->at;
+		}
+		t = be->now_ns();
+		error = be->xfer(0, x->msgs, x->nmsgs);
+		lat[i] = be->now_ns() - t;
+		orig[i] = x->dur;
+		if (error != 0)
+			errors++;
+		if (error != 0 && x->error == 0)
+			newerr++;
+		else if (error == 0 && x->error != 0)
+			lost++;
+		for (j = 0; j < x->nmsgs; j++) {
+			bytes += x->msgs[j].len;
+			if (error == 0 && x->error == 0 &&
+			    (x->msgs[j].flags & BENCH_M_RD) != 0 &&
+			    memcmp(x->msgs[j].buf, x->cap[j],
+			    x->caplen[j]) != 0)
+				datadiff++;
+		}
+	}
+	elapsed = be->now_ns() - start;
+	if (be->counters(&c1) != 0)
+		exit(1);
+
+	bench_row(be, "replay", bytes / nxfers, 1, 0, nxfers, errors, bytes,
+	    elapsed, lat, &c0, &c1);
+	qsort(orig, nxfers, sizeof(*orig), cmp_u64);
+	fprintf(stderr, "captured p50 %.1f us p99 %.1f us, span %.3f ms "
+	    "(replayed in %.3f ms)\n", orig[nxfers / 2] / 1e3,
+	    orig[nxfers * 99 / 100] / 1e3,
+	    xfers[nxfers - 1].at / 1e6, elapsed / 1e6);
+	if (late != 0)
+		fprintf(stderr, "%d transfers started late, by up to %.1f us\n",
+		    late, late_max / 1e3);
+	if (newerr != 0 || lost != 0)
+		fprintf(stderr, "%d new errors, %d captured errors not "
+		    "reproduced\n", newerr, lost);
+	if (datadiff != 0)
+		fprintf(stderr, "%d reads returned other data than captured\n",
+		    datadiff);
+	free(orig);
+	free(lat);
+}
@@ -0,0 +1,209 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Record and print ig4iic transfer captures.
+ *
+ *	sysctl dev.ig4iic.0.capture_size=262144
+ *	ig4cap -c 0 touch.cap		# drain the capture stream to a file
+ *	ig4cap touch.cap		# print it
+ *	ig4bench -r touch.cap		# replay it, see tools/tools/ig4bench
+ *
+ * A capture file is the plain concatenation of the records read from
+ * dev.ig4iic.N.capture_buf, see sys/dev/ichiic/ig4_capture.h.
+ */
+
+#include <sys/types.h>
+#include <sys/sysctl.h>
+
+#include <dev/iicbus/iic.h>
+
+#include <err.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <dev/ichiic/ig4_capture.h>
+
+static volatile sig_atomic_t stop;
+
+/* sbintime_t is 32.32 fixed point seconds. */
+static uint64_t
+sbt2ns(uint64_t sbt)
+{
+	return ((sbt >> 32) * 1000000000 +
+	    (((sbt & 0xffffffff) * 1000000000) >> 32));
+}
+
+static void
+onsig(int sig)
+{
+	stop = 1;
+}
+
+static void
+capture(int unit, const char *path, int interval_ms)
+{
+	char name[64];
+	FILE *fp;
+	void *buf;
+	size_t len, size;
+	uint64_t total;
+
+	snprintf(name, sizeof(name), "dev.ig4iic.%d.capture_buf", unit);
+	if ((fp = fopen(path, "w")) == NULL)
+		err(1, "%s", path);
+	signal(SIGINT, onsig);
+	signal(SIGTERM, onsig);
+	buf = NULL;
+	size = 0;
+	total = 0;
+	while (!stop) {
+		if (sysctlbyname(name, NULL, &len, NULL, 0) != 0)
+			err(1, "%s", name);
+		if (len != 0) {
+			/* Room for transfers completed in the meantime. */
+			len += len / 4;
+			if (len > size) {
+				if ((buf = realloc(buf, len)) == NULL)
+					err(1, "realloc");
+				size = len;
+			}
+			if (sysctlbyname(name, buf, &len, NULL, 0) != 0 &&
+			    errno != ENOMEM)
+				err(1, "%s", name);
+			if (fwrite(buf, 1, len, fp) != len)
+				err(1, "%s", path);
+			fflush(fp);
+			total += len;
+		}
+		usleep(interval_ms * 1000);
+	}
+	if (fclose(fp) != 0)
+		err(1, "%s", path);
+	fprintf(stderr, "%ju bytes captured\n", (uintmax_t)total);
+}
+
+static void
+print(const char *path, int maxdata)
+{
+	const struct ig4iic_cap_rec *rec;
+	const struct ig4iic_cap_msg *cm;
+	const uint8_t *p;
+	FILE *fp;
+	uint8_t *buf;
+	uint64_t t0;
+	size_t len, n, off;
+	int i, j;
+
+	if ((fp = fopen(path, "r")) == NULL)
+		err(1, "%s", path);
+	buf = NULL;
+	len = 0;
+	do {
+		if ((buf = realloc(buf, len + 65536)) == NULL)
+			err(1, "realloc");
+		n = fread(buf + len, 1, 65536, fp);
+		len += n;
+	} while (n == 65536);
+	if (ferror(fp))
+		err(1, "%s", path);
+	fclose(fp);
+
+	t0 = 0;
+	for (off = 0; off + sizeof(*rec) <= len; off += rec->size) {
+		rec = (const struct ig4iic_cap_rec *)(buf + off);
+		if (rec->size < sizeof(*rec) || off + rec->size > len)
+			errx(1, "%s: bad record at offset %zu", path, off);
+		if (t0 == 0)
+			t0 = rec->start;
+		printf("%12.6f %8u %8.1fus err %d%s\n",
+		    sbt2ns(rec->start - t0) / 1e9, rec->seq,
+		    sbt2ns(rec->end - rec->start) / 1e3, rec->error,
+		    rec->flags & IG4_CAP_DROPPED ? " (after drops)" : "");
+		cm = (const struct ig4iic_cap_msg *)(rec + 1);
+		p = (const uint8_t *)(cm + rec->nmsgs);
+		for (i = 0; i < rec->nmsgs; i++) {
+			printf("    0x%02x %c%s%s len %u:", cm[i].slave >> 1,
+			    cm[i].flags & IIC_M_RD ? 'R' : 'W',
+			    cm[i].flags & IIC_M_NOSTART ? " nostart" : "",
+			    cm[i].flags & IIC_M_NOSTOP ? " nostop" : "",
+			    cm[i].len);
+			for (j = 0; j < cm[i].caplen && j < maxdata; j++)
+				printf(" %02x", p[j]);
+			printf("%s\n", cm[i].caplen > maxdata ? " ..." : "");
+			p += cm[i].caplen;
+		}
+	}
+	free(buf);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: ig4cap -c unit [-i interval_ms] file\n"
+	    "       ig4cap [-x bytes] file\n");
+	exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+	int ch, interval_ms, maxdata, unit;
+
+	unit = -1;
+	interval_ms = 100;
+	maxdata = 16;
+	while ((ch = getopt(argc, argv, "c:i:x:")) != -1) {
+		switch (ch) {
+		case 'c':
+			unit = atoi(optarg);
+			break;
+		case 'i':
+			interval_ms = atoi(optarg);
+			break;
+		case 'x':
+			maxdata = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (argc != 1)
+		usage();
+
+	if (unit >= 0)
+		capture(unit, argv[0], interval_ms);
+	else
+		print(argv[0], maxdata);
+	return (0);
+}
@@ -0,0 +1,549 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+/*
+ * libFuzzer target for ig4iic_transfer() on the simulated controller of
+ * ../ig4sim.  An input is a bus setup followed by a list of operations:
+ * transfers made of arbitrary iic_msg arrays, idle periods in which late
+ * interrupts and the driver's timers run, and changes of the interrupt
+ * latency.  Interrupts also arrive spuriously (sim_config.spurious_ppm),
+ * so the filter runs at every point the driver drops io_lock, and with
+ * sim_config.intr_preempt between any two register accesses.  After
+ * each step the harness checks that
+ *
+ *  - no lock is left held, by the transfer or by the interrupt handler,
+ *  - the receive ring never holds more than IG4_RBUFSIZE unread bytes,
+ *  - the transfer returned an IIC error code within bounded (virtual)
+ *    time,
+ *  - the bus is released with a STOP once the transfer is over, unless
+ *    its last message was IIC_M_NOSTOP and went through,
+ *  - a successful transfer moved exactly what it was given: its reads
+ *    returned the slaves' data and, once the bus drained, the slaves
+ *    had seen every byte it wrote,
+ *
+ * and aborts if one does not hold.  The last check is skipped for
+ * transfers that saw a transmit abort or an injected fault, the driver
+ * does not look at TX_ABRT_SOURCE, and so is the STOP check after an
+ * injected fault.
+ *
+ * Built with -DIG4FUZZ_MAIN the harness brings its own driver, which
+ * runs the given input files or random inputs; see the Makefile.
+ */
+
+#include "ig4sim.h"
+
+#include <dev/ichiic/ig4_reg.h>
+#include <dev/ichiic/ig4_var.h>
+
+#define FUZZ_MAXMSGS	8
+#define FUZZ_MAXLEN	(255 + 3 * 128)
+#define FUZZ_WAIT_LIMIT	(30 * SBT_1MS)	/* one wait_status(), with slack */
+#define FUZZ_EN_LIMIT	(110 * SBT_1MS)	/* one set_controller() */
+#define FUZZ_DRAIN	(20 * SBT_1MS)	/* empties the FIFO at any setting */
+
+/* Counting slave: reads return a sequence, writes must continue one. */
+struct fuzz_slave {
+	struct sim_slave s;
+	uint8_t		rctr;		/* next byte to read */
+	uint8_t		wctr;		/* next byte expected */
+	int		wbad;		/* written byte out of sequence */
+	int		nack_at;	/* NACK the nth byte of a write, 0: never */
+	int		wpos;
+	uint8_t		wnext;		/* next byte the harness queues */
+	int		wexact;		/* wnext is what wctr will reach */
+};
+
+struct fuzz_input {
+	const uint8_t	*p;
+	size_t		len;
+};
+
+static struct fuzz_slave fslaves[2];
+static const uint16_t fuzz_addr[4] = { 0x50, 0x51, 0x52, 0x50 }; /* 0x52: absent */
+static const int fuzz_scl[4] = { 0, 100000, 400000, 1000000 }; /* 0: CTL */
+static struct sim_config sim_defaults;
+static uint8_t	bufs[FUZZ_MAXMSGS][FUZZ_MAXLEN];
+static ig4iic_softc_t *fuzz_sc;
+static const char *fuzz_faults[] = { "fault_aborts", "fault_rx_drops",
+    "fault_enable_stucks", "fault_intr_delays" };
+static const char *fuzz_knobs[] = { "fault_abort_ppm", "fault_rx_drop_ppm",
+    "fault_enable_stuck_ppm", "fault_intr_delay_ppm" };
+
+static uint64_t	drain_aborts;	/* sim_stats.aborts at the last drain */
+static uint64_t	nxfers, nerrors, naborts;
+static int	fuzz_verbose;
+
+#define CHECK(cond, ...) do {						\
+	if (!(cond)) {							\
+		fflush(stdout);						\
+		fprintf(stderr, "ig4fuzz: " __VA_ARGS__);		\
+		fprintf(stderr, " (%s:%d)\n", __FILE__, __LINE__);	\
+		abort();						\
+	}								\
+} while (0)
+
+static uint8_t
+get8(struct fuzz_input *in)
+{
+	if (in->len == 0)
+		return (0);
+	in->len--;
+	return (*in->p++);
+}
+
+static int
+fslave_start(struct sim_slave *s, int read)
+{
+	struct fuzz_slave *fs = s->priv;
+
+	if (!read)
+		fs->wpos = 0;
+	return (0);
+}
+
+static int
+fslave_write(struct sim_slave *s, uint8_t byte)
+{
+	struct fuzz_slave *fs = s->priv;
+
+	if (fs->nack_at != 0 && ++fs->wpos == fs->nack_at)
+		return (1);
+	if (byte != fs->wctr)
+		fs->wbad = 1;
+	fs->wctr++;
+	return (0);
+}
+
+static uint8_t
+fslave_read(struct sim_slave *s)
+{
+	struct fuzz_slave *fs = s->priv;
+
+	return (fs->rctr++);
+}
+
+static struct fuzz_slave *
+fslave_find(uint16_t addr)
+{
+	u_int i;
+
+	for (i = 0; i < nitems(fslaves); i++)
+		if (fslaves[i].s.addr == addr)
+			return (&fslaves[i]);
+	return (NULL);
+}
+
+static void
+check_ring(void)
+{
+	int unread;
+
+	unread = (int)(fuzz_sc->rnext - fuzz_sc->rpos);
+	CHECK(unread >= 0 && unread <= IG4_RBUFSIZE,
+	    "receive ring holds %d bytes", unread);
+}
+
+/*
+ * With the bus drained every byte queued by the successful transfers
+ * since the last drain must have reached its slave, unless an abort
+ * flushed the FIFO: writes return once queued, so a NACK can come after
+ * the transfer reported success.
+ */
+static void
+check_drained(int stop_due)
+{
+	struct fuzz_slave *fs;
+	u_int i;
+
+	CHECK(!stop_due || !sim_bus_active(), "bus held after transfer, "
+	    "no STOP");
+	for (i = 0; i < nitems(fslaves); i++) {
+		fs = &fslaves[i];
+		CHECK(!fs->wexact || sim_stats.aborts != drain_aborts ||
+		    (fs->wctr == fs->wnext && !fs->wbad),
+		    "slave %#x did not get the data written", fs->s.addr);
+		fs->wnext = fs->wctr;
+		fs->wbad = 0;
+		fs->wexact = 1;
+	}
+	drain_aborts = sim_stats.aborts;
+}
+
+static uint64_t
+fault_count(device_t dev)
+{
+	uint64_t n;
+	u_int i;
+
+	n = 0;
+	for (i = 0; i < nitems(fuzz_faults); i++)
+		n += sim_sysctl_u64(dev, fuzz_faults[i]);
+	return (n);
+}
+
+/*
+ * Build a transfer from the input, run it and check the result.  Returns
+ * whether the bus must have seen a STOP once the controller drained.
+ */
+static int
+fuzz_transfer(device_t dev, struct fuzz_input *in)
+{
+	struct iic_msg msgs[FUZZ_MAXMSGS];
+	struct fuzz_slave *fs;
+	uint8_t rexp[nitems(fslaves)];
+	uint64_t aborts, faults;
+	sbintime_t start, limit;
+	uint32_t n, i, j;
+	uint8_t f;
+	int error, raw;
+
+	/*
+	 * Every wait of the driver is bounded: a transfer takes at most a
+	 * wait_status() per byte and a few more per message, an address
+	 * change and the recovery from an error cycle IC_ENABLE twice each.
+	 */
+	limit = FUZZ_DRAIN;
+	/*
+	 * Message count, with the top bits set the messages are taken as
+	 * they come.  Otherwise each is made one ig4iic_transfer() accepts
+	 * after the previous one.  A message is its flags in the low bits,
+	 * the slave, the high bits of the length and a bit for a short
+	 * message, then the length.
+	 */
+	f = get8(in);
+	n = 1 + f % FUZZ_MAXMSGS;
+	raw = (f & 0xc0) == 0xc0;
+	for (i = 0; i < n; i++) {
+		f = get8(in);
+		msgs[i].slave = fuzz_addr[(f >> 3) & 3] << 1;
+		msgs[i].flags = f & (IIC_M_RD | IIC_M_NOSTOP | IIC_M_NOSTART);
+		msgs[i].len = get8(in);
+		if (f & 0x80)
+			msgs[i].len &= 0x0f;
+		else
+			msgs[i].len += ((f >> 5) & 3) * 128;
+		if (!raw) {
+			if (msgs[i].len == 0)
+				msgs[i].len = 1;
+			if (i == 0 || (msgs[i - 1].flags & IIC_M_NOSTOP) == 0)
+				msgs[i].flags &= ~IIC_M_NOSTART;
+			else {
+				msgs[i].slave = msgs[i - 1].slave;
+				if ((msgs[i].flags ^ msgs[i - 1].flags) &
+				    IIC_M_RD)
+					msgs[i].flags &= ~IIC_M_NOSTART;
+			}
+		}
+		msgs[i].buf = bufs[i];
+		limit += (msgs[i].len + 4) * FUZZ_WAIT_LIMIT +
+		    2 * FUZZ_EN_LIMIT;
+		fs = fslave_find(msgs[i].slave >> 1);
+		for (j = 0; j < msgs[i].len; j++) {
+			if (msgs[i].flags & IIC_M_RD)
+				bufs[i][j] = 0xa5;
+			else if (fs != NULL)
+				bufs[i][j] = fs->wnext++;
+			else
+				bufs[i][j] = j;
+		}
+	}
+	for (i = 0; i < nitems(fslaves); i++)
+		rexp[i] = fslaves[i].rctr;
+
+	aborts = sim_stats.aborts;
+	faults = fault_count(dev);
+	start = sim_now();
+	error = sim_transfer(dev, msgs, n);
+	nxfers++;
+	if (fuzz_verbose) {
+		printf("%12.3f us ", sbttons(sim_now()) / 1e3);
+		for (i = 0; i < n; i++)
+			printf(" %#x%s%s%s:%u", msgs[i].slave >> 1,
+			    msgs[i].flags & IIC_M_RD ? "r" : "w",
+			    msgs[i].flags & IIC_M_NOSTART ? "-" : "",
+			    msgs[i].flags & IIC_M_NOSTOP ? "+" : "",
+			    msgs[i].len);
+		printf(" -> %d%s\n", error, sim_stats.aborts != aborts ?
+		    " (abort)" : "");
+	}
+
+	CHECK(sim_locks_held() == 0, "%d locks held after transfer",
+	    sim_locks_held());
+	CHECK(error >= IIC_NOERR && error <= IIC_ERESOURCE,
+	    "transfer returned %d", error);
+	CHECK(sim_now() - start < limit,
+	    "transfer took %jd us", (intmax_t)sbttous(sim_now() - start));
+	check_ring();
+
+	if (error != 0)
+		nerrors++;
+	if (sim_stats.aborts != aborts)
+		naborts++;
+	if (error != 0 || sim_stats.aborts != aborts ||
+	    fault_count(dev) != faults) {
+		for (i = 0; i < nitems(fslaves); i++)
+			fslaves[i].wexact = 0;
+	} else {
+		for (i = 0; i < n; i++) {
+			if ((msgs[i].flags & IIC_M_RD) == 0)
+				continue;
+			fs = fslave_find(msgs[i].slave >> 1);
+			CHECK(fs != NULL, "read from absent slave %#x "
+			    "succeeded", msgs[i].slave >> 1);
+			for (j = 0; j < msgs[i].len; j++)
+				CHECK(bufs[i][j] == rexp[fs - fslaves]++,
+				    "msg %u byte %u read %#x", i, j,
+				    bufs[i][j]);
+		}
+		for (i = 0; i < nitems(fslaves); i++)
+			CHECK(fslaves[i].rctr == rexp[i],
+			    "slave %#x sent %d bytes more than were read",
+			    fslaves[i].s.addr,
+			    (uint8_t)(fslaves[i].rctr - rexp[i]));
+	}
+
+	/*
+	 * A rejected transfer leaves the bus as the previous one did.  An
+	 * injected abort only holds the TX FIFO, unlike a real one it does
+	 * not end the transaction on the bus.
+	 */
+	if (error == IIC_ENOTSUPP)
+		return (-1);
+	if (fault_count(dev) != faults)
+		return (0);
+	return (error != 0 || (msgs[n - 1].flags & IIC_M_NOSTOP) == 0);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	struct fuzz_input in = { data, size };
+	device_t dev;
+	uint64_t seed;
+	sbintime_t t;
+	u_int i, v;
+	int stop_due, r;
+	uint8_t b, op;
+
+	if (fslaves[0].s.addr == 0) {
+		sim_defaults = sim_config;
+		for (i = 0; i < nitems(fslaves); i++) {
+			fslaves[i].s.name = "fuzz";
+			fslaves[i].s.addr = fuzz_addr[i];
+			fslaves[i].s.start = fslave_start;
+			fslaves[i].s.write = fslave_write;
+			fslaves[i].s.read = fslave_read;
+			fslaves[i].s.priv = &fslaves[i];
+			sim_add_slave(&fslaves[i].s);
+		}
+		sim_intr_hook = check_ring;
+	}
+
+	/* Bus setup. */
+	sim_config = sim_defaults;
+	sim_config.fifo_depth = 2 + get8(&in) % 63;
+	sim_config.scl_hz = fuzz_scl[get8(&in) & 3];
+	sim_config.irq_latency_ns = get8(&in) * 100;
+	b = get8(&in);
+	sim_config.spurious_ppm = b < 128 ? 0 : (b - 127) * 2000;
+	sim_config.intr_preempt = b & 1;
+	fslaves[1].s.stretch_ns = get8(&in) * 100;
+	b = get8(&in);
+	fslaves[0].nack_at = b < 224 ? 0 : b - 223;
+	for (i = 0; i < nitems(fslaves); i++) {
+		fslaves[i].rctr = 0;
+		fslaves[i].wctr = 0;
+		fslaves[i].wnext = 0;
+		fslaves[i].wbad = 0;
+		fslaves[i].wexact = 1;
+	}
+	seed = 0;
+	for (i = 0; i < 4; i++)
+		seed = seed << 8 | get8(&in);
+	sim_seed(seed);
+	memset(&sim_stats, 0, sizeof(sim_stats));
+	drain_aborts = 0;
+
+	dev = sim_attach();
+	CHECK(dev != NULL, "attach failed");
+	fuzz_sc = device_get_softc(dev);
+	b = get8(&in);
+	for (i = 0; i < nitems(fuzz_knobs); i++) {
+		v = (b & (1 << i)) ? 20000 : 0;
+		sim_sysctl(dev, fuzz_knobs[i], NULL, NULL, &v, sizeof(v));
+	}
+	v = 50 + (b >> 4) * 100;
+	sim_sysctl(dev, "fault_intr_delay_us", NULL, NULL, &v, sizeof(v));
+
+	stop_due = 0;
+	while (in.len > 0) {
+		op = get8(&in);
+		switch (op & 3) {
+		case 0:
+		case 1:
+			r = fuzz_transfer(dev, &in);
+			if (r >= 0)
+				stop_due = r;
+			break;
+		case 2:
+			t = (op >> 2) * 500 * SBT_1US;
+			sim_idle(t);
+			CHECK(sim_locks_held() == 0, "locks held while idle");
+			check_ring();
+			if (t >= FUZZ_DRAIN) {
+				check_drained(stop_due);
+				stop_due = 0;
+			}
+			break;
+		case 3:
+			sim_config.irq_latency_ns = (op >> 2) * 1000;
+			break;
+		}
+	}
+	sim_idle(FUZZ_DRAIN);
+	check_drained(stop_due);
+
+	sim_detach(dev);
+	fuzz_sc = NULL;
+	CHECK(sim_locks_held() == 0, "locks held after detach");
+	return (0);
+}
+
+#ifdef IG4FUZZ_MAIN
+/*
+ * Stand-alone driver: ig4fuzz [-v] [-n runs] [-s seed] [-l maxlen]
+ * [file ...] runs each file as one input, or without files that many
+ * random inputs; -v lists the transfers.
+ * An input that fails a check, or hangs for 10 seconds, is written to
+ * crash-ig4fuzz for replay.
+ */
+#include <err.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+static const uint8_t *cur_data;
+static size_t	cur_size;
+
+static void
+save_input(int sig)
+{
+	int fd;
+
+	fd = open("crash-ig4fuzz", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd >= 0) {
+		(void)write(fd, cur_data, cur_size);
+		close(fd);
+	}
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+static void
+run_one(const uint8_t *data, size_t size)
+{
+	cur_data = data;
+	cur_size = size;
+	alarm(10);
+	LLVMFuzzerTestOneInput(data, size);
+	alarm(0);
+}
+
+int
+main(int argc, char **argv)
+{
+	static uint8_t buf[65536];
+	uint64_t x;
+	u_long runs, maxlen, i, j;
+	size_t len;
+	FILE *fp;
+	int ch;
+
+	runs = 10000;
+	maxlen = 256;
+	x = 1;
+	while ((ch = getopt(argc, argv, "l:n:s:v")) != -1) {
+		switch (ch) {
+		case 'l':
+			maxlen = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			runs = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			x = strtoull(optarg, NULL, 0);
+			break;
+		case 'v':
+			fuzz_verbose = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: ig4fuzz [-v] [-n runs] "
+			    "[-s seed] [-l maxlen] [file ...]\n");
+			exit(1);
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (maxlen == 0 || maxlen > sizeof(buf))
+		errx(1, "maxlen must be 1..%zu", sizeof(buf));
+	signal(SIGABRT, save_input);
+	signal(SIGALRM, save_input);
+
+	if (argc > 0) {
+		for (i = 0; i < (u_long)argc; i++) {
+			if ((fp = fopen(argv[i], "r")) == NULL)
+				err(1, "%s", argv[i]);
+			len = fread(buf, 1, sizeof(buf), fp);
+			fclose(fp);
+			run_one(buf, len);
+		}
+		runs = argc;
+	} else {
+		x = x << 1 | 1;
+		for (i = 0; i < runs; i++) {
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+			len = 1 + x % maxlen;
+			for (j = 0; j < len; j++) {
+				x ^= x << 13;
+				x ^= x >> 7;
+				x ^= x << 17;
+				buf[j] = x >> 24;
+			}
+			run_one(buf, len);
+		}
+	}
+	printf("ig4fuzz: %lu inputs, %ju transfers, %ju failed, %ju aborted\n",
+	    runs, (uintmax_t)nxfers, (uintmax_t)nerrors, (uintmax_t)naborts);
+	return (0);
+}
+#endif /* IG4FUZZ_MAIN */
@@ -0,0 +1,90 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Attach the Linux DesignWare master to the register model, the way
+ * i2c_dw_pci_probe() does for an Intel LPSS controller, and feed it
+ * transfers through its i2c_algorithm.  Built against lshim/.
+ */
+
+#include <linux/i2c.h>
+
+#include "i2c-designware-core.h"
+
+/* INTEL_*_CFG in i2c-designware-pcidrv.c, minus the speed. */
+#define	DWL_BUS_CFG	(DW_IC_CON_MASTER | DW_IC_CON_SLAVE_DISABLE |	\
+			 DW_IC_CON_RESTART_EN)
+
+static struct device	dwl_device = { "dw-linux" };
+static struct dw_i2c_dev dwl_dev;
+
+int
+dwl_attach(int fifo_depth, int fast)
+{
+	struct dw_i2c_dev *dev = &dwl_dev;
+
+	memset(dev, 0, sizeof(*dev));
+	dev->dev = &dwl_device;
+	dev->base = NULL;
+	dev->functionality = I2C_FUNC_10BIT_ADDR | DW_IC_DEFAULT_FUNCTIONALITY;
+	dev->master_cfg = DWL_BUS_CFG |
+	    (fast ? DW_IC_CON_SPEED_FAST : DW_IC_CON_SPEED_STD);
+	dev->tx_fifo_depth = fifo_depth;
+	dev->rx_fifo_depth = fifo_depth;
+	dev->timings.bus_freq_hz = fast ? 400000 : 100000;
+	/* The model clocks the bus at its own rate, any counts will do. */
+	dev->ss_hcnt = 0x264;
+	dev->ss_lcnt = 0x2c2;
+	dev->fs_hcnt = 0x6e;
+	dev->fs_lcnt = 0xcf;
+	return (-i2c_dw_probe(dev));
+}
+
+/* Returns a positive errno, like the FreeBSD side expects. */
+int
+dwl_xfer(struct dwl_msg *msgs, int nmsgs)
+{
+	struct i2c_adapter *adap = &dwl_dev.adapter;
+	struct i2c_msg m[8];
+	int i, ret;
+
+	if (nmsgs > (int)ARRAY_SIZE(m))
+		return (EINVAL);
+	for (i = 0; i < nmsgs; i++) {
+		m[i].addr = msgs[i].addr;
+		m[i].flags = msgs[i].flags & DWL_M_RD ? I2C_M_RD : 0;
+		m[i].len = msgs[i].len;
+		m[i].buf = msgs[i].buf;
+	}
+	ret = adap->algo->master_xfer(adap, m, nmsgs);
+	return (ret == nmsgs ? 0 : ret < 0 ? -ret : EIO);
+}
+
+void
+dwl_detach(void)
+{
+	dwl_dev.disable(&dwl_dev);
+}
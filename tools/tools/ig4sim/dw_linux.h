@@ -0,0 +1,63 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef _DW_LINUX_H_
+#define _DW_LINUX_H_
+
+/*
+ * The Linux DesignWare master (sys/dev/intel/linux_src) on the same
+ * register model as ig4_iic.c.  dw_linux.c builds against the Linux
+ * shim in lshim/, sim_linux.c against the FreeBSD one; this header is
+ * all they share, so it sticks to plain C types.
+ */
+
+#include <stdint.h>
+
+struct dwl_msg {
+	uint16_t	addr;		/* 7-bit */
+	uint16_t	flags;
+#define	DWL_M_RD	0x0001
+	uint16_t	len;
+	uint8_t		*buf;
+};
+
+/* dw_linux.c: the engine, as i2c_dw_pci_probe() would set it up. */
+int		dwl_attach(int fifo_depth, int fast);
+int		dwl_xfer(struct dwl_msg *msgs, int nmsgs);
+void		dwl_detach(void);
+
+/* sim_linux.c: the simulation primitives the Linux shim maps to. */
+uint32_t	dwl_reg_read(uint32_t off);
+void		dwl_reg_write(uint32_t off, uint32_t v);
+void		dwl_usleep(unsigned long us);
+unsigned long	dwl_wait(void *chan, int *done, unsigned long ms);
+void		dwl_wakeup(void *chan);
+int		dwl_setup_intr(int (*fn)(int, void *), void *arg);
+void		dwl_log(const char *name, const char *fmt, ...);
+
+#endif /* _DW_LINUX_H_ */
@@ -0,0 +1,522 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+/*
+ * Register model of the DesignWare I2C master as found in Intel LPSS and
+ * the older Haswell/Atom controllers, see ig4_reg.h.
+ *
+ * Covered: CTL and TAR (7-bit only), DATA_CMD with TX and RX FIFOs,
+ * I2C_STA, TXFLR/RXFLR, the INTR_* raw/mask/status/clear registers,
+ * I2C_EN/ENABLE_STATUS, TX_ABRT_SOURCE, the FIFO thresholds and the
+ * component registers the driver probes.  Everything else, including
+ * the LPSS private block, is plain storage.
+ *
+ * The bus engine executes one DATA_CMD entry at a time.  Each takes nine
+ * SCL periods, plus a START/RESTART and the address byte where one is
+ * needed and a period for a STOP, plus the addressed slave's clock
+ * stretching.  With an empty TX FIFO and no STOP the master holds the
+ * bus, which is accounted as a stall.
+ */
+
+#include "ig4sim.h"
+
+#include <dev/ichiic/ig4_reg.h>
+#include <dev/ichiic/ig4_var.h>
+
+#define SIM_SBT_INF	INT64_MAX
+#define SIM_REGS	0x1000
+
+/* Interrupts cleared by reading CLR_INTR, the rest reflect FIFO levels. */
+#define LATCHED_INTRS	(IG4_INTR_GEN_CALL | IG4_INTR_START_DET |	\
+			 IG4_INTR_STOP_DET | IG4_INTR_ACTIVITY |	\
+			 IG4_INTR_TX_ABRT | IG4_INTR_TX_OVER |		\
+			 IG4_INTR_RX_OVER | IG4_INTR_RX_UNDER |		\
+			 0x0080 /* RX_DONE */ | 0x0020 /* RD_REQ */)
+
+struct sim_config sim_config = {
+	.fifo_depth = 32,
+	.mmio_read_ns = 500,
+	.mmio_write_ns = 100,
+	.irq_latency_ns = 2000,
+	.wake_latency_ns = 3000,
+	.ithread_latency_ns = 3000,
+	.version = IG4_SKYLAKE,
+};
+struct sim_stats sim_stats;
+
+static struct {
+	sbintime_t	now;
+	uint32_t	regs[SIM_REGS / 4];	/* plain storage */
+	uint32_t	enabled;
+	uint32_t	raw;			/* latched interrupts */
+	uint32_t	abrt_source;
+	int		tx_hold;		/* TX FIFO flushed after abort */
+
+	uint16_t	txq[256];
+	u_int		tx_head, tx_len;
+	uint8_t		rxq[256];
+	u_int		rx_head, rx_len;
+
+	/* Bus engine. */
+	int		busy;
+	sbintime_t	begin;			/* cmd started */
+	sbintime_t	done;			/* cmd completes */
+	uint16_t	cmd;
+	int		cmd_start;		/* cmd begins with START */
+	int		active;			/* bus owned, no STOP yet */
+	int		dir_read;
+	struct sim_slave *target;
+	sbintime_t	stall_start;
+
+	int		irq;			/* line level */
+	sbintime_t	irq_since;
+
+	struct sim_slave *slaves;
+} m;
+
+sbintime_t
+sim_now(void)
+{
+	return (m.now);
+}
+
+/* The bus is owned: a START went out and no STOP followed yet. */
+int
+sim_bus_active(void)
+{
+	return (m.active);
+}
+
+void
+sim_add_slave(struct sim_slave *s)
+{
+	s->next = m.slaves;
+	m.slaves = s;
+}
+
+void
+sim_model_reset(void)
+{
+	struct sim_slave *slaves;
+	sbintime_t now;
+
+	slaves = m.slaves;
+	now = m.now;
+	memset(&m, 0, sizeof(m));
+	m.slaves = slaves;
+	m.now = now;
+	if (sim_config.fifo_depth <= 0 || sim_config.fifo_depth > 256)
+		sim_config.fifo_depth = 32;
+
+	/* Reset values, see ig4_reg.h. */
+	m.regs[IG4_REG_CTL / 4] = 0x7f;
+	m.regs[IG4_REG_TAR_ADD / 4] = 0x55;
+	m.regs[IG4_REG_SS_SCL_HCNT / 4] = 0x264;
+	m.regs[IG4_REG_SS_SCL_LCNT / 4] = 0x2c2;
+	m.regs[IG4_REG_FS_SCL_HCNT / 4] = 0x6e;
+	m.regs[IG4_REG_FS_SCL_LCNT / 4] = 0xcf;
+	m.regs[IG4_REG_INTR_MASK / 4] = 0x8ff;
+	m.regs[IG4_REG_SDA_HOLD / 4] = 0x1;
+	m.regs[IG4_REG_SDA_SETUP / 4] = 0x64;
+	m.regs[IG4_REG_COMP_PARAM1 / 4] = 0x00ffff6e;
+	m.regs[IG4_REG_COMP_VER / 4] = IG4_COMP_MIN_VER;
+	m.regs[IG4_REG_COMP_TYPE / 4] = 0x44570140;
+}
+
+static uint32_t
+raw_intr(void)
+{
+	uint32_t raw;
+
+	raw = m.raw;
+	if (m.rx_len > m.regs[IG4_REG_RX_TL / 4])
+		raw |= IG4_INTR_RX_FULL;
+	if (m.enabled && m.tx_len <= m.regs[IG4_REG_TX_TL / 4])
+		raw |= IG4_INTR_TX_EMPTY;
+	return (raw);
+}
+
+static void
+irq_update(void)
+{
+	int irq;
+
+	irq = m.enabled && (raw_intr() & m.regs[IG4_REG_INTR_MASK / 4]) != 0;
+	if (irq && !m.irq)
+		m.irq_since = m.now;
+	m.irq = irq;
+}
+
+static sbintime_t
+scl_period(void)
+{
+	int hz;
+
+	hz = sim_config.scl_hz;
+	if (hz <= 0) {
+		switch ((m.regs[IG4_REG_CTL / 4] >> 1) & 3) {
+		case 2:
+			hz = 400000;
+			break;
+		case 3:
+			hz = 3400000;
+			break;
+		default:
+			hz = 100000;
+			break;
+		}
+	}
+	return (SBT_1S / hz);
+}
+
+static struct sim_slave *
+find_slave(uint16_t addr)
+{
+	struct sim_slave *s;
+
+	for (s = m.slaves; s != NULL; s = s->next)
+		if (s->addr == addr)
+			return (s);
+	return (NULL);
+}
+
+static void
+tx_flush(void)
+{
+	m.tx_head = m.tx_len = 0;
+}
+
+static void
+rx_push(uint8_t c)
+{
+	if (m.rx_len == (u_int)sim_config.fifo_depth) {
+		m.raw |= IG4_INTR_RX_OVER;
+		return;
+	}
+	m.rxq[(m.rx_head + m.rx_len++) % nitems(m.rxq)] = c;
+}
+
+static void
+bus_stop(void)
+{
+	if (m.target != NULL && m.target->stop != NULL)
+		m.target->stop(m.target);
+	m.target = NULL;
+	m.active = 0;
+	m.raw |= IG4_INTR_STOP_DET;
+}
+
+static void
+bus_abort(uint32_t source)
+{
+	m.abrt_source |= source;
+	m.raw |= IG4_INTR_TX_ABRT;
+	m.tx_hold = 1;
+	tx_flush();
+	bus_stop();
+	sim_stats.aborts++;
+}
+
+/* Start the next command if the bus engine is free. */
+static void
+engine_kick(void)
+{
+	sbintime_t dur;
+	int start, read;
+
+	if (m.busy || !m.enabled || m.tx_hold || m.tx_len == 0)
+		return;
+	if (m.active && m.stall_start != 0) {
+		sim_stats.bus_stall += m.now - m.stall_start;
+		m.stall_start = 0;
+	}
+	m.cmd = m.txq[m.tx_head];
+	m.tx_head = (m.tx_head + 1) % nitems(m.txq);
+	m.tx_len--;
+
+	read = (m.cmd & IG4_DATA_COMMAND_RD) != 0;
+	start = !m.active || (m.cmd & IG4_DATA_RESTART) != 0 ||
+	    read != m.dir_read;
+	dur = 9 * scl_period();
+	if (start)
+		dur += 10 * scl_period();
+	if (m.cmd & IG4_DATA_STOP)
+		dur += scl_period();
+	if (m.target != NULL && !start)
+		dur += m.target->stretch_ns * SBT_1NS;
+	m.cmd_start = start;
+	m.busy = 1;
+	m.begin = m.now;
+	m.done = m.now + dur;
+	irq_update();
+}
+
+static void
+engine_complete(void)
+{
+	struct sim_slave *s;
+	int read;
+
+	m.busy = 0;
+	read = (m.cmd & IG4_DATA_COMMAND_RD) != 0;
+	sim_stats.bus_busy += m.done - m.begin;
+
+	if (m.cmd_start) {
+		if (m.active && m.target != NULL && m.target->stop != NULL)
+			m.target->stop(m.target);
+		m.active = 1;
+		m.dir_read = read;
+		m.raw |= IG4_INTR_START_DET | IG4_INTR_ACTIVITY;
+		sim_stats.bus_bytes++;
+		s = find_slave(m.regs[IG4_REG_TAR_ADD / 4] & 0x7f);
+		m.target = s;
+		if (s == NULL || (s->start != NULL && s->start(s, read) != 0)) {
+			m.target = NULL;
+			bus_abort(IG4_ABRTSRC_TXNOACK_ADDR7);
+			return;
+		}
+	}
+
+	sim_stats.bus_bytes++;
+	if (read) {
+		rx_push(m.target->read != NULL ? m.target->read(m.target) :
+		    0xff);
+	} else if (m.target->write != NULL &&
+	    m.target->write(m.target, m.cmd & IG4_DATA_MASK) != 0) {
+		bus_abort(IG4_ABRTSRC_TXNOACK_DATA);
+		return;
+	}
+
+	if (!m.enabled) {
+		m.rx_head = m.rx_len = 0;
+		bus_stop();
+	} else if (m.cmd & IG4_DATA_STOP)
+		bus_stop();
+	else if (m.tx_len == 0)
+		m.stall_start = m.done;
+}
+
+/* Run the bus up to time t. */
+void
+sim_advance(sbintime_t t)
+{
+	while (m.busy && m.done <= t) {
+		m.now = m.done;
+		engine_complete();
+		engine_kick();
+		irq_update();
+	}
+	if (t > m.now)
+		m.now = t;
+}
+
+sbintime_t
+sim_next_event(void)
+{
+	return (m.busy ? m.done : SIM_SBT_INF);
+}
+
+/* When the ISR may run for the asserted line, SIM_SBT_INF if idle. */
+sbintime_t
+sim_irq_ready(void)
+{
+	if (!m.irq)
+		return (SIM_SBT_INF);
+	return (m.irq_since + sim_config.irq_latency_ns * SBT_1NS);
+}
+
+static uint32_t reg_read(uint32_t off);
+static void reg_write(uint32_t off, uint32_t v);
+
+static uint32_t
+clear_intrs(uint32_t bits)
+{
+	m.raw &= ~bits;
+	if (bits & IG4_INTR_TX_ABRT) {
+		m.abrt_source = 0;
+		m.tx_hold = 0;
+		engine_kick();
+	}
+	irq_update();
+	return (0);
+}
+
+uint32_t
+sim_reg_read(uint32_t off)
+{
+	uint32_t v;
+
+	v = reg_read(off);
+	if (sim_config.verbose > 1)
+		printf("%12.3f us  R %03x %08x\n", sbttons(m.now) / 1e3, off, v);
+	if (sim_config.intr_preempt)
+		sim_try_intr();
+	return (v);
+}
+
+static uint32_t
+reg_read(uint32_t off)
+{
+	uint32_t v;
+
+	sim_advance(m.now + sim_config.mmio_read_ns * SBT_1NS);
+	sim_stats.mmio_reads++;
+	if (off >= SIM_REGS)
+		return (0xffffffff);
+
+	switch (off) {
+	case IG4_REG_DATA_CMD:
+		if (m.rx_len == 0) {
+			m.raw |= IG4_INTR_RX_UNDER;
+			v = 0;
+		} else {
+			v = m.rxq[m.rx_head];
+			m.rx_head = (m.rx_head + 1) % nitems(m.rxq);
+			m.rx_len--;
+		}
+		irq_update();
+		return (v);
+	case IG4_REG_INTR_STAT:
+		return (raw_intr() & m.regs[IG4_REG_INTR_MASK / 4]);
+	case IG4_REG_RAW_INTR_STAT:
+		return (raw_intr());
+	case IG4_REG_CLR_INTR:
+		return (clear_intrs(LATCHED_INTRS));
+	case IG4_REG_CLR_RX_UNDER:
+		return (clear_intrs(IG4_INTR_RX_UNDER));
+	case IG4_REG_CLR_RX_OVER:
+		return (clear_intrs(IG4_INTR_RX_OVER));
+	case IG4_REG_CLR_TX_OVER:
+		return (clear_intrs(IG4_INTR_TX_OVER));
+	case IG4_REG_CLR_TX_ABORT:
+		return (clear_intrs(IG4_INTR_TX_ABRT));
+	case IG4_REG_CLR_ACTIVITY:
+		return (clear_intrs(IG4_INTR_ACTIVITY));
+	case IG4_REG_CLR_STOP_DET:
+		return (clear_intrs(IG4_INTR_STOP_DET));
+	case IG4_REG_CLR_START_DET:
+		return (clear_intrs(IG4_INTR_START_DET));
+	case IG4_REG_CLR_GEN_CALL:
+		return (clear_intrs(IG4_INTR_GEN_CALL));
+	case IG4_REG_I2C_EN:
+		return (m.enabled);
+	case IG4_REG_ENABLE_STATUS:
+		return (m.enabled || m.busy);
+	case IG4_REG_I2C_STA:
+		v = 0;
+		if (m.active || m.busy)
+			v |= IG4_STATUS_I2C_ACTIVE | IG4_STATUS_ACTIVITY;
+		if (m.rx_len == (u_int)sim_config.fifo_depth)
+			v |= IG4_STATUS_RX_FULL;
+		if (m.rx_len != 0)
+			v |= IG4_STATUS_RX_NOTEMPTY;
+		if (m.tx_len == 0)
+			v |= IG4_STATUS_TX_EMPTY;
+		if (m.tx_len < (u_int)sim_config.fifo_depth)
+			v |= IG4_STATUS_TX_NOTFULL;
+		return (v);
+	case IG4_REG_TXFLR:
+		return (m.tx_len);
+	case IG4_REG_RXFLR:
+		return (m.rx_len);
+	case IG4_REG_TX_ABRT_SOURCE:
+		return (m.abrt_source);
+	default:
+		return (m.regs[off / 4]);
+	}
+}
+
+void
+sim_reg_write(uint32_t off, uint32_t v)
+{
+	if (sim_config.verbose > 1)
+		printf("%12.3f us  W %03x %08x\n", sbttons(m.now) / 1e3, off, v);
+	reg_write(off, v);
+	if (sim_config.intr_preempt)
+		sim_try_intr();
+}
+
+static void
+reg_write(uint32_t off, uint32_t v)
+{
+	sim_advance(m.now + sim_config.mmio_write_ns * SBT_1NS);
+	sim_stats.mmio_writes++;
+	if (off >= SIM_REGS)
+		return;
+
+	switch (off) {
+	case IG4_REG_DATA_CMD:
+		if (!m.enabled || m.tx_hold)
+			break;
+		if (m.tx_len == (u_int)sim_config.fifo_depth) {
+			m.raw |= IG4_INTR_TX_OVER;
+			break;
+		}
+		m.txq[(m.tx_head + m.tx_len++) % nitems(m.txq)] = v & 0x7ff;
+		engine_kick();
+		break;
+	case IG4_REG_I2C_EN:
+		m.enabled = v & IG4_I2C_ENABLE;
+		if (!m.enabled) {
+			/*
+			 * Disabling flushes both FIFOs and ends the transfer,
+			 * a byte on the bus is finished first and
+			 * ENABLE_STATUS follows once it is.
+			 */
+			tx_flush();
+			m.rx_head = m.rx_len = 0;
+			m.tx_hold = 0;
+			if (m.active && !m.busy)
+				bus_stop();
+		}
+		engine_kick();
+		break;
+	case IG4_REG_INTR_STAT:
+	case IG4_REG_RAW_INTR_STAT:
+	case IG4_REG_I2C_STA:
+	case IG4_REG_TXFLR:
+	case IG4_REG_RXFLR:
+	case IG4_REG_TX_ABRT_SOURCE:
+	case IG4_REG_ENABLE_STATUS:
+	case IG4_REG_COMP_PARAM1:
+	case IG4_REG_COMP_VER:
+	case IG4_REG_COMP_TYPE:
+		break;
+	case IG4_REG_CTL:
+	case IG4_REG_TAR_ADD:
+		/* Only writable while the controller is disabled. */
+		if (!m.enabled)
+			m.regs[off / 4] = v;
+		break;
+	default:
+		m.regs[off / 4] = v;
+		break;
+	}
+	irq_update();
+}
@@ -0,0 +1,332 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+/*
+ * Run a workload through the simulated ig4iic and report throughput,
+ * latency and cost, all in virtual time:
+ *
+ *	ig4sim -w wr:16 -n 1000		# 1000 x (write register, read 16)
+ *	ig4sim -w read:64 -s 400000	# 64-byte reads at 400 kHz
+ *	ig4sim -f fault_abort_ppm=20000	# 2% of DATA_CMD writes abort
+ *	ig4sim -I 500 -o wr.cap		# 500us apart, capture to wr.cap
+ *	ig4sim -w wr:2 -r 4		# poll 4 registers in turn
+ *	ig4sim -N -w write:4		# nobody at addr, all must NACK
+ *
+ * -f sets any of the driver's integer sysctls after attach.  Failed
+ * transfers are reported with the time they took to fail and the time
+ * from the first failure to the next successful transfer.  -o stores the
+ * driver's transfer capture (see ig4_capture.h) for ig4cap and for replay
+ * with ig4bench -r.  -P runs the interrupt handler as soon as the line is
+ * up, between any two register accesses, instead of only where the
+ * driver holds no mutex.  -r limits the registers the workload cycles
+ * through (256 by default), which decides what the driver's program
+ * cache can hit.  -N attaches no target, so every transfer must fail;
+ * the exit status says whether one did not.
+ */
+
+#include "ig4sim.h"
+
+#include <err.h>
+#include <unistd.h>
+
+enum { WL_READ, WL_WRITE, WL_WR };
+
+static int
+cmp_sbt(const void *a, const void *b)
+{
+	sbintime_t x = *(const sbintime_t *)a, y = *(const sbintime_t *)b;
+
+	return (x < y ? -1 : x > y);
+}
+
+static void
+print_pct(const char *what, sbintime_t *v, u_int n)
+{
+	if (n == 0)
+		return;
+	qsort(v, n, sizeof(*v), cmp_sbt);
+	printf("%-16s p50 %.1f  p99 %.1f  max %.1f (%u)\n", what,
+	    sbttons(v[n / 2]) / 1e3, sbttons(v[n * 99 / 100]) / 1e3,
+	    sbttons(v[n - 1]) / 1e3, n);
+}
+
+static void
+drain_capture(device_t dev, FILE *fp)
+{
+	static uint8_t buf[65536];
+	size_t len;
+
+	do {
+		len = sizeof(buf);
+		if (sim_sysctl(dev, "capture_buf", buf, &len, NULL, 0) != 0)
+			errx(1, "capture_buf");
+		if (fwrite(buf, 1, len, fp) != len)
+			err(1, "fwrite");
+	} while (len != 0);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr,
+	    "usage: ig4sim [-NPv] [-a addr] [-f sysctl=value] [-F fifo] [-I think_us]\n"
+	    "              [-l irq_ns] [-m rd_ns,wr_ns] [-n count] [-o capture]\n"
+	    "              [-r nregs] [-s scl_hz] [-S stretch_ns]\n"
+	    "              [-w read:N|write:N|wr:N]\n");
+	exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct iic_msg msgs[2];
+	uint8_t reg, wbuf[1 + 65535], rbuf[65535];
+	static const char *injected[] = { "fault_aborts", "fault_rx_drops",
+	    "fault_enable_stucks", "fault_intr_delays" };
+	char *knob[16];
+	sbintime_t start, t0, fail_since, *lat, *errlat, *rec;
+	device_t dev;
+	FILE *cap;
+	uint64_t mmio, xfers, wk, wks, hits, spins, falls;
+	u_int addr, count, i, j, len, mismatches, errors, nmsgs, nknobs, nrec;
+	u_int nregs;
+	int v;
+	int ch, nack, stretch, think, wl;
+	char *p;
+
+	nack = 0;
+	nknobs = 0;
+	cap = NULL;
+	think = 0;
+	addr = 0x50;
+	count = 1000;
+	len = 16;
+	nregs = 256;
+	stretch = 0;
+	wl = WL_WR;
+	while ((ch = getopt(argc, argv, "a:f:F:I:l:m:n:No:Pr:s:S:vw:")) != -1) {
+		switch (ch) {
+		case 'a':
+			addr = strtoul(optarg, NULL, 0) & 0x7f;
+			break;
+		case 'f':
+			if (nknobs == nitems(knob) ||
+			    strchr(optarg, '=') == NULL)
+				usage();
+			knob[nknobs++] = optarg;
+			break;
+		case 'F':
+			sim_config.fifo_depth = atoi(optarg);
+			break;
+		case 'l':
+			sim_config.irq_latency_ns = atoi(optarg);
+			break;
+		case 'm':
+			sim_config.mmio_read_ns = strtol(optarg, &p, 0);
+			if (*p == ',')
+				sim_config.mmio_write_ns = atoi(p + 1);
+			break;
+		case 'I':
+			think = atoi(optarg);
+			break;
+		case 'o':
+			if ((cap = fopen(optarg, "w")) == NULL)
+				err(1, "%s", optarg);
+			break;
+		case 'n':
+			count = strtoul(optarg, NULL, 0);
+			break;
+		case 'N':
+			nack = 1;
+			break;
+		case 'P':
+			sim_config.intr_preempt = 1;
+			break;
+		case 'r':
+			nregs = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			sim_config.scl_hz = atoi(optarg);
+			break;
+		case 'S':
+			stretch = atoi(optarg);
+			break;
+		case 'v':
+			sim_config.verbose = 1;
+			break;
+		case 'w':
+			if ((p = strchr(optarg, ':')) == NULL)
+				usage();
+			len = strtoul(p + 1, NULL, 0);
+			if (strncmp(optarg, "read:", 5) == 0)
+				wl = WL_READ;
+			else if (strncmp(optarg, "write:", 6) == 0)
+				wl = WL_WRITE;
+			else if (strncmp(optarg, "wr:", 3) == 0)
+				wl = WL_WR;
+			else
+				usage();
+			break;
+		default:
+			usage();
+		}
+	}
+	if (len == 0 || len > sizeof(rbuf) || count == 0 || nregs == 0)
+		usage();
+
+	/* With -N nothing answers at addr, every transfer must fail. */
+	if (!nack)
+		sim_add_slave(sim_regmap_slave(addr, 256, stretch));
+	if ((dev = sim_attach()) == NULL)
+		errx(1, "attach failed");
+	for (i = 0; i < nknobs; i++) {
+		p = strchr(knob[i], '=');
+		*p = '\0';
+		v = strtol(p + 1, NULL, 0);
+		if (sim_sysctl(dev, knob[i], NULL, NULL, &v, sizeof(v)) != 0)
+			errx(1, "%s: no such sysctl", knob[i]);
+	}
+	v = 1024 * 1024;
+	if (cap != NULL &&
+	    sim_sysctl(dev, "capture_size", NULL, NULL, &v, sizeof(v)) != 0)
+		errx(1, "capture_size");
+	if ((lat = calloc(count, sizeof(*lat))) == NULL ||
+	    (errlat = calloc(count, sizeof(*errlat))) == NULL ||
+	    (rec = calloc(count, sizeof(*rec))) == NULL)
+		err(1, "calloc");
+
+	memset(&sim_stats, 0, sizeof(sim_stats));
+	mmio = sim_sysctl_u64(dev, "xfer_mmio");
+	xfers = sim_sysctl_u64(dev, "xfer_count");
+	wk = sim_sysctl_u64(dev, "wakeups");
+	wks = sim_sysctl_u64(dev, "wakeups_spurious");
+	hits = sim_sysctl_u64(dev, "pcache_hits");
+	spins = sim_sysctl_u64(dev, "spin_count");
+	falls = sim_sysctl_u64(dev, "spin_fallbacks");
+	errors = mismatches = nrec = 0;
+	fail_since = 0;
+	t0 = sim_now();
+	for (i = 0; i < count; i++) {
+		reg = (uint8_t)(i % nregs * 7);
+		wbuf[0] = reg;
+		for (j = 0; j < len; j++)
+			wbuf[j + 1] = (uint8_t)(reg + j) ^ addr;
+		nmsgs = 1;
+		switch (wl) {
+		case WL_READ:
+			msgs[0] = (struct iic_msg){ addr << 1, IIC_M_RD, len,
+			    rbuf };
+			break;
+		case WL_WRITE:
+			msgs[0] = (struct iic_msg){ addr << 1, IIC_M_WR,
+			    len + 1, wbuf };
+			break;
+		case WL_WR:
+			msgs[0] = (struct iic_msg){ addr << 1,
+			    IIC_M_WR | IIC_M_NOSTOP, 1, wbuf };
+			msgs[1] = (struct iic_msg){ addr << 1, IIC_M_RD, len,
+			    rbuf };
+			nmsgs = 2;
+			break;
+		}
+		start = sim_now();
+		if (sim_transfer(dev, msgs, nmsgs) != 0) {
+			errlat[errors++] = sim_now() - start;
+			if (fail_since == 0)
+				fail_since = start;
+		} else {
+			if (fail_since != 0)
+				rec[nrec++] = sim_now() - fail_since;
+			fail_since = 0;
+			/* The register map holds (reg ^ addr), see sim_slave.c. */
+			if (wl == WL_WR && memcmp(rbuf, wbuf + 1, len) != 0)
+				mismatches++;
+		}
+		lat[i] = sim_now() - start;
+		if (cap != NULL && i % 256 == 255)
+			drain_capture(dev, cap);
+		if (think != 0)
+			sim_idle(think * SBT_1US);
+	}
+	if (cap != NULL) {
+		drain_capture(dev, cap);
+		if (fclose(cap) != 0)
+			err(1, "capture");
+	}
+	t0 = sim_now() - t0;
+	mmio = sim_sysctl_u64(dev, "xfer_mmio") - mmio;
+	xfers = sim_sysctl_u64(dev, "xfer_count") - xfers;
+	wk = sim_sysctl_u64(dev, "wakeups") - wk;
+	wks = sim_sysctl_u64(dev, "wakeups_spurious") - wks;
+	hits = sim_sysctl_u64(dev, "pcache_hits") - hits;
+	spins = sim_sysctl_u64(dev, "spin_count") - spins;
+	falls = sim_sysctl_u64(dev, "spin_fallbacks") - falls;
+
+	qsort(lat, count, sizeof(*lat), cmp_sbt);
+	printf("transfers        %u (%u errors, %u data mismatches)\n",
+	    count, errors, mismatches);
+	printf("payload bytes    %ju\n", (uintmax_t)count * len);
+	printf("virtual time     %.3f ms\n", sbttons(t0) / 1e6);
+	printf("throughput       %.0f B/s\n",
+	    (double)count * len / (sbttons(t0) / 1e9));
+	printf("latency us       p50 %.1f  p99 %.1f  max %.1f\n",
+	    sbttons(lat[count / 2]) / 1e3, sbttons(lat[count * 99 / 100]) / 1e3,
+	    sbttons(lat[count - 1]) / 1e3);
+	printf("interrupts/xfer  %.2f (%.2f ithread, %.2f stray)\n",
+	    (double)sim_stats.intrs / count, (double)sim_stats.ithreads / count,
+	    (double)sim_stats.strays / count);
+	printf("mmio/xfer        %.2f (driver count %.2f)\n",
+	    (double)(sim_stats.mmio_reads + sim_stats.mmio_writes) / count,
+	    xfers != 0 ? (double)mmio / xfers : 0.0);
+	printf("wakeups/xfer     %.2f (%.2f spurious)\n", (double)wk / count,
+	    (double)wks / count);
+	printf("prog cache hits  %.1f%%\n", 100.0 * hits / count);
+	printf("polled xfers     %.1f%% (%ju fell back to sleeping)\n",
+	    100.0 * spins / count, (uintmax_t)falls);
+	printf("mutex locks/xfer %.2f", (double)sim_stats.mtx_locks / count);
+	if (wl != WL_WRITE)
+		printf(" (%.3f per byte read)",
+		    (double)sim_stats.mtx_locks / ((double)count * len));
+	printf("\n");
+	printf("bus busy/stall   %.3f / %.3f ms\n",
+	    sbttons(sim_stats.bus_busy) / 1e6,
+	    sbttons(sim_stats.bus_stall) / 1e6);
+	print_pct("error us", errlat, errors);
+	print_pct("recovery us", rec, nrec);
+	for (i = 0; i < nitems(injected); i++)
+		if (sim_sysctl_u64(dev, injected[i]) != 0)
+			printf("%-16s %ju\n", injected[i] + sizeof("fault_") - 1,
+			    (uintmax_t)sim_sysctl_u64(dev, injected[i]));
+
+	sim_detach(dev);
+	(free)(lat);
+	(free)(errlat);
+	(free)(rec);
+	return (mismatches != 0 || (nack && errors != count));
+}
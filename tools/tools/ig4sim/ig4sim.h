@@ -0,0 +1,132 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef _IG4SIM_H_
+#define _IG4SIM_H_
+
+/*
+ * Userland host for sys/dev/ichiic/ig4_iic.c.
+ *
+ * The driver is compiled unmodified against the kernel shims in shim/
+ * and talks to a register model of the DesignWare I2C master (dw_model.c)
+ * instead of hardware.  Everything runs in one thread on virtual time:
+ * register accesses, DELAY() and sleeps advance the clock, bytes move on
+ * the simulated bus at the SCL rate, and the driver's interrupt handler
+ * runs whenever the interrupt line is asserted and no mutex is held,
+ * as it would in its ithread.  Results are therefore exactly repeatable.
+ */
+
+#include "ig4sim_kern.h"
+
+#include <dev/iicbus/iiconf.h>
+
+/*
+ * Virtual slave device.  start() is called with the direction when the
+ * slave is addressed, write() for every byte the master sends; both
+ * return 0 to ACK.  read() supplies the bytes the master reads.
+ */
+struct sim_slave {
+	const char	*name;
+	uint16_t	addr;		/* 7-bit address */
+	int		stretch_ns;	/* clock stretching per byte */
+	int		(*start)(struct sim_slave *s, int read);
+	int		(*write)(struct sim_slave *s, uint8_t byte);
+	uint8_t		(*read)(struct sim_slave *s);
+	void		(*stop)(struct sim_slave *s);
+	void		*priv;
+	struct sim_slave *next;
+};
+
+struct sim_config {
+	int		scl_hz;		/* 0: from the CTL speed bits */
+	int		fifo_depth;	/* TX and RX FIFO entries */
+	int		mmio_read_ns;	/* cost of a register read */
+	int		mmio_write_ns;	/* cost of a (posted) write */
+	int		irq_latency_ns;	/* line assertion to ISR entry */
+	int		wake_latency_ns; /* wakeup() to sleeper running */
+	int		ithread_latency_ns; /* filter to ithread running */
+	int		spurious_ppm;	/* ISR runs with the line low */
+	int		intr_preempt;	/* ISR runs between register accesses */
+	int		version;	/* enum ig4_vers */
+	int		verbose;
+};
+
+struct sim_stats {
+	uint64_t	intrs;		/* filter invocations */
+	uint64_t	strays;		/* filter said FILTER_STRAY */
+	uint64_t	ithreads;	/* ithread runs */
+	uint64_t	mmio_reads;
+	uint64_t	mmio_writes;
+	uint64_t	bus_bytes;	/* bytes clocked, addresses included */
+	uint64_t	aborts;		/* TX_ABRT raised */
+	uint64_t	mtx_locks;	/* mutex acquisitions, sleeps too */
+	sbintime_t	bus_busy;	/* time spent clocking bytes */
+	sbintime_t	bus_stall;	/* bus held, waiting for the TX FIFO */
+};
+
+extern struct sim_config sim_config;
+extern struct sim_stats	sim_stats;
+extern void		(*sim_intr_hook)(void);	/* after every ISR run */
+
+/* dw_model.c */
+void		sim_model_reset(void);
+void		sim_add_slave(struct sim_slave *s);
+int		sim_bus_active(void);
+void		sim_advance(sbintime_t t);
+sbintime_t	sim_next_event(void);
+sbintime_t	sim_irq_ready(void);
+sbintime_t	sim_now(void);
+
+/* sim_slave.c */
+struct sim_slave *sim_regmap_slave(uint16_t addr, size_t size,
+		    int stretch_ns);
+
+/* kern_shim.c */
+void		sim_set_hint(const char *resname, int value);
+void		sim_seed(uint64_t seed);
+int		sim_try_intr(void);
+int		sim_locks_held(void);
+void		sim_run_timers(void);
+void		sim_run_intrhooks(void);
+void		sim_idle(sbintime_t sbt);
+int		sim_sysctl(device_t dev, const char *name, void *buf,
+		    size_t *len, const void *new, size_t newlen);
+uint64_t	sim_sysctl_u64(device_t dev, const char *name);
+
+/* ig4sim_dev.c */
+device_t	sim_attach(void);
+void		sim_detach(device_t dev);
+int		sim_transfer(device_t dev, struct iic_msg *msgs,
+		    uint32_t nmsgs);
+
+/* sim_linux.c, libdwlinux.a: the Linux engine on the same model. */
+int		sim_linux_attach(void);
+void		sim_linux_detach(void);
+int		sim_linux_transfer(struct iic_msg *msgs, uint32_t nmsgs);
+
+#endif /* _IG4SIM_H_ */
@@ -0,0 +1,81 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+/*
+ * The simulated ig4iic instance: what a bus front-end (ig4_pci.c and
+ * friends) would do, then the iicbus entry points.
+ */
+
+#include "ig4sim.h"
+
+#include <dev/ichiic/ig4_reg.h>
+#include <dev/ichiic/ig4_var.h>
+
+static struct device	sim_dev = { "ig4iic", 0, NULL, 0 };
+static struct resource	sim_regs = { 0, 0, 0x1000 };
+static struct resource	sim_irq;
+
+device_t
+sim_attach(void)
+{
+	ig4iic_softc_t *sc;
+
+	sim_model_reset();
+	sc = sim_malloc(sizeof(*sc), M_WAITOK | M_ZERO);
+	sim_dev.softc = sc;
+	sc->dev = &sim_dev;
+	sc->regs_res = &sim_regs;
+	sc->intr_res = &sim_irq;
+	sc->version = sim_config.version;
+	sc->platform_attached = 1;
+	if (ig4iic_attach(sc) != 0)
+		return (NULL);
+	sim_run_intrhooks();
+	sim_dev.attached = 1;
+	return (&sim_dev);
+}
+
+void
+sim_detach(device_t dev)
+{
+	ig4iic_detach(device_get_softc(dev));
+	dev->attached = 0;
+	free(dev->softc, M_DEVBUF);
+	dev->softc = NULL;
+}
+
+int
+sim_transfer(device_t dev, struct iic_msg *msgs, uint32_t nmsgs)
+{
+	int error;
+
+	error = ig4iic_transfer(dev, msgs, nmsgs);
+	sim_run_timers();
+	return (error);
+}
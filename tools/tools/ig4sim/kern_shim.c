@@ -0,0 +1,755 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+/*
+ * Kernel services for the simulated ig4iic, on virtual time.
+ *
+ * There is a single thread.  A mutex that is already owned would deadlock
+ * and aborts instead.  Sleeping (mtx_sleep) and DELAY() without a mutex
+ * held advance the clock event by event and run the interrupt handler as
+ * soon as the line has been asserted for the configured latency.  So does
+ * dropping the last mutex, which is when the handler's ithread would get
+ * to run on a real system.
+ */
+
+#include "ig4sim.h"
+
+int	cold;
+int	bootverbose;
+int	hz = 1000;
+int	ticks;
+int	curcpu;
+u_int	mp_maxid = 3;
+
+static struct thread	sim_thread;
+struct thread		*curthread = &sim_thread;
+struct taskqueue	*taskqueue_thread;
+
+static int		locks_held;	/* mutexes owned */
+static int		sx_held;	/* sx locks owned */
+static int		in_intr;
+static uint64_t		random_state = 0x9e3779b97f4a7c15ULL;
+static void		*sleep_chan;
+static int		sleep_woken;
+
+static driver_filter_t	*intr_filter;
+static driver_intr_t	*intr_handler;
+static void		*intr_arg;
+static int		ithread_pending;
+static sbintime_t	ithread_at;
+
+static struct intr_config_hook *intr_hook;
+static struct timeout_task *timeouts;
+
+void			(*sim_intr_hook)(void);
+
+sbintime_t
+sbinuptime(void)
+{
+	return (sim_now());
+}
+
+uint32_t
+sim_random(void)
+{
+	uint64_t x = random_state;
+
+	/* xorshift64* */
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	random_state = x;
+	return ((x * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+void
+sim_seed(uint64_t seed)
+{
+	random_state = seed != 0 ? seed : 0x9e3779b97f4a7c15ULL;
+}
+
+void *
+sim_malloc(size_t size, int flags)
+{
+	void *p;
+
+	p = (flags & M_ZERO) ? calloc(1, size) : (malloc)(size);
+	if (p == NULL && (flags & M_WAITOK))
+		abort();
+	return (p);
+}
+
+/*
+ * Hints, hint.ig4iic.0.<resname>.  Runtime idle is off unless asked for,
+ * a benchmark should not depend on when the idle task happens to run.
+ */
+static struct {
+	const char	*name;
+	int		value;
+} hints[32] = {
+	{ "idle_delay_ms", 0 },
+};
+
+void
+sim_set_hint(const char *resname, int value)
+{
+	u_int i;
+
+	for (i = 0; i < nitems(hints) && hints[i].name != NULL; i++)
+		if (strcmp(hints[i].name, resname) == 0)
+			break;
+	if (i == nitems(hints))
+		abort();
+	hints[i].name = resname;
+	hints[i].value = value;
+}
+
+int
+resource_int_value(const char *name, int unit, const char *resname,
+    int *result)
+{
+	u_int i;
+
+	(void)name;
+	(void)unit;
+	for (i = 0; i < nitems(hints) && hints[i].name != NULL; i++) {
+		if (strcmp(hints[i].name, resname) == 0) {
+			*result = hints[i].value;
+			return (0);
+		}
+	}
+	return (ENOENT);
+}
+
+/*
+ * Interrupts and time.  With spurious_ppm set the filter is also run
+ * now and then while the line is low, as happens on a shared line.
+ * Normally the filter waits until no mutex is held.  With intr_preempt
+ * it is also run after every register access, like a filter on another
+ * CPU; it must not then try to take a lock the interrupted code holds.
+ * That is one run per access, so that the interrupted code gets to clear
+ * a level-triggered cause.
+ *
+ * A handler without a filter is an ithread.  The ithread starts
+ * ithread_latency_ns after the filter asked for it, once no mutex is
+ * held, and the line stays masked until it ran.
+ */
+int
+sim_try_intr(void)
+{
+	int rv;
+
+	if (in_intr)
+		return (0);
+	if (ithread_pending) {
+		if (locks_held != 0 || ithread_at > sim_now())
+			return (0);
+		ithread_pending = 0;
+		in_intr = 1;
+		sim_stats.ithreads++;
+		intr_handler(intr_arg);
+		in_intr = 0;
+		return (1);
+	}
+	if ((intr_filter == NULL && intr_handler == NULL) ||
+	    (locks_held != 0 && !sim_config.intr_preempt))
+		return (0);
+	if (sim_irq_ready() > sim_now() && (sim_config.spurious_ppm == 0 ||
+	    sim_random() % 1000000 >= (u_int)sim_config.spurious_ppm))
+		return (0);
+	in_intr = 1;
+	sim_stats.intrs++;
+	rv = intr_filter != NULL ? intr_filter(intr_arg) :
+	    FILTER_SCHEDULE_THREAD;
+	if (rv & FILTER_STRAY)
+		sim_stats.strays++;
+	if (sim_intr_hook != NULL)
+		sim_intr_hook();
+	in_intr = 0;
+	if ((rv & FILTER_SCHEDULE_THREAD) != 0 && intr_handler != NULL) {
+		ithread_pending = 1;
+		ithread_at = sim_now() +
+		    sim_config.ithread_latency_ns * SBT_1NS;
+	}
+	return (1);
+}
+
+int
+sim_locks_held(void)
+{
+	return (locks_held + sx_held);
+}
+
+void
+sim_run_timers(void)
+{
+	struct timeout_task *tt, **ttp;
+
+	for (ttp = &timeouts; (tt = *ttp) != NULL; ) {
+		if (tt->when > sim_now()) {
+			ttp = &tt->next;
+			continue;
+		}
+		*ttp = tt->next;
+		tt->pending = 0;
+		tt->fn(tt->arg, 1);
+		ttp = &timeouts;
+	}
+}
+
+/*
+ * Let time pass until the deadline or until a wakeup on chan (if not
+ * NULL).  Returns 0 if woken up, EWOULDBLOCK otherwise.
+ */
+static int
+sim_wait(void *chan, sbintime_t deadline)
+{
+	sbintime_t t;
+
+	sleep_chan = chan;
+	sleep_woken = 0;
+	for (;;) {
+		while (sim_try_intr())
+			;
+		if (sleep_woken) {
+			sleep_chan = NULL;
+			sim_advance(sim_now() +
+			    sim_config.wake_latency_ns * SBT_1NS);
+			return (0);
+		}
+		t = sim_next_event();
+		if (!in_intr && ithread_pending) {
+			if (locks_held == 0 && ithread_at < t)
+				t = ithread_at;
+		} else if (!in_intr &&
+		    (locks_held == 0 || sim_config.intr_preempt) &&
+		    sim_irq_ready() < t)
+			t = sim_irq_ready();
+		if (t >= deadline) {
+			sim_advance(deadline);
+			sleep_chan = NULL;
+			return (EWOULDBLOCK);
+		}
+		sim_advance(t);
+	}
+}
+
+void
+DELAY(int us)
+{
+	sim_wait(NULL, sim_now() + us * SBT_1US);
+}
+
+void
+sim_idle(sbintime_t sbt)
+{
+	sim_wait(NULL, sim_now() + sbt);
+	sim_run_timers();
+}
+
+int
+mtx_sleep(void *chan, struct mtx *m, int pri, const char *wmesg, int timo)
+{
+	sbintime_t deadline;
+	int error;
+
+	(void)pri;
+	(void)wmesg;
+	KASSERT(m->owned, ("mtx_sleep: %s not owned", m->name));
+	/* An untimed sleep is bounded too, nothing else would end it. */
+	deadline = sim_now() + (timo > 0 ? timo : 10 * hz) * (SBT_1S / hz);
+	m->owned = 0;
+	locks_held--;
+	error = sim_wait(chan, deadline);
+	m->owned = 1;
+	locks_held++;
+	sim_stats.mtx_locks++;
+	return (error);
+}
+
+int
+pause_sbt(const char *wmesg, sbintime_t sbt, sbintime_t pr, int flags)
+{
+	(void)wmesg;
+	(void)pr;
+	(void)flags;
+	sim_wait(NULL, sim_now() + sbt);
+	return (EWOULDBLOCK);
+}
+
+void
+wakeup(void *chan)
+{
+	if (chan == sleep_chan)
+		sleep_woken = 1;
+}
+
+void
+wakeup_one(void *chan)
+{
+	wakeup(chan);
+}
+
+/*
+ * Locks.
+ */
+void
+mtx_init(struct mtx *m, const char *name, const char *type, int opts)
+{
+	(void)type;
+	(void)opts;
+	m->name = name;
+	m->owned = 0;
+}
+
+void
+mtx_destroy(struct mtx *m)
+{
+	KASSERT(!m->owned, ("mtx_destroy: %s owned", m->name));
+}
+
+void
+mtx_lock(struct mtx *m)
+{
+	KASSERT(!m->owned, ("mtx_lock: %s already owned (deadlock)", m->name));
+	m->owned = 1;
+	locks_held++;
+	sim_stats.mtx_locks++;
+}
+
+void
+mtx_unlock(struct mtx *m)
+{
+	KASSERT(m->owned, ("mtx_unlock: %s not owned", m->name));
+	m->owned = 0;
+	if (--locks_held == 0)
+		while (sim_try_intr())
+			;
+}
+
+void
+sx_init(struct sx *sx, const char *name)
+{
+	sx->name = name;
+	sx->owned = 0;
+}
+
+void
+sx_destroy(struct sx *sx)
+{
+	KASSERT(!sx->owned, ("sx_destroy: %s owned", sx->name));
+}
+
+void
+sx_xlock(struct sx *sx)
+{
+	KASSERT(!sx->owned, ("sx_xlock: %s already owned (deadlock)",
+	    sx->name));
+	sx->owned = 1;
+	sx_held++;
+}
+
+void
+sx_xunlock(struct sx *sx)
+{
+	KASSERT(sx->owned, ("sx_xunlock: %s not owned", sx->name));
+	sx->owned = 0;
+	sx_held--;
+}
+
+/*
+ * Taskqueue timeouts, run by sim_run_timers().
+ */
+int
+taskqueue_enqueue_timeout_sbt(struct taskqueue *tq, struct timeout_task *tt,
+    sbintime_t sbt, sbintime_t pr, int flags)
+{
+	(void)tq;
+	(void)pr;
+	(void)flags;
+	tt->when = sim_now() + sbt;
+	if (!tt->pending) {
+		tt->pending = 1;
+		tt->next = timeouts;
+		timeouts = tt;
+	}
+	return (0);
+}
+
+void
+taskqueue_drain_timeout(struct taskqueue *tq, struct timeout_task *tt)
+{
+	struct timeout_task **ttp;
+
+	(void)tq;
+	for (ttp = &timeouts; *ttp != NULL; ttp = &(*ttp)->next) {
+		if (*ttp == tt) {
+			*ttp = tt->next;
+			break;
+		}
+	}
+	tt->pending = 0;
+}
+
+/*
+ * Newbus.
+ */
+int
+device_printf(device_t dev, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	if (!sim_config.verbose)
+		return (0);
+	n = fprintf(stderr, "%s%d: ", dev->name, dev->unit);
+	va_start(ap, fmt);
+	n += vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	return (n);
+}
+
+static struct device sim_iicbus = { "iicbus", 0, NULL, 0 };
+
+device_t
+device_add_child(device_t dev, const char *name, int unit)
+{
+	(void)dev;
+	(void)name;
+	(void)unit;
+	return (&sim_iicbus);
+}
+
+int
+device_delete_child(device_t dev, device_t child)
+{
+	(void)dev;
+	(void)child;
+	return (0);
+}
+
+int
+bus_generic_attach(device_t dev)
+{
+	(void)dev;
+	return (0);
+}
+
+int
+bus_generic_detach(device_t dev)
+{
+	(void)dev;
+	return (0);
+}
+
+int
+bus_generic_suspend(device_t dev)
+{
+	(void)dev;
+	return (0);
+}
+
+int
+bus_generic_resume(device_t dev)
+{
+	(void)dev;
+	return (0);
+}
+
+int
+bus_setup_intr(device_t dev, struct resource *r, int flags,
+    driver_filter_t *filter, driver_intr_t *handler, void *arg,
+    void **cookiep)
+{
+	(void)dev;
+	(void)r;
+	(void)flags;
+	intr_filter = filter;
+	intr_handler = handler;
+	intr_arg = arg;
+	*cookiep = &intr_handler;
+	return (0);
+}
+
+int
+bus_teardown_intr(device_t dev, struct resource *r, void *cookie)
+{
+	(void)dev;
+	(void)r;
+	(void)cookie;
+	intr_filter = NULL;
+	intr_handler = NULL;
+	ithread_pending = 0;
+	return (0);
+}
+
+int
+bus_bind_intr(device_t dev, struct resource *r, int cpu)
+{
+	(void)dev;
+	(void)r;
+	(void)cpu;
+	return (0);
+}
+
+/* Hooks run from sim_attach(), once "interrupts are enabled". */
+int
+config_intrhook_establish(struct intr_config_hook *hook)
+{
+	intr_hook = hook;
+	return (0);
+}
+
+void
+config_intrhook_disestablish(struct intr_config_hook *hook)
+{
+	if (intr_hook == hook)
+		intr_hook = NULL;
+}
+
+void
+sim_run_intrhooks(void)
+{
+	if (intr_hook != NULL)
+		intr_hook->ich_func(intr_hook->ich_arg);
+}
+
+int
+pci_set_powerstate(device_t dev, int state)
+{
+	(void)dev;
+	(void)state;
+	return (0);
+}
+
+void
+pci_save_state(device_t dev)
+{
+	(void)dev;
+}
+
+void
+pci_restore_state(device_t dev)
+{
+	(void)dev;
+}
+
+/*
+ * Sysctl nodes, looked up by name by sim_sysctl().
+ */
+static struct sim_oid {
+	struct sysctl_oid_list *parent;
+	const char	*name;
+	int		kind;
+	void		*ptr;
+	sysctl_handler_t *handler;
+	void		*arg1;
+	intmax_t	arg2;
+} oids[128];
+static u_int noids;
+
+struct sysctl_ctx_list *
+device_get_sysctl_ctx(device_t dev)
+{
+	return ((struct sysctl_ctx_list *)dev);
+}
+
+struct sysctl_oid *
+device_get_sysctl_tree(device_t dev)
+{
+	return ((struct sysctl_oid *)dev);
+}
+
+void
+sim_sysctl_add(struct sysctl_oid_list *parent, const char *name, int kind,
+    void *ptr, sysctl_handler_t *handler, void *arg1, intmax_t arg2)
+{
+	u_int i;
+
+	/* A re-attached device replaces its nodes. */
+	for (i = 0; i < noids; i++)
+		if (oids[i].parent == parent &&
+		    strcmp(oids[i].name, name) == 0)
+			break;
+	KASSERT(i < nitems(oids), ("too many sysctl nodes"));
+	oids[i].parent = parent;
+	oids[i].name = name;
+	oids[i].kind = kind;
+	oids[i].ptr = ptr;
+	oids[i].handler = handler;
+	oids[i].arg1 = arg1;
+	oids[i].arg2 = arg2;
+	if (i == noids)
+		noids++;
+}
+
+int
+sim_sysctl_out(struct sysctl_req *req, const void *p, size_t l)
+{
+	size_t n;
+
+	if (req->oldptr != NULL && req->oldidx < req->oldlen) {
+		n = req->oldlen - req->oldidx;
+		if (n > l)
+			n = l;
+		memcpy((char *)req->oldptr + req->oldidx, p, n);
+	}
+	req->oldidx += l;
+	if (req->oldptr != NULL && req->oldidx > req->oldlen)
+		return (ENOMEM);
+	return (0);
+}
+
+static int
+sim_sysctl_in(struct sysctl_req *req, void *p, size_t l)
+{
+	if (req->newptr == NULL)
+		return (0);
+	if (req->newlen - req->newidx < l)
+		return (EINVAL);
+	memcpy(p, (const char *)req->newptr + req->newidx, l);
+	req->newidx += l;
+	return (0);
+}
+
+int
+sysctl_handle_int(struct sysctl_oid *oidp, void *arg1, intmax_t arg2,
+    struct sysctl_req *req)
+{
+	int error;
+
+	(void)oidp;
+	(void)arg2;
+	error = sim_sysctl_out(req, arg1, sizeof(int));
+	if (error != 0 || req->newptr == NULL)
+		return (error);
+	return (sim_sysctl_in(req, arg1, sizeof(int)));
+}
+
+int
+sim_sysctl(device_t dev, const char *name, void *buf, size_t *len,
+    const void *new, size_t newlen)
+{
+	struct sysctl_req req;
+	struct sim_oid *o;
+	size_t sz;
+	u_int i;
+	int error;
+
+	for (i = 0; i < noids; i++)
+		if (oids[i].parent == SYSCTL_CHILDREN(
+		    device_get_sysctl_tree(dev)) &&
+		    strcmp(oids[i].name, name) == 0)
+			break;
+	if (i == noids)
+		return (ENOENT);
+	o = &oids[i];
+
+	memset(&req, 0, sizeof(req));
+	req.oldptr = buf;
+	req.oldlen = len != NULL ? *len : 0;
+	req.newptr = new;
+	req.newlen = newlen;
+	if (o->handler != NULL) {
+		error = o->handler(NULL, o->arg1, o->arg2, &req);
+	} else {
+		sz = o->kind == CTLTYPE_U64 ? sizeof(uint64_t) : sizeof(int);
+		error = sim_sysctl_out(&req, o->ptr, sz);
+		if (error == 0)
+			error = sim_sysctl_in(&req, o->ptr, sz);
+	}
+	if (len != NULL)
+		*len = req.oldidx;
+	return (error);
+}
+
+uint64_t
+sim_sysctl_u64(device_t dev, const char *name)
+{
+	uint64_t v;
+	size_t len;
+
+	v = 0;
+	len = sizeof(v);
+	if (sim_sysctl(dev, name, &v, &len, NULL, 0) != 0)
+		return (0);
+	return (v);
+}
+
+/*
+ * sbuf, backed by a growing heap buffer and drained on sbuf_finish().
+ */
+struct sbuf *
+sbuf_new_for_sysctl(struct sbuf *s, char *buf, int length,
+    struct sysctl_req *req)
+{
+	(void)buf;
+	s->s_size = length > 0 ? length : 128;
+	s->s_buf = sim_malloc(s->s_size, M_WAITOK);
+	s->s_len = 0;
+	s->s_buf[0] = '\0';
+	s->s_req = req;
+	return (s);
+}
+
+int
+sbuf_printf(struct sbuf *s, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	for (;;) {
+		va_start(ap, fmt);
+		n = vsnprintf(s->s_buf + s->s_len, s->s_size - s->s_len, fmt,
+		    ap);
+		va_end(ap);
+		if (n < 0)
+			return (-1);
+		if (s->s_len + n < s->s_size)
+			break;
+		s->s_size *= 2;
+		s->s_buf = realloc(s->s_buf, s->s_size);
+		if (s->s_buf == NULL)
+			abort();
+	}
+	s->s_len += n;
+	return (0);
+}
+
+int
+sbuf_finish(struct sbuf *s)
+{
+	return (sim_sysctl_out(s->s_req, s->s_buf, s->s_len + 1));
+}
+
+void
+sbuf_delete(struct sbuf *s)
+{
+	free(s->s_buf, M_DEVBUF);
+}
@@ -0,0 +1,7 @@
+/* $FreeBSD$ */
+
+/* On Linux the C library reaches the real one from <errno.h>. */
+#ifdef __linux__
+#include_next <linux/errno.h>
+#endif
+#include <errno.h>
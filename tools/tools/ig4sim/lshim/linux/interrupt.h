@@ -0,0 +1,3 @@
+/* $FreeBSD$ */
+
+#include "linux_kern.h"
@@ -0,0 +1,240 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef _LINUX_KERN_H_
+#define _LINUX_KERN_H_
+
+/*
+ * Just enough of the Linux kernel API to build i2c-designware-master.c
+ * and i2c-designware-common.c from sys/dev/intel/linux_src as userland
+ * objects.  Every Linux header they include maps to this file.  The
+ * primitives that touch the simulation are in sim_linux.c, behind the
+ * plain C interface of dw_linux.h, since the FreeBSD and Linux shims
+ * cannot share a translation unit.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dw_linux.h"
+
+typedef uint8_t		u8;
+typedef uint16_t	u16;
+typedef uint32_t	u32;
+typedef uint64_t	u64;
+
+#define __iomem
+#define likely(x)		__builtin_expect(!!(x), 1)
+#define unlikely(x)		__builtin_expect(!!(x), 0)
+#define BIT(n)			(1UL << (n))
+#define GENMASK(h, l)		(((~0UL) << (l)) & (~0UL >> (63 - (h))))
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+#define min_t(t, a, b)		((t)(a) < (t)(b) ? (t)(a) : (t)(b))
+#define IS_ENABLED(opt)		0
+#define WARN_ON_ONCE(c)		(c)
+#define swab32(x)		__builtin_bswap32(x)
+
+#define for_each_set_bit(bit, addr, size)				\
+	for ((bit) = 0; (bit) < (int)(size); (bit)++)			\
+		if ((*(addr) & (1UL << (bit))) != 0)
+
+/* linux/module.h, linux/export.h */
+#define EXPORT_SYMBOL_GPL(sym)	struct __hack
+#define MODULE_DESCRIPTION(s)	struct __hack
+#define MODULE_LICENSE(s)	struct __hack
+
+/* linux/err.h */
+#define IS_ERR(p)		((uintptr_t)(p) >= (uintptr_t)-4095)
+#define PTR_ERR(p)		((long)(intptr_t)(p))
+#define ERR_PTR(e)		((void *)(intptr_t)(e))
+
+/* linux/device.h */
+struct device {
+	const char	*name;
+};
+
+#define dev_name(d)		((d)->name)
+#define dev_dbg(d, ...)		dev_nolog((d), __VA_ARGS__)
+#define dev_info(d, ...)	dev_nolog((d), __VA_ARGS__)
+#define dev_warn(d, ...)	dwl_log((d)->name, __VA_ARGS__)
+#define dev_err(d, ...)		dwl_log((d)->name, __VA_ARGS__)
+
+static inline void
+dev_nolog(struct device *d, const char *fmt, ...)
+{
+}
+
+/* linux/io.h: the base is 0, so base + offset is the register offset. */
+#define readl_relaxed(a)	dwl_reg_read((uint32_t)(uintptr_t)(a))
+#define writel_relaxed(v, a)	dwl_reg_write((uint32_t)(uintptr_t)(a), (v))
+#define readw_relaxed(a)	((u16)readl_relaxed(a))
+#define writew_relaxed(v, a)	writel_relaxed((v), (a))
+
+/* linux/delay.h */
+#define usleep_range(min, max)	dwl_usleep(min)
+
+/* linux/completion.h */
+struct completion {
+	int		done;
+};
+
+#define HZ			1000
+#define init_completion(c)	((c)->done = 0)
+#define reinit_completion(c)	((c)->done = 0)
+#define complete(c)		do {					\
+	(c)->done = 1;							\
+	dwl_wakeup(c);							\
+} while (0)
+#define wait_for_completion_timeout(c, t)				\
+	dwl_wait((c), &(c)->done, (t) * 1000 / HZ)
+
+/* linux/pm_runtime.h, linux/pm_qos.h */
+struct pm_qos_request {
+	int		dummy;
+};
+
+#define pm_runtime_get_sync(d)		((void)(d))
+#define pm_runtime_get_noresume(d)	((void)(d))
+#define pm_runtime_put_noidle(d)	((void)(d))
+#define pm_runtime_mark_last_busy(d)	((void)(d))
+#define pm_runtime_put_autosuspend(d)	((void)(d))
+
+/* linux/clk.h, linux/reset.h, linux/gpio/consumer.h */
+struct clk;
+struct reset_control;
+struct gpio_desc;
+struct dw_pci_controller;
+
+#define clk_prepare_enable(c)		((void)(c), 0)
+#define clk_disable_unprepare(c)	((void)(c))
+#define reset_control_assert(r)		((void)(r))
+#define reset_control_deassert(r)	((void)(r))
+#define GPIOD_IN			0
+#define GPIOD_OUT_HIGH			1
+/* No recovery GPIOs. */
+#define devm_gpiod_get(d, n, f)		((struct gpio_desc *)ERR_PTR(-ENOENT))
+#define devm_gpiod_get_optional(d, n, f) ((struct gpio_desc *)NULL)
+
+/* linux/interrupt.h */
+typedef int irqreturn_t;
+#define IRQ_NONE		0
+#define IRQ_HANDLED		1
+#define IRQF_SHARED		0x80
+#define IRQF_NO_SUSPEND		0x4000
+#define IRQF_COND_SUSPEND	0x40000
+
+#define devm_request_irq(d, irq, fn, flags, name, arg)			\
+	((void)(flags), dwl_setup_intr((int (*)(int, void *))(fn), (arg)))
+
+/* linux/i2c.h */
+#define I2C_M_RD		0x0001
+#define I2C_M_TEN		0x0010
+#define I2C_M_RECV_LEN		0x0400
+#define I2C_M_NOSTART		0x4000
+#define I2C_CLIENT_PEC		0x04
+#define I2C_SMBUS_BLOCK_MAX	32
+#define I2C_AQ_NO_ZERO_LEN	0x00060000
+
+#define I2C_FUNC_I2C			0x00000001
+#define I2C_FUNC_10BIT_ADDR		0x00000002
+#define I2C_FUNC_SMBUS_BYTE		0x00060000
+#define I2C_FUNC_SMBUS_BYTE_DATA	0x00180000
+#define I2C_FUNC_SMBUS_WORD_DATA	0x00600000
+#define I2C_FUNC_SMBUS_BLOCK_DATA	0x03000000
+#define I2C_FUNC_SMBUS_I2C_BLOCK	0x0c000000
+
+struct i2c_msg {
+	u16		addr;
+	u16		flags;
+	u16		len;
+	u8		*buf;
+};
+
+struct i2c_adapter;
+struct i2c_client;
+
+struct i2c_algorithm {
+	int		(*master_xfer)(struct i2c_adapter *adap,
+			    struct i2c_msg *msgs, int num);
+	u32		(*functionality)(struct i2c_adapter *adap);
+};
+
+struct i2c_adapter_quirks {
+	u64		flags;
+};
+
+struct i2c_bus_recovery_info {
+	int		(*recover_bus)(struct i2c_adapter *adap);
+	void		(*prepare_recovery)(struct i2c_adapter *adap);
+	void		(*unprepare_recovery)(struct i2c_adapter *adap);
+	struct gpio_desc *scl_gpiod;
+	struct gpio_desc *sda_gpiod;
+};
+
+struct i2c_timings {
+	u32		bus_freq_hz;
+	u32		scl_rise_ns;
+	u32		scl_fall_ns;
+	u32		scl_int_delay_ns;
+	u32		sda_fall_ns;
+	u32		sda_hold_ns;
+};
+
+struct i2c_adapter {
+	char		name[48];
+	int		retries;
+	int		timeout;		/* in jiffies */
+	const struct i2c_algorithm *algo;
+	const struct i2c_adapter_quirks *quirks;
+	struct i2c_bus_recovery_info *bus_recovery_info;
+	void		*algo_data;
+	struct {
+		struct device	*parent;
+	} dev;
+};
+
+#define i2c_set_adapdata(a, d)		((a)->algo_data = (d))
+#define i2c_get_adapdata(a)		((a)->algo_data)
+#define i2c_generic_scl_recovery	NULL
+
+/* There is no recovery GPIO to toggle. */
+static inline int
+i2c_recover_bus(struct i2c_adapter *adap)
+{
+	return (-EOPNOTSUPP);
+}
+
+/* The adapter registers itself with the bus; i2c-core's default timeout. */
+#define i2c_add_numbered_adapter(a)	((a)->timeout = HZ, 0)
+
+#endif /* _LINUX_KERN_H_ */
@@ -0,0 +1,3 @@
+/* $FreeBSD$ */
+
+#include <dev/iicbus/iiconf.h>
@@ -0,0 +1,69 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef _IG4SIM_IICONF_H_
+#define _IG4SIM_IICONF_H_
+
+/* The subset of dev/iicbus/iiconf.h used by ig4_iic.c. */
+
+#include "ig4sim_kern.h"
+
+#define IIC_LAST_READ		0x1
+
+#define IIC_NOERR		0x0	/* no error occurred */
+#define IIC_EBUSERR		0x1	/* bus error (hardware not in expected state) */
+#define IIC_ENOACK		0x2	/* ack not received until timeout */
+#define IIC_ETIMEOUT		0x3	/* timeout */
+#define IIC_EBUSBSY		0x4	/* bus busy (reserved by another client) */
+#define IIC_ESTATUS		0x5	/* status error */
+#define IIC_EUNDERFLOW		0x6	/* slave ready for more data */
+#define IIC_EOVERFLOW		0x7	/* too much data */
+#define IIC_ENOTSUPP		0x8	/* request not supported */
+#define IIC_ENOADDR		0x9	/* no address assigned to the interface */
+#define IIC_ERESOURCE		0xa	/* resources (memory, whatever) unavailable */
+
+#define IIC_REQUEST_BUS		0x1
+#define IIC_RELEASE_BUS		0x2
+
+#define IIC_UNKNOWN		0x0
+#define IIC_SLOW		0x1
+#define IIC_FAST		0x2
+#define IIC_FASTEST		0x3
+
+struct iic_msg {
+	uint16_t	slave;
+	uint16_t	flags;
+#define IIC_M_WR	0	/* Fake flag for write */
+#define IIC_M_RD	0x0001	/* read vs write */
+#define IIC_M_NOSTOP	0x0002	/* do not send a I2C stop after message */
+#define IIC_M_NOSTART	0x0004	/* do not send a I2C start before message */
+	uint16_t	len;	/* msg length */
+	uint8_t		*buf;
+};
+
+#endif /* _IG4SIM_IICONF_H_ */
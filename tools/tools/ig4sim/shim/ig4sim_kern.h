@@ -0,0 +1,484 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef _IG4SIM_KERN_H_
+#define _IG4SIM_KERN_H_
+
+/*
+ * Just enough of the kernel API to build sys/dev/ichiic/ig4_iic.c as a
+ * userland object.  Every kernel header the driver includes maps to this
+ * file.  The simulation is single threaded and runs on virtual time: see
+ * kern_shim.c for locks and sleeps and dw_model.c for the controller.
+ */
+
+#include <sys/types.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* sys/cdefs.h */
+#ifndef __predict_false
+#define __predict_false(x)	__builtin_expect((x), 0)
+#define __predict_true(x)	__builtin_expect((x), 1)
+#endif
+#ifndef __noinline
+#define __noinline		__attribute__((__noinline__))
+#endif
+#ifndef __unused
+#define __unused		__attribute__((__unused__))
+#endif
+#ifndef __FBSDID
+#define __FBSDID(s)		struct __hack
+#endif
+#ifndef __DEVOLATILE
+#define __DEVOLATILE(type, var)	((type)(uintptr_t)(volatile void *)(var))
+#endif
+
+/* sys/param.h, sys/libkern.h */
+#ifndef nitems
+#define nitems(x)		(sizeof((x)) / sizeof((x)[0]))
+#endif
+#ifndef howmany
+#define howmany(x, y)		(((x) + ((y) - 1)) / (y))
+#endif
+#ifndef MAX
+#define MAX(a, b)		(((a) > (b)) ? (a) : (b))
+#define MIN(a, b)		(((a) < (b)) ? (a) : (b))
+#endif
+#ifndef roundup2
+#define roundup2(x, y)		(((x) + ((y) - 1)) & ~((y) - 1))
+#endif
+#ifndef powerof2
+#define powerof2(x)		((((x) - 1) & (x)) == 0)
+#endif
+
+/* Seeded, so that fault injection runs repeat too. */
+#define arc4random		sim_random
+uint32_t	sim_random(void);
+
+static __inline u_int
+min(u_int a, u_int b)
+{
+	return (a < b ? a : b);
+}
+
+static __inline int
+fls(int mask)
+{
+	return (mask == 0 ? 0 : 32 - __builtin_clz((u_int)mask));
+}
+
+static __inline int
+flsll(long long mask)
+{
+	return (mask == 0 ? 0 : 64 - __builtin_clzll((unsigned long long)mask));
+}
+
+#ifndef ERESTART
+#define ERESTART		(-1)
+#endif
+
+typedef uint64_t		rman_res_t;
+typedef uint64_t		*counter_u64_t;
+
+/* sys/time.h: virtual time, see sim_now(). */
+typedef int64_t			sbintime_t;
+
+#define SBT_1S			((sbintime_t)1 << 32)
+#define SBT_1MS			(SBT_1S / 1000)
+#define SBT_1US			(SBT_1S / 1000000)
+#define SBT_1NS			(SBT_1S / 1000000000)
+
+static __inline int64_t
+sbttous(sbintime_t sbt)
+{
+	return ((1000000 * sbt) >> 32);
+}
+
+static __inline int64_t
+sbttoms(sbintime_t sbt)
+{
+	return ((1000 * sbt) >> 32);
+}
+
+static __inline int64_t
+sbttons(sbintime_t sbt)
+{
+	return ((1000000000 * (sbt >> 32)) +
+	    ((1000000000 * (sbt & 0xffffffffu)) >> 32));
+}
+
+static __inline sbintime_t
+nstosbt(int64_t ns)
+{
+	return ((ns / 1000000000) * SBT_1S +
+	    ((ns % 1000000000) * (((uint64_t)1 << 63) / 500000000) >> 32));
+}
+
+sbintime_t	sbinuptime(void);
+
+/* sys/systm.h, sys/kernel.h */
+extern int	cold;
+extern int	bootverbose;
+extern int	hz;
+extern int	ticks;
+
+void	DELAY(int us);
+int	resource_int_value(const char *name, int unit, const char *resname,
+	    int *result);
+
+#define KASSERT(exp, msg) do {						\
+	if (__predict_false(!(exp))) {					\
+		printf msg;						\
+		printf("\n");						\
+		abort();						\
+	}								\
+} while (0)
+#define MPASS(exp)		KASSERT((exp), ("Assertion %s failed", #exp))
+
+/* sys/malloc.h */
+#define M_NOWAIT		0x0001
+#define M_WAITOK		0x0002
+#define M_ZERO			0x0100
+#define M_DEVBUF		NULL
+
+void	*sim_malloc(size_t size, int flags);
+#define malloc(size, type, flags)	sim_malloc((size), (flags))
+#define free(ptr, type)			(free)(ptr)
+
+/* sys/counter.h: one CPU, a plain counter. */
+#define counter_u64_alloc(flags)	\
+	((counter_u64_t)sim_malloc(sizeof(uint64_t), (flags) | M_ZERO))
+#define counter_u64_free(c)		(free)(c)
+#define counter_u64_add(c, v)		(*(c) += (v))
+#define counter_u64_fetch(c)		(*(c))
+
+/* sys/lock.h, sys/mutex.h, sys/sx.h */
+struct mtx {
+	const char	*name;
+	int		owned;
+};
+
+struct sx {
+	const char	*name;
+	int		owned;
+};
+
+#define MTX_DEF			0x0000
+#define MTX_SPIN		0x0001
+
+void	mtx_init(struct mtx *m, const char *name, const char *type, int opts);
+void	mtx_destroy(struct mtx *m);
+void	mtx_lock(struct mtx *m);
+void	mtx_unlock(struct mtx *m);
+#define mtx_lock_spin(m)	mtx_lock(m)
+#define mtx_unlock_spin(m)	mtx_unlock(m)
+#define mtx_owned(m)		((m)->owned)
+#define mtx_assert(m, what)	((void)0)
+
+void	sx_init(struct sx *sx, const char *name);
+void	sx_destroy(struct sx *sx);
+void	sx_xlock(struct sx *sx);
+void	sx_xunlock(struct sx *sx);
+#define sx_unlock(sx)		sx_xunlock(sx)
+
+int	mtx_sleep(void *chan, struct mtx *m, int pri, const char *wmesg,
+	    int timo);
+int	pause_sbt(const char *wmesg, sbintime_t sbt, sbintime_t pr, int flags);
+void	wakeup(void *chan);
+void	wakeup_one(void *chan);
+
+/* sys/proc.h, sys/sched.h, sys/smp.h */
+struct thread {
+	int		td_bound;
+};
+
+extern struct thread	*curthread;
+extern int		curcpu;
+extern u_int		mp_maxid;
+
+#define NOCPU			(-1)
+#define CPU_ABSENT(cpu)		((u_int)(cpu) > mp_maxid)
+#define thread_lock(td)		((void)0)
+#define thread_unlock(td)	((void)0)
+#define sched_bind(td, cpu)	((td)->td_bound = 1)
+#define sched_unbind(td)	((td)->td_bound = 0)
+#define sched_is_bound(td)	((td)->td_bound)
+
+/* machine/cpu.h: nothing runs concurrently with the spinner. */
+#define cpu_spinwait()		((void)0)
+
+/* machine/atomic.h */
+#define atomic_fetchadd_int(p, v)					\
+	__atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+#define atomic_store_rel_32(p, v)					\
+	__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define atomic_load_acq_32(p)						\
+	__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define atomic_load_int(p)	__atomic_load_n((p), __ATOMIC_RELAXED)
+#define atomic_store_int(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define atomic_load_acq_int(p)	__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define atomic_store_rel_int(p, v)					\
+	__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define atomic_cmpset_acq_int(p, c, v)					\
+	({ u_int __c = (c);						\
+	   __atomic_compare_exchange_n((p), &__c, (v), 0,		\
+	    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED); })
+#define atomic_thread_fence_seq_cst()					\
+	__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define atomic_add_int(p, v)	((void)atomic_fetchadd_int((p), (v)))
+#define atomic_subtract_rel_int(p, v)					\
+	((void)__atomic_fetch_sub((p), (v), __ATOMIC_RELEASE))
+#define atomic_load_acq_ptr(p)	__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define atomic_store_rel_ptr(p, v)					\
+	__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define atomic_add_64(p, v)	((void)__atomic_fetch_add((p), (v),	\
+				    __ATOMIC_SEQ_CST))
+
+/* machine/bus.h, sys/rman.h: the register window of the model. */
+typedef int			bus_space_tag_t;
+typedef uintptr_t		bus_space_handle_t;
+typedef uint64_t		bus_size_t;
+typedef uint64_t		bus_addr_t;
+
+#define BUS_SPACE_BARRIER_READ	0x01
+#define BUS_SPACE_BARRIER_WRITE	0x02
+
+uint32_t	sim_reg_read(uint32_t off);
+void		sim_reg_write(uint32_t off, uint32_t value);
+
+static __inline uint32_t
+bus_space_read_4(bus_space_tag_t t, bus_space_handle_t h, bus_size_t o)
+{
+	(void)t;
+	return (sim_reg_read((uint32_t)(h + o)));
+}
+
+static __inline void
+bus_space_write_4(bus_space_tag_t t, bus_space_handle_t h, bus_size_t o,
+    uint32_t v)
+{
+	(void)t;
+	sim_reg_write((uint32_t)(h + o), v);
+}
+
+static __inline void
+bus_space_barrier(bus_space_tag_t t, bus_space_handle_t h, bus_size_t o,
+    bus_size_t l, int flags)
+{
+	(void)t; (void)h; (void)o; (void)l; (void)flags;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static __inline int
+bus_space_subregion(bus_space_tag_t t, bus_space_handle_t h, bus_size_t o,
+    bus_size_t s, bus_space_handle_t *nh)
+{
+	(void)t; (void)s;
+	*nh = h + o;
+	return (0);
+}
+
+struct resource {
+	bus_space_tag_t		r_bustag;
+	bus_space_handle_t	r_bushandle;
+	rman_res_t		r_size;
+};
+
+#define rman_get_bustag(r)	((r)->r_bustag)
+#define rman_get_bushandle(r)	((r)->r_bushandle)
+#define rman_get_size(r)	((r)->r_size)
+
+/* sys/bus.h */
+struct device {
+	const char	*name;
+	int		unit;
+	void		*softc;
+	int		attached;
+};
+typedef struct device	*device_t;
+
+typedef void driver_intr_t(void *);
+typedef int driver_filter_t(void *);
+
+struct intr_config_hook {
+	void		(*ich_func)(void *);
+	void		*ich_arg;
+};
+
+#define INTR_TYPE_MISC		0x0010
+#define INTR_MPSAFE		0x0200
+
+#define FILTER_STRAY		0x01
+#define FILTER_HANDLED		0x02
+#define FILTER_SCHEDULE_THREAD	0x04
+
+#define device_get_softc(dev)	((dev)->softc)
+#define device_get_name(dev)	((dev)->name)
+#define device_get_unit(dev)	((dev)->unit)
+#define device_is_attached(dev)	((dev)->attached)
+
+int	device_printf(device_t dev, const char *fmt, ...)
+	    __attribute__((__format__(__printf__, 2, 3)));
+device_t device_add_child(device_t dev, const char *name, int unit);
+int	device_delete_child(device_t dev, device_t child);
+int	bus_generic_attach(device_t dev);
+int	bus_generic_detach(device_t dev);
+int	bus_generic_suspend(device_t dev);
+int	bus_generic_resume(device_t dev);
+int	bus_setup_intr(device_t dev, struct resource *r, int flags,
+	    driver_filter_t *filter, driver_intr_t *handler, void *arg,
+	    void **cookiep);
+int	bus_teardown_intr(device_t dev, struct resource *r, void *cookie);
+int	bus_bind_intr(device_t dev, struct resource *r, int cpu);
+int	config_intrhook_establish(struct intr_config_hook *hook);
+void	config_intrhook_disestablish(struct intr_config_hook *hook);
+
+/* dev/pci/pcivar.h */
+#define PCI_POWERSTATE_D0	0
+#define PCI_POWERSTATE_D3	3
+
+int	pci_set_powerstate(device_t dev, int state);
+void	pci_save_state(device_t dev);
+void	pci_restore_state(device_t dev);
+
+/* sys/taskqueue.h: timeouts run from sim_run_timers(). */
+struct taskqueue;
+typedef void task_fn_t(void *context, int pending);
+
+struct timeout_task {
+	task_fn_t	*fn;
+	void		*arg;
+	sbintime_t	when;
+	int		pending;
+	struct timeout_task *next;
+};
+
+extern struct taskqueue	*taskqueue_thread;
+
+#define TIMEOUT_TASK_INIT(queue, tt, pri, func, ctx) do {		\
+	(tt)->fn = (func);						\
+	(tt)->arg = (ctx);						\
+	(tt)->pending = 0;						\
+} while (0)
+
+int	taskqueue_enqueue_timeout_sbt(struct taskqueue *tq,
+	    struct timeout_task *tt, sbintime_t sbt, sbintime_t pr, int flags);
+void	taskqueue_drain_timeout(struct taskqueue *tq, struct timeout_task *tt);
+
+/*
+ * sys/sysctl.h: nodes are kept in a flat table so that the simulator can
+ * read the driver's counters, see sim_sysctl().
+ */
+struct sysctl_ctx_list;
+struct sysctl_oid_list;
+struct sysctl_oid;
+
+struct sysctl_req {
+	void		*oldptr;
+	size_t		oldlen;
+	size_t		oldidx;
+	const void	*newptr;
+	size_t		newlen;
+	size_t		newidx;
+};
+
+#define SYSCTL_HANDLER_ARGS	struct sysctl_oid *oidp, void *arg1,	\
+	intmax_t arg2, struct sysctl_req *req
+
+typedef int sysctl_handler_t(SYSCTL_HANDLER_ARGS);
+
+#define OID_AUTO		(-1)
+#define CTLTYPE_INT		2
+#define CTLTYPE_STRING		3
+#define CTLTYPE_OPAQUE		5
+#define CTLTYPE_UINT		6
+#define CTLTYPE_U64		9
+#define CTLTYPE_MASK		0xf
+#define CTLFLAG_RD		0x80000000
+#define CTLFLAG_WR		0x40000000
+#define CTLFLAG_RW		(CTLFLAG_RD | CTLFLAG_WR)
+#define CTLFLAG_MPSAFE		0x00040000
+
+struct sysctl_ctx_list *device_get_sysctl_ctx(device_t dev);
+struct sysctl_oid *device_get_sysctl_tree(device_t dev);
+#define SYSCTL_CHILDREN(oid)	((struct sysctl_oid_list *)(oid))
+
+void	sim_sysctl_add(struct sysctl_oid_list *parent, const char *name,
+	    int kind, void *ptr, sysctl_handler_t *handler, void *arg1,
+	    intmax_t arg2);
+
+#define SYSCTL_ADD_INT(ctx, parent, nbr, name, access, ptr, val, descr)	\
+	((void)(ctx), sim_sysctl_add((parent), (name), CTLTYPE_INT, (ptr),	\
+	    NULL, NULL, 0))
+#define SYSCTL_ADD_UINT(ctx, parent, nbr, name, access, ptr, val, descr) \
+	((void)(ctx), sim_sysctl_add((parent), (name), CTLTYPE_UINT, (ptr),	\
+	    NULL, NULL, 0))
+#define SYSCTL_ADD_U64(ctx, parent, nbr, name, access, ptr, val, descr)	\
+	((void)(ctx), sim_sysctl_add((parent), (name), CTLTYPE_U64, (ptr),	\
+	    NULL, NULL, 0))
+#define SYSCTL_ADD_COUNTER_U64(ctx, parent, nbr, name, access, ptr, descr) \
+	((void)(ctx), sim_sysctl_add((parent), (name), CTLTYPE_U64, *(ptr),	\
+	    NULL, NULL, 0))
+#define SYSCTL_ADD_PROC(ctx, parent, nbr, name, access, a1, a2, handler,	\
+    fmt, descr)								\
+	((void)(ctx), sim_sysctl_add((parent), (name),			\
+	    (access) & CTLTYPE_MASK, NULL, (handler), (a1), (a2)))
+/* Static nodes (debug.ig4_dump) are not reachable in the simulator. */
+#define SYSCTL_INT(parent, nbr, name, access, ptr, val, descr)		\
+	extern int sim_sysctl_static
+
+int	sysctl_handle_int(struct sysctl_oid *oidp, void *arg1, intmax_t arg2,
+	    struct sysctl_req *req);
+int	sim_sysctl_out(struct sysctl_req *req, const void *p, size_t l);
+#define SYSCTL_OUT(req, p, l)	sim_sysctl_out((req), (p), (l))
+
+/* sys/sbuf.h, only what the sysctl handlers use */
+struct sbuf {
+	char		*s_buf;
+	size_t		s_len;
+	size_t		s_size;
+	struct sysctl_req *s_req;
+};
+
+struct sbuf *sbuf_new_for_sysctl(struct sbuf *s, char *buf, int length,
+	    struct sysctl_req *req);
+int	sbuf_printf(struct sbuf *s, const char *fmt, ...)
+	    __attribute__((__format__(__printf__, 2, 3)));
+int	sbuf_finish(struct sbuf *s);
+void	sbuf_delete(struct sbuf *s);
+#define sbuf_len(s)		((ssize_t)(s)->s_len)
+
+#endif /* _IG4SIM_KERN_H_ */
@@ -0,0 +1,16 @@
+/* $FreeBSD$ */
+
+#ifndef _IG4SIM_IICBUS_IF_H_
+#define _IG4SIM_IICBUS_IF_H_
+
+#include "ig4sim_kern.h"
+
+#include <dev/iicbus/iiconf.h>
+
+typedef int iicbus_transfer_t(device_t dev, struct iic_msg *msgs,
+    uint32_t nmsgs);
+typedef int iicbus_reset_t(device_t dev, u_char speed, u_char addr,
+    u_char *oldaddr);
+typedef int iicbus_callback_t(device_t dev, int index, caddr_t data);
+
+#endif /* _IG4SIM_IICBUS_IF_H_ */
@@ -0,0 +1,3 @@
+/* $FreeBSD$ */
+
+#include "ig4sim_kern.h"
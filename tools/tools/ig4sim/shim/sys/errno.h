@@ -0,0 +1,4 @@
+/* $FreeBSD$ */
+
+#include_next <sys/errno.h>
+#include "ig4sim_kern.h"
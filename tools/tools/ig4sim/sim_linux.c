@@ -0,0 +1,173 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+/*
+ * Simulation side of the Linux DesignWare engine (see dw_linux.h): the
+ * primitives its shim maps to, and the iicbus-style entry points that
+ * let the tools drive it exactly like the simulated ig4iic.  Linux has
+ * no equivalent of IIC_M_NOSTOP across a STOP, so a message array is
+ * split into one i2c_transfer() per STOP.
+ */
+
+#include "ig4sim.h"
+#include "dw_linux.h"
+
+#include <stdarg.h>
+
+static struct mtx	dwl_mtx;
+static struct resource	dwl_irq;
+static void		*dwl_cookie;
+static int		(*dwl_isr)(int, void *);
+static void		*dwl_isr_arg;
+
+uint32_t
+dwl_reg_read(uint32_t off)
+{
+	return (sim_reg_read(off));
+}
+
+void
+dwl_reg_write(uint32_t off, uint32_t v)
+{
+	sim_reg_write(off, v);
+}
+
+void
+dwl_usleep(unsigned long us)
+{
+	pause_sbt("dwl", us * SBT_1US, 0, 0);
+}
+
+/* wait_for_completion_timeout(): the time left in ms, 0 if timed out. */
+unsigned long
+dwl_wait(void *chan, int *done, unsigned long ms)
+{
+	sbintime_t deadline, now;
+
+	deadline = sim_now() + ms * SBT_1MS;
+	mtx_lock(&dwl_mtx);
+	while (!*done && (now = sim_now()) < deadline)
+		mtx_sleep(chan, &dwl_mtx, 0, "dwl",
+		    (deadline - now + SBT_1MS - 1) / SBT_1MS);
+	mtx_unlock(&dwl_mtx);
+	if (!*done)
+		return (0);
+	now = sim_now();
+	return (now < deadline ? (deadline - now) / SBT_1MS + 1 : 1);
+}
+
+void
+dwl_wakeup(void *chan)
+{
+	wakeup(chan);
+}
+
+/* A hard interrupt handler, not threaded. */
+static int
+dwl_intr(void *arg)
+{
+	(void)arg;
+	dwl_isr(0, dwl_isr_arg);
+	return (FILTER_HANDLED);
+}
+
+int
+dwl_setup_intr(int (*fn)(int, void *), void *arg)
+{
+	dwl_isr = fn;
+	dwl_isr_arg = arg;
+	return (-bus_setup_intr(NULL, &dwl_irq, INTR_TYPE_MISC | INTR_MPSAFE,
+	    dwl_intr, NULL, NULL, &dwl_cookie));
+}
+
+void
+dwl_log(const char *name, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (!sim_config.verbose)
+		return;
+	printf("%s: ", name);
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+}
+
+int
+sim_linux_attach(void)
+{
+	sim_model_reset();
+	/* Its handler runs under dwl_mtx, which the transfer path holds. */
+	sim_config.intr_preempt = 0;
+	mtx_init(&dwl_mtx, "dwl", NULL, MTX_DEF);
+	/* Standard mode like ig4iic, unless a faster clock is forced. */
+	return (dwl_attach(sim_config.fifo_depth, sim_config.scl_hz > 100000));
+}
+
+void
+sim_linux_detach(void)
+{
+	dwl_detach();
+	bus_teardown_intr(NULL, &dwl_irq, dwl_cookie);
+	mtx_destroy(&dwl_mtx);
+}
+
+int
+sim_linux_transfer(struct iic_msg *msgs, uint32_t nmsgs)
+{
+	struct dwl_msg m[8];
+	uint32_t i, n;
+	int error;
+
+	for (i = 0, n = 0; i < nmsgs; i++) {
+		if ((msgs[i].flags & IIC_M_NOSTART) != 0 || n == nitems(m))
+			return (IIC_ENOTSUPP);
+		m[n].addr = msgs[i].slave >> 1;
+		m[n].flags = msgs[i].flags & IIC_M_RD ? DWL_M_RD : 0;
+		m[n].len = msgs[i].len;
+		m[n].buf = msgs[i].buf;
+		n++;
+		if ((msgs[i].flags & IIC_M_NOSTOP) != 0 && i != nmsgs - 1)
+			continue;
+		error = dwl_xfer(m, n);
+		sim_run_timers();
+		switch (error) {
+		case 0:
+			break;
+		case EREMOTEIO:
+			return (IIC_ENOACK);
+		case ETIMEDOUT:
+			return (IIC_ETIMEOUT);
+		default:
+			return (IIC_EBUSERR);
+		}
+		n = 0;
+	}
+	return (IIC_NOERR);
+}
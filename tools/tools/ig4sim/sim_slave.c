@@ -0,0 +1,105 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+/*
+ * Virtual slave devices for the simulated bus.
+ *
+ * The register map slave behaves like an EEPROM or a typical sensor: the
+ * first byte of a write sets the register pointer, further bytes are
+ * stored there and reads return consecutive registers, with the pointer
+ * wrapping at the end of the map.
+ */
+
+#include "ig4sim.h"
+
+struct regmap {
+	uint8_t		*mem;
+	size_t		size;
+	size_t		ptr;
+	int		addressed;	/* pointer set in this write */
+};
+
+static int
+regmap_start(struct sim_slave *s, int read)
+{
+	struct regmap *rm = s->priv;
+
+	if (!read)
+		rm->addressed = 0;
+	return (0);
+}
+
+static int
+regmap_write(struct sim_slave *s, uint8_t byte)
+{
+	struct regmap *rm = s->priv;
+
+	if (!rm->addressed) {
+		rm->ptr = byte % rm->size;
+		rm->addressed = 1;
+	} else {
+		rm->mem[rm->ptr] = byte;
+		rm->ptr = (rm->ptr + 1) % rm->size;
+	}
+	return (0);
+}
+
+static uint8_t
+regmap_read(struct sim_slave *s)
+{
+	struct regmap *rm = s->priv;
+	uint8_t byte;
+
+	byte = rm->mem[rm->ptr];
+	rm->ptr = (rm->ptr + 1) % rm->size;
+	return (byte);
+}
+
+struct sim_slave *
+sim_regmap_slave(uint16_t addr, size_t size, int stretch_ns)
+{
+	struct sim_slave *s;
+	struct regmap *rm;
+	size_t i;
+
+	s = sim_malloc(sizeof(*s), M_WAITOK | M_ZERO);
+	rm = sim_malloc(sizeof(*rm), M_WAITOK | M_ZERO);
+	rm->size = size > 0 ? size : 256;
+	rm->mem = sim_malloc(rm->size, M_WAITOK);
+	for (i = 0; i < rm->size; i++)
+		rm->mem[i] = (uint8_t)(i ^ addr);
+	s->name = "regmap";
+	s->addr = addr;
+	s->stretch_ns = stretch_ns;
+	s->start = regmap_start;
+	s->write = regmap_write;
+	s->read = regmap_read;
+	s->priv = rm;
+	return (s);
+}
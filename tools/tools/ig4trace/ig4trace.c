@@ -0,0 +1,250 @@
+/*-
+ * Copyright (c) 2018 Anthony Jenkins <Scoobi_doo@yahoo.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Decode an ig4iic register access trace.
+ *
+ *	sysctl dev.ig4iic.0.trace_entries=4096
+ *	ig4trace 0			# read dev.ig4iic.0.trace_buf
+ *	sysctl -b dev.ig4iic.0.trace_buf > trace.bin
+ *	ig4trace -f trace.bin		# decode a saved trace
+ */
+
+#include <sys/types.h>
+#include <sys/sysctl.h>
+
+#include <err.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <dev/ichiic/ig4_reg.h>
+#include <dev/ichiic/ig4_trace.h>
+
+#define R(reg)	{ reg, #reg + sizeof("IG4_REG_") - 1 }
+
+static const struct {
+	uint32_t	reg;
+	const char	*name;
+} regnames[] = {
+	R(IG4_REG_CTL),
+	R(IG4_REG_TAR_ADD),
+	R(IG4_REG_HS_MADDR),
+	R(IG4_REG_DATA_CMD),
+	R(IG4_REG_SS_SCL_HCNT),
+	R(IG4_REG_SS_SCL_LCNT),
+	R(IG4_REG_FS_SCL_HCNT),
+	R(IG4_REG_FS_SCL_LCNT),
+	R(IG4_REG_INTR_STAT),
+	R(IG4_REG_INTR_MASK),
+	R(IG4_REG_RAW_INTR_STAT),
+	R(IG4_REG_RX_TL),
+	R(IG4_REG_TX_TL),
+	R(IG4_REG_CLR_INTR),
+	R(IG4_REG_CLR_RX_UNDER),
+	R(IG4_REG_CLR_RX_OVER),
+	R(IG4_REG_CLR_TX_OVER),
+	R(IG4_REG_CLR_RD_REQ),
+	R(IG4_REG_CLR_TX_ABORT),
+	R(IG4_REG_CLR_RX_DONE),
+	R(IG4_REG_CLR_ACTIVITY),
+	R(IG4_REG_CLR_STOP_DET),
+	R(IG4_REG_CLR_START_DET),
+	R(IG4_REG_CLR_GEN_CALL),
+	R(IG4_REG_I2C_EN),
+	R(IG4_REG_I2C_STA),
+	R(IG4_REG_TXFLR),
+	R(IG4_REG_RXFLR),
+	R(IG4_REG_SDA_HOLD),
+	R(IG4_REG_TX_ABRT_SOURCE),
+	R(IG4_REG_SLV_DATA_NACK),
+	R(IG4_REG_DMA_CTRL),
+	R(IG4_REG_DMA_TDLR),
+	R(IG4_REG_DMA_RDLR),
+	R(IG4_REG_SDA_SETUP),
+	R(IG4_REG_ACK_GENERAL_CALL),
+	R(IG4_REG_ENABLE_STATUS),
+	R(IG4_REG_COMP_PARAM1),
+	R(IG4_REG_COMP_VER),
+	R(IG4_REG_COMP_TYPE),
+	R(IG4_REG_RESETS_SKL),
+	R(IG4_REG_ACTIVE_LTR_VALUE),
+	R(IG4_REG_IDLE_LTR_VALUE),
+	R(IG4_REG_TX_ACK_COUNT),
+	R(IG4_REG_RX_BYTE_COUNT),
+	R(IG4_REG_DEVIDLE_CTRL),
+	R(IG4_REG_CLK_PARMS),
+	R(IG4_REG_RESETS_HSW),
+	R(IG4_REG_GENERAL),
+	R(IG4_REG_SW_LTR_VALUE),
+	R(IG4_REG_AUTO_LTR_VALUE),
+};
+
+static const char *
+regname(uint32_t reg)
+{
+	static char buf[16];
+	size_t i;
+
+	for (i = 0; i < sizeof(regnames) / sizeof(regnames[0]); i++)
+		if (regnames[i].reg == reg)
+			return (regnames[i].name);
+	snprintf(buf, sizeof(buf), "0x%04x", reg);
+	return (buf);
+}
+
+/* sbintime_t is 32.32 fixed point seconds. */
+static uint64_t
+sbt2ns(uint64_t sbt)
+{
+	return ((sbt >> 32) * 1000000000 +
+	    (((sbt & 0xffffffff) * 1000000000) >> 32));
+}
+
+static void *
+read_sysctl(int unit, size_t *lenp)
+{
+	char name[64];
+	void *buf;
+	size_t len;
+
+	snprintf(name, sizeof(name), "dev.ig4iic.%d.trace_buf", unit);
+	for (;;) {
+		if (sysctlbyname(name, NULL, &len, NULL, 0) != 0)
+			err(1, "%s", name);
+		/* Leave room for accesses made in the meantime. */
+		len += len / 8;
+		if ((buf = malloc(len)) == NULL)
+			err(1, "malloc");
+		if (sysctlbyname(name, buf, &len, NULL, 0) == 0)
+			break;
+		if (errno != ENOMEM)
+			err(1, "%s", name);
+		free(buf);
+	}
+	*lenp = len;
+	return (buf);
+}
+
+static void *
+read_file(const char *path, size_t *lenp)
+{
+	FILE *fp;
+	char *buf;
+	size_t len, n;
+
+	if ((fp = fopen(path, "r")) == NULL)
+		err(1, "%s", path);
+	buf = NULL;
+	len = 0;
+	for (;;) {
+		if ((buf = realloc(buf, len + 65536)) == NULL)
+			err(1, "realloc");
+		n = fread(buf + len, 1, 65536, fp);
+		len += n;
+		if (n < 65536)
+			break;
+	}
+	if (ferror(fp))
+		err(1, "%s", path);
+	fclose(fp);
+	*lenp = len;
+	return (buf);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: ig4trace [-r] unit\n"
+	    "       ig4trace [-r] -f file\n");
+	exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+	const struct ig4iic_trace_ent *e;
+	const char *file;
+	uint64_t t0, prev, now;
+	size_t i, len, n;
+	void *buf;
+	int ch, relative;
+
+	file = NULL;
+	relative = 0;
+	while ((ch = getopt(argc, argv, "f:r")) != -1) {
+		switch (ch) {
+		case 'f':
+			file = optarg;
+			break;
+		case 'r':
+			relative = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (file != NULL && argc == 0)
+		buf = read_file(file, &len);
+	else if (file == NULL && argc == 1)
+		buf = read_sysctl(atoi(argv[0]), &len);
+	else
+		usage();
+
+	if (len % sizeof(*e) != 0)
+		warnx("trailing %zu bytes ignored", len % sizeof(*e));
+	n = len / sizeof(*e);
+	e = buf;
+
+	/*
+	 * Times are printed in microseconds since the first record, the
+	 * delta column (or with -r the only one) since the previous one.
+	 */
+	t0 = prev = n > 0 ? sbt2ns(e[0].sbt) : 0;
+	for (i = 0; i < n; i++) {
+		now = sbt2ns(e[i].sbt);
+		if (i > 0 && e[i].seq != e[i - 1].seq + 1)
+			printf("--- %u records lost\n",
+			    e[i].seq - e[i - 1].seq - 1);
+		if (!relative)
+			printf("%10u %12.3f %+9.3f ", e[i].seq,
+			    (now - t0) / 1000.0, (now - prev) / 1000.0);
+		else
+			printf("%10u %+9.3f ", e[i].seq, (now - prev) / 1000.0);
+		printf("cpu%-3u %c %-18s 0x%08x\n", e[i].cpu,
+		    (e[i].flags & IG4_TRACE_WRITE) ? 'W' : 'R',
+		    regname(e[i].reg), e[i].value);
+		prev = now;
+	}
+	free(buf);
+	return (0);
+}